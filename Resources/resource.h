@@ -14,6 +14,8 @@
 #define IDC_COMBO_DEPTH                 1008
 #define IDC_STATIC_SAMPLE_COUNT2        1009
 #define IDC_STATIC_TRACE_DEPTH          1009
+#define IDC_COMBO_ROULETTE              1010
+#define IDC_STATIC_ROULETTE             1011
 
 // Next default values for new objects
 // 
@@ -21,7 +23,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        110
 #define _APS_NEXT_COMMAND_VALUE         40001
-#define _APS_NEXT_CONTROL_VALUE         1005
+#define _APS_NEXT_CONTROL_VALUE         1012
 #define _APS_NEXT_SYMED_VALUE           101
 #endif
 #endif
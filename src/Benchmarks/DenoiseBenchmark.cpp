@@ -0,0 +1,176 @@
+#include "Public/RenderCore.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+* Time-to-quality of the denoiser against plain sampling
+* 1. Renders a high spp reference of the demo scene, then every spp in the list twice: plain and denoised
+* 2. Quality is the PSNR against the reference of what ends up on screen(clamped and gamma corrected), time is the trace time plus the denoise time
+* 3. For every denoised render the table estimates the plain sample count and time that would reach the same PSNR, interpolating between the
+*    two plain renders around it(PSNR grows about linearly with log spp, time with spp), and how much faster the denoised render got there
+*/
+
+struct QualityRun
+{
+	unsigned int SampleCount = 0;
+	double Ms = 0.0;
+	double PSNR = 0.0;
+};
+
+//Clamped, gamma corrected values of a linear three floats per pixel image, the same mapping the frame buffer conversion does
+static std::vector<float> ToDisplay(const float* Linear, size_t Count, float Scale)
+{
+	std::vector<float> Display(Count);
+	for (size_t i = 0; i < Count; i++)
+	{
+		Display[i] = std::sqrt(std::clamp(Linear[i] * Scale, 0.f, 1.f));
+	}
+	return Display;
+}
+
+static double ComputePSNR(const std::vector<float>& Image, const std::vector<float>& Reference)
+{
+	double SquaredError = 0.0;
+	for (size_t i = 0; i < Image.size(); i++)
+	{
+		const double Difference = (double)Image[i] - (double)Reference[i];
+		SquaredError += Difference * Difference;
+	}
+	const double MSE = SquaredError / (double)std::max<size_t>(Image.size(), 1);
+	return MSE > 0.0 ? 10.0 * std::log10(1.0 / MSE) : 99.0;
+}
+
+//Render once and return the displayed image. A single progressive pass keeps the linear sums around without the denoiser
+static bool Render(RenderSettings Settings, unsigned int SampleCount, bool ShouldDenoise, std::vector<float>& OutDisplay, double& OutMs)
+{
+	Settings.SampleCount = SampleCount;
+	Settings.ProgressivePassSamples = ShouldDenoise ? 0 : SampleCount;
+	Settings.Denoise = ShouldDenoise;
+	RenderCore Core(Settings);
+	if (!Core.Initialize())
+	{
+		return false;
+	}
+	Core.RenderFrameBuffer();
+	const size_t Count = (size_t)Settings.Width * Settings.Height * 3;
+	OutDisplay = ShouldDenoise ? ToDisplay(Core.GetDenoisedBuffer(), Count, 1.f) : ToDisplay(Core.GetAccumulationBuffer(), Count, 1.f / (float)Core.GetAccumulatedSamples());
+	OutMs = (double)Core.GetLastRenderTimeUs() / 1000.0 + Core.GetLastDenoiseTime();
+	return true;
+}
+
+static void PrintUsage(const char* ProgramName)
+{
+	std::cerr << "Usage: " << ProgramName << " [options]\n"
+		<< "  --width <pixels>     Image width (default 320)\n"
+		<< "  --height <pixels>    Image height (default 180)\n"
+		<< "  --reference <spp>    Samples per pixel of the reference (default 1024)\n"
+		<< "  --max-samples <spp>  Render 1, 2, 4, ... up to this many samples per pixel (default 256)\n"
+		<< "  --threads <count>    Worker threads (default: the thread pool's automatic count)\n";
+}
+
+int main(int Argc, char** Argv)
+{
+	RenderSettings Settings;
+	Settings.Width = 320;
+	Settings.Height = 180;
+	unsigned int ReferenceSamples = 1024;
+	unsigned int MaxSamples = 256;
+	for (int i = 1; i < Argc; i++)
+	{
+		const bool HasValue = i + 1 < Argc;
+		if (std::strcmp(Argv[i], "--width") == 0 && HasValue)
+		{
+			Settings.Width = std::max(1u, (unsigned int)std::strtoul(Argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(Argv[i], "--height") == 0 && HasValue)
+		{
+			Settings.Height = std::max(1u, (unsigned int)std::strtoul(Argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(Argv[i], "--reference") == 0 && HasValue)
+		{
+			ReferenceSamples = std::max(1u, (unsigned int)std::strtoul(Argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(Argv[i], "--max-samples") == 0 && HasValue)
+		{
+			MaxSamples = std::max(1u, (unsigned int)std::strtoul(Argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(Argv[i], "--threads") == 0 && HasValue)
+		{
+			Settings.ThreadCount = std::strtoull(Argv[++i], nullptr, 10);
+		}
+		else
+		{
+			PrintUsage(Argv[0]);
+			return 1;
+		}
+	}
+
+	std::vector<float> Reference;
+	double ReferenceMs = 0.0;
+	std::cout << "Rendering the " << ReferenceSamples << " spp reference at " << Settings.Width << "x" << Settings.Height << "...\n";
+	if (!Render(Settings, ReferenceSamples, false, Reference, ReferenceMs))
+	{
+		std::cerr << "Failed to initialize the render core!\n";
+		return 1;
+	}
+
+	std::vector<QualityRun> PlainRuns;
+	std::vector<QualityRun> DenoisedRuns;
+	char Line[256];
+	std::snprintf(Line, sizeof(Line), "%8s %12s %12s %14s %14s\n", "spp", "Plain ms", "Plain dB", "Denoised ms", "Denoised dB");
+	std::cout << Line;
+	for (unsigned int SampleCount = 1; SampleCount <= MaxSamples; SampleCount *= 2)
+	{
+		std::vector<float> Image;
+		QualityRun Plain;
+		QualityRun Denoised;
+		Plain.SampleCount = Denoised.SampleCount = SampleCount;
+		if (!Render(Settings, SampleCount, false, Image, Plain.Ms))
+		{
+			std::cerr << "Failed to initialize the render core!\n";
+			return 1;
+		}
+		Plain.PSNR = ComputePSNR(Image, Reference);
+		if (!Render(Settings, SampleCount, true, Image, Denoised.Ms))
+		{
+			std::cerr << "Failed to initialize the render core!\n";
+			return 1;
+		}
+		Denoised.PSNR = ComputePSNR(Image, Reference);
+		PlainRuns.push_back(Plain);
+		DenoisedRuns.push_back(Denoised);
+		std::snprintf(Line, sizeof(Line), "%8u %12.1f %12.2f %14.1f %14.2f\n", SampleCount, Plain.Ms, Plain.PSNR, Denoised.Ms, Denoised.PSNR);
+		std::cout << Line;
+	}
+
+	std::cout << "\nTime to quality:\n";
+	for (const QualityRun& Denoised : DenoisedRuns)
+	{
+		const auto Match = std::find_if(PlainRuns.begin(), PlainRuns.end(), [&Denoised](const QualityRun& Plain) { return Plain.PSNR >= Denoised.PSNR; });
+		if (Match == PlainRuns.end())
+		{
+			std::snprintf(Line, sizeof(Line), "  %u spp denoised (%.2f dB): no plain render up to %u spp gets there\n", Denoised.SampleCount, Denoised.PSNR, MaxSamples);
+		}
+		else
+		{
+			double EquivalentSamples = Match->SampleCount;
+			double EquivalentMs = Match->Ms;
+			if (Match != PlainRuns.begin())
+			{
+				const QualityRun& Below = *(Match - 1);
+				const double Fraction = (Denoised.PSNR - Below.PSNR) / std::max(Match->PSNR - Below.PSNR, 1e-6);
+				EquivalentSamples = Below.SampleCount * std::pow((double)Match->SampleCount / Below.SampleCount, Fraction);
+				EquivalentMs = Below.Ms * std::pow(Match->Ms / std::max(Below.Ms, 1e-3), Fraction);
+			}
+			std::snprintf(Line, sizeof(Line), "  %u spp denoised (%.2f dB, %.1f ms) ~ %.1f spp plain (%.1f ms): %.2fx faster\n", Denoised.SampleCount, Denoised.PSNR,
+				Denoised.Ms, EquivalentSamples, EquivalentMs, EquivalentMs / std::max(Denoised.Ms, 1e-3));
+		}
+		std::cout << Line;
+	}
+	return 0;
+}
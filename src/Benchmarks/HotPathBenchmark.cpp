@@ -0,0 +1,403 @@
+#include "Public/HittableList.h"
+#include "Public/RenderCore.h"
+#include "Public/Sphere.h"
+#include "Public/SubMaterials.h"
+#include "Public/VMaterial.h"
+#include "Public/SphereKernels.h"
+#include "Public/CPUDispatch.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+* Microbenchmarks for the ray tracing hot paths, printed as JSON so a script can keep the numbers per commit
+* 1. Ray-scene queries over the demo scene layout: HittableList::VSphereHit in a loop, VBulkHit without and with the BVH, and the legacy shared_ptr path
+*    (HittableList::Hit over Sphere objects, then the virtual Material::Scatter) against VBulkHit + VMaterial::DispatchScatter on the same rays
+* 2. VMaterial::DispatchScatter for each material type on a fixed hit
+* 3. Vector3D operations, Utility::RandomFloat and the frame buffer conversion(the per-pixel LinearToGamma loop vs ConvertScanlineToBGRA8)
+* Every case runs Repeats times and the fastest run is reported, results go into a volatile sink so nothing gets optimized away
+* "data_oriented_speedup" is the legacy path's time over the data-oriented path's time, both without the BVH, which is the README's "about 50%" claim
+*/
+
+using BenchClock = std::chrono::steady_clock;
+
+static volatile float g_Sink = 0.f;
+
+struct BenchResult
+{
+	std::string Name;
+	double NsPerOp = 0.0;
+	double OpsPerSecond = 0.0;
+	//Only set for the cases that trace whole rays
+	double RaysPerSecond = 0.0;
+};
+
+//The scenes and rays every ray query case shares
+struct BenchScene
+{
+	HittableList LinearWorld;
+	HittableList BVHWorld;
+	//Same spheres as Sphere objects with shared_ptr materials
+	HittableList LegacyWorld;
+	std::vector<SphereObjectData> Spheres;
+	std::vector<Ray> Rays;
+};
+
+//The material class names clash with the MaterialType enumerators, hence the elaborated "class" below
+static void AddSphere(BenchScene& Scene, const SphereObjectData& Data, const MaterialScatterData& MatData, MaterialType Type)
+{
+	Scene.LinearWorld.VAddSphere(Data, MatData, Type);
+	Scene.BVHWorld.VAddSphere(Data, MatData, Type);
+	Scene.Spheres.push_back(Data);
+	std::shared_ptr<Material> LegacyMaterial;
+	switch (Type)
+	{
+		case MaterialType::Metal:
+		{
+			LegacyMaterial = std::make_shared<class Metal>(MatData.Albedo, MatData.FuzzOrRI);
+			break;
+		}
+		case MaterialType::Dielectric:
+		{
+			LegacyMaterial = std::make_shared<class Dielectric>(MatData.FuzzOrRI);
+			break;
+		}
+		default:
+		{
+			LegacyMaterial = std::make_shared<class Lambertian>(MatData.Albedo);
+			break;
+		}
+	}
+	Scene.LegacyWorld.Add(std::make_shared<Sphere>(Data.Center, Data.Radius, LegacyMaterial));
+}
+
+//The demo scene straight from RenderCore::CreateWorld, seeded the same way, so the sphere count and the hit mix match a real render at any SceneDensity
+static void BuildScene(BenchScene& Scene, size_t RayCount, unsigned int SceneDensity)
+{
+	RenderSettings Settings;
+	Settings.SceneDensity = SceneDensity;
+	RenderCore Core(Settings);
+	Core.CreateWorld(0);
+	//No BVH has been built yet, so the arrays are still in the order CreateWorld added the spheres
+	const HittableList& World = *Core.GetWorld();
+	const std::vector<SphereTransformData>& Transforms = World.GetSphereTransforms();
+	const VSphereMatComponent& Materials = World.GetSphereMaterialData();
+	for (size_t i = 0; i < Transforms.size(); i++)
+	{
+		AddSphere(Scene, SphereObjectData{ Transforms[i].SphereCenter, Transforms[i].SphereRadius }, Materials.MaterialData[i], Materials.MaterialTypes[i]);
+	}
+	Scene.BVHWorld.BuildBVH();
+
+	//Camera rays from the demo camera position towards random points over the sphere field
+	const Point3D Origin(13.f, 2.f, 3.f);
+	Scene.Rays.reserve(RayCount);
+	for (size_t i = 0; i < RayCount; i++)
+	{
+		const Point3D Target(Utility::RandomFloat(-11.f, 11.f), Utility::RandomFloat(0.f, 1.5f), Utility::RandomFloat(-11.f, 11.f));
+		Scene.Rays.emplace_back(Origin, Target - Origin);
+	}
+}
+
+template<typename Func>
+static BenchResult Measure(const char* Name, size_t OpCount, size_t RayCount, unsigned int Repeats, Func&& Body)
+{
+	double BestSeconds = 0.0;
+	for (unsigned int i = 0; i < Repeats; i++)
+	{
+		const auto Start = BenchClock::now();
+		const float Result = Body();
+		const double Seconds = std::chrono::duration<double>(BenchClock::now() - Start).count();
+		g_Sink = g_Sink + Result;
+		BestSeconds = (i == 0 || Seconds < BestSeconds) ? Seconds : BestSeconds;
+	}
+	BenchResult Result;
+	Result.Name = Name;
+	Result.NsPerOp = BestSeconds * 1e9 / (double)OpCount;
+	Result.OpsPerSecond = (double)OpCount / BestSeconds;
+	Result.RaysPerSecond = RayCount > 0 ? (double)RayCount / BestSeconds : 0.0;
+	std::cerr << Name << ": " << Result.NsPerOp << " ns/op\n";
+	return Result;
+}
+
+static void WriteJSON(std::ostream& Out, const std::vector<BenchResult>& Results, const BenchScene& Scene, double DataOrientedSpeedup)
+{
+	Out << "{\n";
+	Out << "  \"isa\": \"" << CPUDispatch::GetISAName(CPUDispatch::GetActiveISA()) << "\",\n";
+	Out << "  \"sphere_kernel\": \"" << SphereKernels::GetKernelName() << "\",\n";
+	Out << "  \"spheres\": " << Scene.Spheres.size() << ",\n";
+	Out << "  \"rays\": " << Scene.Rays.size() << ",\n";
+	Out << "  \"data_oriented_speedup\": " << DataOrientedSpeedup << ",\n";
+	Out << "  \"benchmarks\": [\n";
+	for (size_t i = 0; i < Results.size(); i++)
+	{
+		const BenchResult& Result = Results[i];
+		Out << "    { \"name\": \"" << Result.Name << "\", \"ns_per_op\": " << Result.NsPerOp << ", \"ops_per_second\": " << Result.OpsPerSecond;
+		if (Result.RaysPerSecond > 0.0)
+		{
+			Out << ", \"rays_per_second\": " << Result.RaysPerSecond;
+		}
+		Out << " }" << (i + 1 < Results.size() ? "," : "") << '\n';
+	}
+	Out << "  ]\n}\n";
+}
+
+static void PrintUsage(const char* ProgramName)
+{
+	std::cerr << "Usage: " << ProgramName << " [--rays <count>] [--repeats <count>] [--scene-density <n>] [--output <path>]\n"
+		<< "  --rays <count>    Rays per ray query case, the other cases scale with it (default 200000)\n"
+		<< "  --repeats <count> Runs per case, the fastest one is reported (default 5)\n"
+		<< "  --scene-density <n> Demo scene with n x n spheres per grid cell, like the headless option (default 1)\n"
+		<< "  --output <path>   Write the JSON there instead of stdout\n";
+}
+
+int main(int Argc, char** Argv)
+{
+	size_t RayCount = 200000;
+	unsigned int Repeats = 5;
+	unsigned int SceneDensity = 1;
+	std::string OutputPath;
+	for (int i = 1; i < Argc; i++)
+	{
+		if (std::strcmp(Argv[i], "--rays") == 0 && i + 1 < Argc)
+		{
+			RayCount = std::max<size_t>(1, std::strtoull(Argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(Argv[i], "--repeats") == 0 && i + 1 < Argc)
+		{
+			Repeats = std::max(1u, (unsigned int)std::strtoul(Argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(Argv[i], "--scene-density") == 0 && i + 1 < Argc)
+		{
+			SceneDensity = std::max(1u, (unsigned int)std::strtoul(Argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(Argv[i], "--output") == 0 && i + 1 < Argc)
+		{
+			OutputPath = Argv[++i];
+		}
+		else
+		{
+			PrintUsage(Argv[0]);
+			return 1;
+		}
+	}
+
+	BenchScene Scene;
+	BuildScene(Scene, RayCount, SceneDensity);
+	const Interval HitInterval(0.001f, Constants::g_Infinity);
+	std::vector<BenchResult> Results;
+
+	//Ray queries
+	Results.push_back(Measure("vsphere_hit", RayCount * Scene.Spheres.size(), RayCount, Repeats, [&]()
+	{
+		float Sum = 0.f;
+		HitRecord Record;
+		for (const Ray& R : Scene.Rays)
+		{
+			float Closest = HitInterval.Max;
+			for (const SphereObjectData& Data : Scene.Spheres)
+			{
+				if (Scene.LinearWorld.VSphereHit(R, Interval(HitInterval.Min, Closest), Data.Center, Data.Radius, Record))
+				{
+					Closest = Record.t;
+				}
+			}
+			Sum += Closest < HitInterval.Max ? Closest : 0.f;
+		}
+		return Sum;
+	}));
+	Results.push_back(Measure("vbulk_hit_linear", RayCount, RayCount, Repeats, [&]()
+	{
+		float Sum = 0.f;
+		HitRecord Record;
+		MaterialScatterData ScatterData;
+		for (const Ray& R : Scene.Rays)
+		{
+			Sum += Scene.LinearWorld.VBulkHit(R, HitInterval, Record, ScatterData) ? Record.t : 0.f;
+		}
+		return Sum;
+	}));
+	Results.push_back(Measure("vbulk_hit_bvh", RayCount, RayCount, Repeats, [&]()
+	{
+		float Sum = 0.f;
+		HitRecord Record;
+		MaterialScatterData ScatterData;
+		for (const Ray& R : Scene.Rays)
+		{
+			Sum += Scene.BVHWorld.VBulkHit(R, HitInterval, Record, ScatterData) ? Record.t : 0.f;
+		}
+		return Sum;
+	}));
+	const BenchResult Legacy = Measure("legacy_hit_scatter", RayCount, RayCount, Repeats, [&]()
+	{
+		float Sum = 0.f;
+		HitRecord Record;
+		Color Attenuation;
+		Ray Scattered;
+		for (const Ray& R : Scene.Rays)
+		{
+			if (Scene.LegacyWorld.Hit(R, HitInterval, Record) && Record.HitMaterial->Scatter(R, Record, Attenuation, Scattered))
+			{
+				Sum += Attenuation.X + Scattered.Direction().Y;
+			}
+		}
+		return Sum;
+	});
+	Results.push_back(Legacy);
+	const BenchResult DataOriented = Measure("vbulk_hit_dispatch_scatter_linear", RayCount, RayCount, Repeats, [&]()
+	{
+		float Sum = 0.f;
+		HitRecord Record;
+		MaterialScatterData ScatterData;
+		Color Attenuation;
+		Ray Scattered;
+		for (const Ray& R : Scene.Rays)
+		{
+			if (Scene.LinearWorld.VBulkHit(R, HitInterval, Record, ScatterData)
+				&& VMaterial::DispatchScatter(R, Record, Attenuation, Scattered, ScatterData, Record.VHitMaterial))
+			{
+				Sum += Attenuation.X + Scattered.Direction().Y;
+			}
+		}
+		return Sum;
+	});
+	Results.push_back(DataOriented);
+
+	//Material scatter on a fixed hit: a ray coming down at 45 degrees onto the top of a unit sphere
+	const size_t ScatterCount = RayCount * 10;
+	const Ray Incoming(Point3D(0.f, 2.f, -1.f), Vector3D(0.f, -1.f, 1.f));
+	HitRecord Hit;
+	Hit.t = 1.f;
+	Hit.HitPoint = Incoming.At(1.f);
+	Hittable::SetFaceNormal(Incoming, Vector3D(0.f, 1.f, 0.f), Hit);
+	const struct
+	{
+		const char* Name;
+		MaterialType Type;
+		MaterialScatterData Data;
+	} ScatterCases[] = {
+		{ "dispatch_scatter_lambertian", MaterialType::Lambertian, MaterialScatterData(0.f, Color(0.5f, 0.5f, 0.5f)) },
+		{ "dispatch_scatter_metal", MaterialType::Metal, MaterialScatterData(0.2f, Color(0.7f, 0.6f, 0.5f)) },
+		{ "dispatch_scatter_dielectric", MaterialType::Dielectric, MaterialScatterData(1.5f, Color()) },
+	};
+	for (const auto& Case : ScatterCases)
+	{
+		Results.push_back(Measure(Case.Name, ScatterCount, 0, Repeats, [&]()
+		{
+			float Sum = 0.f;
+			Color Attenuation;
+			Ray Scattered;
+			for (size_t i = 0; i < ScatterCount; i++)
+			{
+				VMaterial::DispatchScatter(Incoming, Hit, Attenuation, Scattered, Case.Data, Case.Type);
+				Sum += Scattered.Direction().X;
+			}
+			return Sum;
+		}));
+	}
+
+	//Vector3D operations over a working set that fits in L1, so the numbers are the arithmetic and not the memory
+	const size_t VectorCount = 1024;
+	const size_t VectorOps = RayCount * 50;
+	std::vector<Vector3D> Vectors(VectorCount);
+	for (Vector3D& Vector : Vectors)
+	{
+		Vector = Vector3D::RandomVector(-1.f, 1.f);
+	}
+	Results.push_back(Measure("vector3d_dot", VectorOps, 0, Repeats, [&]()
+	{
+		float Sum = 0.f;
+		for (size_t i = 0; i < VectorOps; i++)
+		{
+			Sum += Vectors[i % VectorCount].Dot(Vectors[(i + 1) % VectorCount]);
+		}
+		return Sum;
+	}));
+	Results.push_back(Measure("vector3d_cross", VectorOps, 0, Repeats, [&]()
+	{
+		Vector3D Sum;
+		for (size_t i = 0; i < VectorOps; i++)
+		{
+			Sum += Vectors[i % VectorCount].Cross(Vectors[(i + 1) % VectorCount]);
+		}
+		return Sum.X + Sum.Y + Sum.Z;
+	}));
+	Results.push_back(Measure("vector3d_normalize", VectorOps, 0, Repeats, [&]()
+	{
+		Vector3D Sum;
+		for (size_t i = 0; i < VectorOps; i++)
+		{
+			Sum += Vectors[i % VectorCount].Normalize();
+		}
+		return Sum.X + Sum.Y + Sum.Z;
+	}));
+	Results.push_back(Measure("vector3d_multiply_add", VectorOps, 0, Repeats, [&]()
+	{
+		Vector3D Sum;
+		for (size_t i = 0; i < VectorOps; i++)
+		{
+			Sum += 0.5f * Vectors[i % VectorCount] + Vectors[(i + 1) % VectorCount];
+		}
+		return Sum.X + Sum.Y + Sum.Z;
+	}));
+	Results.push_back(Measure("random_float", VectorOps, 0, Repeats, [&]()
+	{
+		float Sum = 0.f;
+		for (size_t i = 0; i < VectorOps; i++)
+		{
+			Sum += Utility::RandomFloat();
+		}
+		return Sum;
+	}));
+
+	//Frame buffer conversion, one op is one pixel of a 1280 wide scanline
+	const unsigned int ScanlineWidth = 1280;
+	const size_t PixelCount = RayCount * 10 / ScanlineWidth * ScanlineWidth + ScanlineWidth;
+	std::vector<Color> Scanline(ScanlineWidth);
+	for (Color& Pixel : Scanline)
+	{
+		Pixel = Color::RandomVector(0.f, 1.2f);
+	}
+	std::vector<unsigned char> BGRA((size_t)ScanlineWidth * 4);
+	Results.push_back(Measure("linear_to_gamma_per_pixel", PixelCount, 0, Repeats, [&]()
+	{
+		for (size_t Done = 0; Done < PixelCount; Done += ScanlineWidth)
+		{
+			for (unsigned int j = 0; j < ScanlineWidth; j++)
+			{
+				const Color Pixel = NormalizeColor(Scanline[j]);
+				BGRA[j * 4 + 0] = (unsigned char)(255.999f * LinearToGamma(Pixel.B()));
+				BGRA[j * 4 + 1] = (unsigned char)(255.999f * LinearToGamma(Pixel.G()));
+				BGRA[j * 4 + 2] = (unsigned char)(255.999f * LinearToGamma(Pixel.R()));
+				BGRA[j * 4 + 3] = 255;
+			}
+		}
+		return (float)BGRA[0];
+	}));
+	Results.push_back(Measure("convert_scanline_bgra8", PixelCount, 0, Repeats, [&]()
+	{
+		for (size_t Done = 0; Done < PixelCount; Done += ScanlineWidth)
+		{
+			ConvertScanlineToBGRA8(Scanline.data(), BGRA.data(), ScanlineWidth);
+		}
+		return (float)BGRA[0];
+	}));
+
+	const double DataOrientedSpeedup = DataOriented.NsPerOp > 0.0 ? Legacy.NsPerOp / DataOriented.NsPerOp : 0.0;
+	if (OutputPath.empty())
+	{
+		WriteJSON(std::cout, Results, Scene, DataOrientedSpeedup);
+		return 0;
+	}
+	std::ofstream OutFile(OutputPath);
+	WriteJSON(OutFile, Results, Scene, DataOrientedSpeedup);
+	if (!OutFile)
+	{
+		std::cerr << "Failed to write " << OutputPath << '\n';
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,106 @@
+#include "Public/RenderCore.h"
+#include "Public/CPUBudget.h"
+#include <cstring>
+#include <iostream>
+
+/*
+* Socket scaling benchmark for the CPU renderer
+* Renders the demo scene with the workers pinned to the first 1, 2, ... NUMA nodes(one worker per CPU of those nodes) and reports the speedup over one node
+* A last run uses every node without pinning, so the gain from node-local frame buffer bands and scene copies can be told apart from the extra cores
+*/
+
+struct ScalingRun
+{
+	const char* Label;
+	ThreadPlacement Placement;
+	unsigned int NodeLimit;
+	size_t ThreadCount;
+};
+
+static double RenderMs(const RenderSettings& BaseSettings, const ScalingRun& Run, unsigned int Repeats, std::string& OutReason)
+{
+	RenderSettings Settings = BaseSettings;
+	Settings.Placement = Run.Placement;
+	Settings.NUMANodeLimit = Run.NodeLimit;
+	Settings.ThreadCount = Run.ThreadCount;
+	RenderCore Core(Settings);
+	if (!Core.Initialize())
+	{
+		return 0.0;
+	}
+	OutReason = Core.GetThreadPool()->GetThreadCountReason();
+
+	//The first frame builds the BVH and warms the caches, only the best of the following frames counts
+	Core.RenderFrameBuffer();
+	double Best = 0.0;
+	for (unsigned int i = 0; i < Repeats; i++)
+	{
+		Core.RenderFrameBuffer();
+		const double Ms = (double)Core.GetLastRenderTime();
+		Best = (i == 0 || Ms < Best) ? Ms : Best;
+	}
+	return Best;
+}
+
+int main(int Argc, char** Argv)
+{
+	RenderSettings Settings;
+	Settings.Width = 640;
+	Settings.Height = 360;
+	Settings.SampleCount = 8;
+	Settings.MaxDepth = 10;
+	unsigned int Repeats = 3;
+	for (int i = 1; i + 1 < Argc; i += 2)
+	{
+		const unsigned int Value = (unsigned int)std::strtoul(Argv[i + 1], nullptr, 10);
+		if (std::strcmp(Argv[i], "--width") == 0)
+		{
+			Settings.Width = Value;
+		}
+		else if (std::strcmp(Argv[i], "--height") == 0)
+		{
+			Settings.Height = Value;
+		}
+		else if (std::strcmp(Argv[i], "--samples") == 0)
+		{
+			Settings.SampleCount = Value;
+		}
+		else if (std::strcmp(Argv[i], "--repeats") == 0 && Value > 0)
+		{
+			Repeats = Value;
+		}
+		else
+		{
+			std::cerr << "Usage: " << Argv[0] << " [--width N] [--height N] [--samples N] [--repeats N]\n";
+			return 1;
+		}
+	}
+
+	const std::vector<NUMANodeInfo> Nodes = CPUBudget::DetectNUMANodes();
+	std::vector<ScalingRun> Runs;
+	size_t CPUsSoFar = 0;
+	for (unsigned int NodeCount = 1; NodeCount <= Nodes.size(); NodeCount++)
+	{
+		CPUsSoFar += Nodes[NodeCount - 1].CPUs.size();
+		Runs.push_back(ScalingRun{ "numa-pinned", ThreadPlacement::NUMANodes, NodeCount, CPUsSoFar });
+	}
+	Runs.push_back(ScalingRun{ "unpinned", ThreadPlacement::None, 0, CPUsSoFar });
+	if (Nodes.size() == 1)
+	{
+		std::cout << "Only one NUMA node is visible, the table shows pinned vs unpinned on a single socket\n";
+	}
+
+	std::cout << "Rendering " << Settings.Width << "x" << Settings.Height << ", " << Settings.SampleCount << " spp, best of " << Repeats << "\n";
+	double OneNodeMs = 0.0;
+	for (size_t i = 0; i < Runs.size(); i++)
+	{
+		const ScalingRun& Run = Runs[i];
+		std::string Reason;
+		const double Ms = RenderMs(Settings, Run, Repeats, Reason);
+		OneNodeMs = i == 0 ? Ms : OneNodeMs;
+		const double Speedup = Ms > 0.0 ? OneNodeMs / Ms : 0.0;
+		std::cout << Run.Label << ", nodes " << (Run.NodeLimit ? Run.NodeLimit : (unsigned int)Nodes.size()) << ", threads " << Run.ThreadCount << ": " << Ms << " ms, speedup " << Speedup
+			<< "x, efficiency " << 100.0 * Speedup * (double)Runs[0].ThreadCount / (double)Run.ThreadCount << "% (" << Reason << ")\n";
+	}
+	return 0;
+}
@@ -0,0 +1,125 @@
+#include "Public/Commons.h"
+#include "Public/CPUDispatch.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+/*
+* Microbenchmark for the random number generators, in ns per float and millions of floats per second
+* 1. The old Utility::RandomFloat: thread_local mt19937 behind std::uniform_real_distribution
+* 2. Utility::RandomFloat as it is now(thread_local PCG32) and a VRandom on the stack
+* 3. VRandom::SeedPixelSample followed by the draws of a typical sample, which is the per-sample cost the renderer pays
+* 4. VRandom8 with the scalar loop and with the active ISA's kernel
+* Every loop sums its floats into a sink so the compiler can not drop the work
+*/
+
+using BenchClock = std::chrono::steady_clock;
+
+static volatile float g_Sink = 0.f;
+
+static float OldRandomFloat()
+{
+	thread_local std::uniform_real_distribution<float> UniformDist;
+	thread_local std::mt19937 RandomGenerator;
+	return UniformDist(RandomGenerator);
+}
+
+template<typename Func>
+static void Report(const char* Label, size_t FloatCount, Func&& Body)
+{
+	const auto Start = BenchClock::now();
+	const float Sum = Body();
+	const double Seconds = std::chrono::duration<double>(BenchClock::now() - Start).count();
+	g_Sink = g_Sink + Sum;
+	std::cout << Label << ": " << Seconds * 1e9 / (double)FloatCount << " ns/float, " << (double)FloatCount / Seconds / 1e6 << " M floats/s\n";
+}
+
+int main(int Argc, char** Argv)
+{
+	size_t FloatCount = 100000000;
+	if (Argc == 3 && std::strcmp(Argv[1], "--count") == 0)
+	{
+		FloatCount = std::strtoull(Argv[2], nullptr, 10);
+	}
+	else if (Argc != 1)
+	{
+		std::cerr << "Usage: " << Argv[0] << " [--count <floats>]\n";
+		return 1;
+	}
+	//Whole blocks of 8 keep the VRandom8 runs comparable
+	FloatCount = FloatCount / 8 * 8;
+	if (FloatCount == 0)
+	{
+		FloatCount = 8;
+	}
+	std::cout << "Generating " << FloatCount << " floats per run\n";
+
+	Report("mt19937 + uniform_real_distribution (old RandomFloat)", FloatCount, [FloatCount]()
+	{
+		float Sum = 0.f;
+		for (size_t i = 0; i < FloatCount; i++)
+		{
+			Sum += OldRandomFloat();
+		}
+		return Sum;
+	});
+	Report("Utility::RandomFloat (thread_local PCG32)", FloatCount, [FloatCount]()
+	{
+		float Sum = 0.f;
+		for (size_t i = 0; i < FloatCount; i++)
+		{
+			Sum += Utility::RandomFloat();
+		}
+		return Sum;
+	});
+	Report("VRandom::NextFloat (local PCG32)", FloatCount, [FloatCount]()
+	{
+		VRandom Generator(42u);
+		float Sum = 0.f;
+		for (size_t i = 0; i < FloatCount; i++)
+		{
+			Sum += Generator.NextFloat();
+		}
+		return Sum;
+	});
+	//A diffuse bounce path draws roughly 16 floats per sample(pixel offset, defocus disk, rejection sampled directions)
+	Report("SeedPixelSample + 16 x RandomFloat", FloatCount, [FloatCount]()
+	{
+		float Sum = 0.f;
+		for (size_t i = 0; i < FloatCount / 16; i++)
+		{
+			VRandom::SeedPixelSample((uint32_t)(i >> 3u), (uint32_t)(i & 7u));
+			for (int j = 0; j < 16; j++)
+			{
+				Sum += Utility::RandomFloat();
+			}
+		}
+		return Sum;
+	});
+
+	const ISALevel ActiveISA = CPUDispatch::GetActiveISA();
+	for (ISALevel Level : { ISALevel::Scalar, ActiveISA })
+	{
+		VRandom8::SelectISA(Level);
+		const std::string Label = std::string("VRandom8::NextFloat8 (") + VRandom8::GetKernelName() + ")";
+		Report(Label.c_str(), FloatCount, [FloatCount]()
+		{
+			VRandom8 Generator(42u);
+			alignas(32) float Block[8];
+			float Sum = 0.f;
+			for (size_t i = 0; i < FloatCount; i += 8)
+			{
+				Generator.NextFloat8(Block);
+				Sum += Block[0] + Block[1] + Block[2] + Block[3] + Block[4] + Block[5] + Block[6] + Block[7];
+			}
+			return Sum;
+		});
+		if (ActiveISA == ISALevel::Scalar)
+		{
+			break;
+		}
+	}
+	VRandom8::SelectISA(ActiveISA);
+	return 0;
+}
@@ -0,0 +1,247 @@
+#include "Public/RenderCore.h"
+#include "Public/CPUDispatch.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+* End-to-end render benchmark for catching throughput regressions
+* 1. Renders a fixed set of canonical scenes(the demo layout and denser variants of it) at fixed seeds, resolutions, spp and depth
+* 2. Every case runs once to build the world and warm up, then Repeats timed renders, the fastest one counts
+* 3. One extra render with traversal stats on counts the rays. Renders are deterministic(see RenderSettings::Seed), so the count matches the timed renders
+*    without putting the stats atomics into the timing
+* 4. Results go to JSON. With --baseline, every case is compared against the same case in an earlier JSON and the exit code is 1 if any case's
+*    total rays per second fell by more than the tolerance
+*/
+
+struct BenchCase
+{
+	const char* Name;
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int SampleCount;
+	unsigned int MaxDepth;
+	unsigned int SceneDensity;
+	uint64_t Seed;
+};
+
+struct CaseResult
+{
+	std::string Name;
+	size_t ThreadCount = 0;
+	double WallSeconds = 0.0;
+	unsigned long long PrimaryRays = 0;
+	unsigned long long TotalRays = 0;
+	double PrimaryMRaysPerSecond = 0.0;
+	double TotalMRaysPerSecond = 0.0;
+	double SamplesPerSecond = 0.0;
+};
+
+static const BenchCase g_Cases[] = {
+	{ "demo_640x360_16spp", 640, 360, 16, 10, 1, 1 },
+	{ "demo_deep_640x360_16spp_depth50", 640, 360, 16, 50, 1, 1 },
+	{ "dense2_640x360_16spp", 640, 360, 16, 10, 2, 2 },
+	{ "dense4_640x360_8spp", 640, 360, 8, 10, 4, 4 },
+};
+
+static bool RunCase(const BenchCase& Case, unsigned int Repeats, size_t ThreadCount, double SizeScale, CaseResult& OutResult)
+{
+	RenderSettings Settings;
+	Settings.Width = std::max(1u, (unsigned int)(Case.Width * SizeScale));
+	Settings.Height = std::max(1u, (unsigned int)(Case.Height * SizeScale));
+	Settings.SampleCount = Case.SampleCount;
+	Settings.MaxDepth = Case.MaxDepth;
+	Settings.SceneDensity = Case.SceneDensity;
+	Settings.Seed = Case.Seed;
+	Settings.ThreadCount = ThreadCount;
+	RenderCore Core(Settings);
+	if (!Core.Initialize())
+	{
+		return false;
+	}
+
+	Core.RenderFrameBuffer();
+	long long int BestUs = 0;
+	for (unsigned int i = 0; i < Repeats; i++)
+	{
+		Core.RenderFrameBuffer();
+		BestUs = (i == 0 || Core.GetLastRenderTimeUs() < BestUs) ? Core.GetLastRenderTimeUs() : BestUs;
+	}
+
+	Settings.CollectTraversalStats = true;
+	RenderCore CountingCore(Settings);
+	if (!CountingCore.Initialize())
+	{
+		return false;
+	}
+	CountingCore.RenderFrameBuffer();
+
+	//Half size runs get their own names so a --quick baseline is never compared against a full size run
+	OutResult.Name = std::string(Case.Name) + (SizeScale != 1.0 ? "_quick" : "");
+	OutResult.ThreadCount = Core.GetThreadPool()->GetThreadCount();
+	OutResult.WallSeconds = std::max(BestUs, 1ll) / 1e6;
+	OutResult.PrimaryRays = (unsigned long long)Settings.Width * Settings.Height * Settings.SampleCount;
+	OutResult.TotalRays = CountingCore.GetTraversalStats().Rays;
+	OutResult.PrimaryMRaysPerSecond = (double)OutResult.PrimaryRays / OutResult.WallSeconds / 1e6;
+	OutResult.TotalMRaysPerSecond = (double)OutResult.TotalRays / OutResult.WallSeconds / 1e6;
+	//One sample is one camera path, so this is the primary ray rate in plain units
+	OutResult.SamplesPerSecond = (double)OutResult.PrimaryRays / OutResult.WallSeconds;
+	return true;
+}
+
+static void WriteJSON(std::ostream& Out, const std::vector<CaseResult>& Results)
+{
+	Out << "{\n";
+	Out << "  \"isa\": \"" << CPUDispatch::GetISAName(CPUDispatch::GetActiveISA()) << "\",\n";
+	Out << "  \"cases\": [\n";
+	for (size_t i = 0; i < Results.size(); i++)
+	{
+		const CaseResult& Result = Results[i];
+		Out << "    { \"name\": \"" << Result.Name << "\", \"threads\": " << Result.ThreadCount << ", \"wall_seconds\": " << Result.WallSeconds << ", \"primary_rays\": " << Result.PrimaryRays
+			<< ", \"total_rays\": " << Result.TotalRays << ", \"primary_mrays_per_second\": " << Result.PrimaryMRaysPerSecond
+			<< ", \"total_mrays_per_second\": " << Result.TotalMRaysPerSecond << ", \"samples_per_second\": " << Result.SamplesPerSecond << " }"
+			<< (i + 1 < Results.size() ? "," : "") << '\n';
+	}
+	Out << "  ]\n}\n";
+}
+
+/*
+* Pull "total_mrays_per_second" of one case out of a JSON file this program wrote. Not a general JSON parser, it relies on our own layout
+* where every case is a single object with the name first. Returns 0 if the case is missing
+*/
+static double FindBaselineRate(const std::string& Baseline, const std::string& CaseName)
+{
+	const std::string NameKey = "\"name\": \"" + CaseName + "\"";
+	const size_t CaseStart = Baseline.find(NameKey);
+	if (CaseStart == std::string::npos)
+	{
+		return 0.0;
+	}
+	const size_t CaseEnd = Baseline.find('}', CaseStart);
+	const std::string RateKey = "\"total_mrays_per_second\": ";
+	const size_t RateStart = Baseline.find(RateKey, CaseStart);
+	if (RateStart == std::string::npos || RateStart > CaseEnd)
+	{
+		return 0.0;
+	}
+	return std::strtod(Baseline.c_str() + RateStart + RateKey.size(), nullptr);
+}
+
+static void PrintUsage(const char* ProgramName)
+{
+	std::cerr << "Usage: " << ProgramName << " [options]\n"
+		<< "  --repeats <count>    Timed renders per case, the fastest one counts (default 3)\n"
+		<< "  --threads <count>    Worker threads (default: the thread pool's automatic count)\n"
+		<< "  --quick              Render every case at half the width and height\n"
+		<< "  --case <name>        Only run this case, can be given more than once\n"
+		<< "  --output <path>      Write the results as JSON (default render_benchmark.json)\n"
+		<< "  --baseline <path>    Compare against an earlier --output file\n"
+		<< "  --tolerance <ratio>  Allowed drop in total rays per second against the baseline (default 0.05)\n";
+}
+
+int main(int Argc, char** Argv)
+{
+	unsigned int Repeats = 3;
+	size_t ThreadCount = 0;
+	double SizeScale = 1.0;
+	double Tolerance = 0.05;
+	std::string OutputPath = "render_benchmark.json";
+	std::string BaselinePath;
+	std::vector<std::string> SelectedCases;
+	for (int i = 1; i < Argc; i++)
+	{
+		const bool HasValue = i + 1 < Argc;
+		if (std::strcmp(Argv[i], "--repeats") == 0 && HasValue)
+		{
+			Repeats = std::max(1u, (unsigned int)std::strtoul(Argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(Argv[i], "--threads") == 0 && HasValue)
+		{
+			ThreadCount = std::strtoull(Argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(Argv[i], "--quick") == 0)
+		{
+			SizeScale = 0.5;
+		}
+		else if (std::strcmp(Argv[i], "--case") == 0 && HasValue)
+		{
+			SelectedCases.push_back(Argv[++i]);
+		}
+		else if (std::strcmp(Argv[i], "--output") == 0 && HasValue)
+		{
+			OutputPath = Argv[++i];
+		}
+		else if (std::strcmp(Argv[i], "--baseline") == 0 && HasValue)
+		{
+			BaselinePath = Argv[++i];
+		}
+		else if (std::strcmp(Argv[i], "--tolerance") == 0 && HasValue)
+		{
+			Tolerance = std::strtod(Argv[++i], nullptr);
+		}
+		else
+		{
+			PrintUsage(Argv[0]);
+			return 1;
+		}
+	}
+
+	std::string Baseline;
+	if (!BaselinePath.empty())
+	{
+		std::ifstream BaselineFile(BaselinePath);
+		if (!BaselineFile)
+		{
+			std::cerr << "Failed to read the baseline " << BaselinePath << '\n';
+			return 1;
+		}
+		std::stringstream Buffer;
+		Buffer << BaselineFile.rdbuf();
+		Baseline = Buffer.str();
+	}
+
+	std::vector<CaseResult> Results;
+	bool HasRegressed = false;
+	for (const BenchCase& Case : g_Cases)
+	{
+		if (!SelectedCases.empty() && std::find(SelectedCases.begin(), SelectedCases.end(), Case.Name) == SelectedCases.end())
+		{
+			continue;
+		}
+		CaseResult Result;
+		if (!RunCase(Case, Repeats, ThreadCount, SizeScale, Result))
+		{
+			std::cerr << "Failed to initialize the render core for " << Case.Name << '\n';
+			return 1;
+		}
+		std::cout << Result.Name << ": " << Result.WallSeconds << " s, " << Result.PrimaryMRaysPerSecond << " primary Mrays/s, " << Result.TotalMRaysPerSecond
+			<< " total Mrays/s, " << Result.SamplesPerSecond << " samples/s";
+		const double BaselineRate = Baseline.empty() ? 0.0 : FindBaselineRate(Baseline, Result.Name);
+		if (BaselineRate > 0.0)
+		{
+			const double Ratio = Result.TotalMRaysPerSecond / BaselineRate;
+			const bool IsRegression = Ratio < 1.0 - Tolerance;
+			HasRegressed = HasRegressed || IsRegression;
+			std::cout << ", " << (Ratio - 1.0) * 100.0 << "% vs baseline" << (IsRegression ? " REGRESSION" : "");
+		}
+		else if (!Baseline.empty())
+		{
+			std::cout << ", not in the baseline";
+		}
+		std::cout << '\n';
+		Results.push_back(Result);
+	}
+	std::ofstream OutFile(OutputPath);
+	WriteJSON(OutFile, Results);
+	if (!OutFile)
+	{
+		std::cerr << "Failed to write " << OutputPath << '\n';
+		return 1;
+	}
+	std::cout << "Wrote " << OutputPath << '\n';
+	return HasRegressed ? 1 : 0;
+}
@@ -0,0 +1,155 @@
+#include "Public/ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+/*
+* Microbenchmark for VThreadPool. Compares the mutex queue against the lock-free queue on
+* 1. Throughput: SubmitTask with an empty task, N times, then wait on every future
+* 2. Bulk throughput: ParallelFor over N indices with a trivial body
+* 3. Latency: time from SubmitTask to the task starting on a worker, one task in flight at a time
+*/
+
+using BenchClock = std::chrono::steady_clock;
+
+struct LatencyResult
+{
+	double MeanNs = 0.0;
+	double P50Ns = 0.0;
+	double P99Ns = 0.0;
+};
+
+static double SecondsSince(BenchClock::time_point Start)
+{
+	return std::chrono::duration<double>(BenchClock::now() - Start).count();
+}
+
+static double MeasureSubmitThroughput(VThreadPool& Pool, size_t TaskCount)
+{
+	std::vector<std::future<void>> Futures;
+	Futures.reserve(TaskCount);
+	const auto Start = BenchClock::now();
+	for (size_t i = 0; i < TaskCount; i++)
+	{
+		Futures.push_back(Pool.SubmitTask([]() {}));
+	}
+	for (auto& Future : Futures)
+	{
+		Future.get();
+	}
+	return (double)TaskCount / SecondsSince(Start);
+}
+
+static double MeasureParallelForThroughput(VThreadPool& Pool, size_t ItemCount, size_t Grain)
+{
+	std::vector<unsigned int> Output(ItemCount);
+	const auto Start = BenchClock::now();
+	Pool.ParallelFor(0, ItemCount, Grain, [&Output](size_t ChunkBegin, size_t ChunkEnd)
+	{
+		for (size_t i = ChunkBegin; i < ChunkEnd; i++)
+		{
+			Output[i] = (unsigned int)i * 2654435761u;
+		}
+	});
+	return (double)ItemCount / SecondsSince(Start);
+}
+
+static LatencyResult MeasureSubmitLatency(VThreadPool& Pool, size_t SampleCount)
+{
+	std::vector<double> Samples;
+	Samples.reserve(SampleCount);
+	for (size_t i = 0; i < SampleCount; i++)
+	{
+		const auto Submitted = BenchClock::now();
+		std::future<double> Future = Pool.SubmitTask([Submitted]()
+		{
+			return std::chrono::duration<double, std::nano>(BenchClock::now() - Submitted).count();
+		});
+		Samples.push_back(Future.get());
+	}
+
+	LatencyResult Result;
+	std::sort(Samples.begin(), Samples.end());
+	for (double Sample : Samples)
+	{
+		Result.MeanNs += Sample;
+	}
+	Result.MeanNs /= (double)Samples.size();
+	Result.P50Ns = Samples[Samples.size() / 2];
+	Result.P99Ns = Samples[std::min(Samples.size() - 1, Samples.size() * 99 / 100)];
+	return Result;
+}
+
+static bool ParseSize(int& ArgIndex, int Argc, char** Argv, size_t& OutValue)
+{
+	if (ArgIndex + 1 >= Argc)
+	{
+		return false;
+	}
+	char* End = nullptr;
+	unsigned long long Value = std::strtoull(Argv[++ArgIndex], &End, 10);
+	if (End == Argv[ArgIndex] || *End != '\0' || Value == 0)
+	{
+		return false;
+	}
+	OutValue = (size_t)Value;
+	return true;
+}
+
+int main(int Argc, char** Argv)
+{
+	size_t ThreadCount = std::max(1u, std::thread::hardware_concurrency());
+	size_t TaskCount = 200000;
+	size_t LatencySamples = 5000;
+	size_t Grain = 256;
+	for (int i = 1; i < Argc; i++)
+	{
+		bool Parsed = true;
+		if (std::strcmp(Argv[i], "--threads") == 0)
+		{
+			Parsed = ParseSize(i, Argc, Argv, ThreadCount);
+		}
+		else if (std::strcmp(Argv[i], "--tasks") == 0)
+		{
+			Parsed = ParseSize(i, Argc, Argv, TaskCount);
+		}
+		else if (std::strcmp(Argv[i], "--latency-samples") == 0)
+		{
+			Parsed = ParseSize(i, Argc, Argv, LatencySamples);
+		}
+		else if (std::strcmp(Argv[i], "--grain") == 0)
+		{
+			Parsed = ParseSize(i, Argc, Argv, Grain);
+		}
+		else
+		{
+			Parsed = false;
+		}
+		if (!Parsed)
+		{
+			std::cerr << "Usage: " << Argv[0] << " [--threads N] [--tasks N] [--latency-samples N] [--grain N]\n";
+			return 1;
+		}
+	}
+
+	const ThreadPoolQueueType QueueTypes[] = { ThreadPoolQueueType::Mutex, ThreadPoolQueueType::LockFree };
+	for (ThreadPoolQueueType QueueType : QueueTypes)
+	{
+		VThreadPool Pool(ThreadCount, true, QueueType);
+		const char* Name = QueueType == ThreadPoolQueueType::Mutex ? "mutex" : "lock-free";
+		//One warm-up round so thread start-up and first-touch page faults stay out of the numbers
+		MeasureSubmitThroughput(Pool, std::min<size_t>(TaskCount, 10000));
+
+		const double SubmitRate = MeasureSubmitThroughput(Pool, TaskCount);
+		const double ParallelForRate = MeasureParallelForThroughput(Pool, TaskCount * 16, Grain);
+		const LatencyResult Latency = MeasureSubmitLatency(Pool, LatencySamples);
+
+		std::cout << Name << " queue, " << Pool.GetThreadCount() << " workers\n"
+			<< "  SubmitTask throughput:  " << SubmitRate / 1e6 << " M tasks/s\n"
+			<< "  ParallelFor throughput: " << ParallelForRate / 1e6 << " M items/s (grain " << Grain << ")\n"
+			<< "  Submit-to-run latency:  mean " << Latency.MeanNs << " ns, p50 " << Latency.P50Ns << " ns, p99 " << Latency.P99Ns << " ns\n";
+	}
+	return 0;
+}
@@ -0,0 +1,638 @@
+#include "Public/RenderCore.h"
+#include "Public/ImageWriter.h"
+#include "Public/CPUDispatch.h"
+#include "Public/SphereKernels.h"
+#include "Public/Timer.h"
+#include "Public/TraceRecorder.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+
+/*
+* Headless entry point for the CPU path. No window, no D2D1, no message pump
+* It renders a single frame with the settings given on the command line and writes it to disk, which is what we want on batch render nodes
+*/
+
+static void PrintUsage(const char* ProgramName)
+{
+	std::cout << "Usage: " << ProgramName << " [options]\n"
+		<< "  --width <pixels>     Image width (default 1280)\n"
+		<< "  --height <pixels>    Image height (default 720)\n"
+		<< "  --samples <count>    Samples per pixel (default 10)\n"
+		<< "  --depth <count>      Max trace depth (default 10)\n"
+		<< "  --threads <count>    Worker thread count (default: sized from the CPU affinity mask and cgroup quota, RAYTRACER_THREADS overrides)\n"
+		<< "  --output <path>      Output image path (default render.ppm)\n"
+		<< "  --no-bvh             Test every sphere for every ray instead of using the BVH\n"
+		<< "  --bvh-stats          Print BVH build and traversal statistics\n"
+		<< "  --tile-size <pixels> Edge length of the scheduler tiles (default 32)\n"
+		<< "  --worker-stats       Print per-worker busy/idle time and tile counts\n"
+		<< "  --render-stats       Print rays per depth, sphere tests, hits per material and how long paths get\n"
+		<< "  --perf-counters      Print hardware counters (cycles, IPC, cache and branch misses, backend stalls) per render phase and worker, Linux only\n"
+		<< "  --trace <path>       Record a timeline of the render phases, tiles, rows and thread pool tasks as Chrome trace JSON (open it in Perfetto)\n"
+		<< "  --pin <mode>         Worker placement: none, cores or numa (numa also splits the frame and the scene per node)\n"
+		<< "  --numa-nodes <count> Only use the first <count> NUMA nodes with --pin\n"
+		<< "  --progressive <spp>  Render in passes of <spp> samples, refreshing the image after every pass\n"
+		<< "  --snapshots          With --progressive, also write every pass to <output>.passN.ppm\n"
+		<< "  --time-limit <sec>   With --progressive, stop after the first pass that ends past this many seconds\n"
+		<< "  --adaptive <error>   Adaptive sampling: a pixel stops once its relative standard error drops below <error> (e.g. 0.02)\n"
+		<< "  --min-samples <count> With --adaptive, samples every pixel takes before it may stop (default 8)\n"
+		<< "  --max-samples <count> With --adaptive, the most samples a noisy pixel may take (default --samples)\n"
+		<< "  --heatmap <path>     With --adaptive, write the per-pixel sample counts as a heatmap image\n"
+		<< "  --seed <n|random>    Seed for the scene layout and the sample streams (default 0). The same seed gives bit-identical pixels at any thread count\n"
+		<< "  --roulette <depth>   Russian roulette from this bounce on: dim paths end early, survivors are reweighted so the image stays unbiased (0 = off)\n"
+		<< "  --sampler <name>     Pixel, lens and bounce sampling: independent, halton, sobol or bluenoise (default sobol)\n"
+		<< "  --denoise            Run the a-trous denoiser guided by first-hit albedo and normal over the final image\n"
+		<< "  --denoise-iterations <count> With --denoise, filter iterations, each one doubles the footprint (default 5)\n"
+		<< "  --aov <planes>       Also write first-hit planes as <output>.<plane>.pfm: comma separated distance, normal, albedo, id, material, or all\n"
+		<< "  --hdr <path>         Also stream the linear, unclamped image to <path> tile by tile while rendering: .pfm for 32 bit float, .exr for tiled half float\n"
+		<< "  --scene-density <n> Demo scene with n x n spheres per grid cell, about 484 * n^2 spheres (default 1)\n"
+		<< "  --scene <path>       Render a scene file instead of the demo scene: a binary one (see --save-scene) or a text one (see src/Public/SceneText.h)\n"
+		<< "  --save-scene <path>  Write the world and camera, in BVH order and with the BVH, as a binary scene file before rendering. With --scene this converts text to binary\n"
+		<< "  --no-render          Stop after loading and saving the scene\n"
+		<< "  --isa <name>         Force the kernel instruction set: scalar, sse4.2, avx2 or avx512 (default: best supported, or RAYTRACER_ISA)\n";
+}
+
+//Parse an unsigned integer argument, returns false on garbage or a missing value so the caller can print the usage
+static bool ParseUnsigned(int& ArgIndex, int Argc, char** Argv, unsigned int& OutValue)
+{
+	if (ArgIndex + 1 >= Argc)
+	{
+		return false;
+	}
+	char* End = nullptr;
+	unsigned long Value = std::strtoul(Argv[++ArgIndex], &End, 10);
+	if (End == Argv[ArgIndex] || *End != '\0')
+	{
+		return false;
+	}
+	OutValue = (unsigned int)Value;
+	return true;
+}
+
+//Same for a positive float
+static bool ParsePositiveFloat(int& ArgIndex, int Argc, char** Argv, float& OutValue)
+{
+	if (ArgIndex + 1 >= Argc)
+	{
+		return false;
+	}
+	char* End = nullptr;
+	float Value = std::strtof(Argv[++ArgIndex], &End);
+	if (End == Argv[ArgIndex] || *End != '\0' || !(Value > 0.f))
+	{
+		return false;
+	}
+	OutValue = Value;
+	return true;
+}
+
+//FNV-1a over the frame buffer, printed so two runs can be compared exactly without keeping the images around
+static uint64_t HashFrameBuffer(const unsigned char* FrameBuffer, size_t ByteCount)
+{
+	uint64_t Hash = 14695981039346656037ull;
+	for (size_t i = 0; i < ByteCount; i++)
+	{
+		Hash = (Hash ^ FrameBuffer[i]) * 1099511628211ull;
+	}
+	return Hash;
+}
+
+//render.ppm -> render.pass3.ppm
+static std::string GetSnapshotPath(const std::string& OutputPath, unsigned int PassIndex)
+{
+	const size_t Dot = OutputPath.find_last_of('.');
+	const size_t Slash = OutputPath.find_last_of("/\\");
+	const bool HasExtension = Dot != std::string::npos && (Slash == std::string::npos || Dot > Slash);
+	const std::string Stem = HasExtension ? OutputPath.substr(0, Dot) : OutputPath;
+	return Stem + ".pass" + std::to_string(PassIndex + 1) + (HasExtension ? OutputPath.substr(Dot) : std::string(".ppm"));
+}
+
+static void PrintWorkerStats(const RenderCore& Core)
+{
+	const std::vector<TileWorkerStats>& WorkerStats = Core.GetWorkerStats();
+	double TotalBusy = 0.0;
+	double TotalIdle = 0.0;
+	for (size_t i = 0; i < WorkerStats.size(); i++)
+	{
+		const TileWorkerStats& Stats = WorkerStats[i];
+		std::cout << "Worker " << i << ": busy " << Stats.BusyMs << " ms, idle " << Stats.IdleMs << " ms, " << Stats.TilesRendered << " tiles (" << Stats.TilesStolen << " stolen)\n";
+		TotalBusy += Stats.BusyMs;
+		TotalIdle += Stats.IdleMs;
+	}
+	if (TotalBusy + TotalIdle > 0.0)
+	{
+		std::cout << "Utilization: " << 100.0 * TotalBusy / (TotalBusy + TotalIdle) << "%\n";
+	}
+}
+
+static void PrintTraversalStats(const RenderCore& Core)
+{
+	const HittableList& World = *Core.GetWorld();
+	const SphereBVH& BVH = World.GetBVH();
+	if (BVH.IsBuilt())
+	{
+		const BVHBuildStats& Build = BVH.GetBuildStats();
+		std::cout << "BVH: " << World.GetNumObjects() << " spheres, " << Build.NodeCount << " nodes, " << Build.LeafCount << " leaves, depth " << Build.MaxDepth
+			<< ", max leaf " << Build.MaxLeafSize << ", SAH cost " << Build.SAHCost << ", built in " << Build.BuildTimeMs << " ms\n";
+	}
+	else
+	{
+		std::cout << "BVH: disabled, linear loop over " << World.GetNumObjects() << " spheres\n";
+	}
+
+	const TraversalStats Stats = Core.GetTraversalStats();
+	if (Stats.Rays > 0)
+	{
+		std::cout << "Traversal: " << Stats.Rays << " rays, " << (double)Stats.NodesVisited / (double)Stats.Rays << " nodes/ray, "
+			<< (double)Stats.SphereTests / (double)Stats.Rays << " sphere tests/ray\n";
+	}
+}
+
+static void PrintRenderStats(const RenderCore& Core, unsigned int MaxDepth)
+{
+	if (!RenderStats::IsCompiledIn())
+	{
+		std::cout << "Render stats: compiled out, rebuild with -DRAYTRACER_RENDER_STATS=ON\n";
+		return;
+	}
+	const RenderStats& Stats = Core.GetRenderStats();
+	const uint64_t TotalRays = Stats.GetTotalRays();
+	const uint64_t PathCount = Stats.GetPathCount();
+	if (TotalRays == 0 || PathCount == 0)
+	{
+		return;
+	}
+	std::cout << "Render stats: " << TotalRays << " rays over " << PathCount << " paths, " << (double)TotalRays / (double)PathCount << " rays/path, "
+		<< (double)Stats.SphereTests / (double)TotalRays << " sphere tests/ray\n";
+	std::cout << "Rays per depth:";
+	for (unsigned int i = 0; i <= g_StatsMaxDepth && Stats.RaysPerDepth[i] > 0; i++)
+	{
+		std::cout << ' ' << i << ':' << Stats.RaysPerDepth[i];
+	}
+	std::cout << '\n';
+	std::cout << "Hits per material: lambertian " << Stats.HitsPerMaterial[Lambertian] << ", metal " << Stats.HitsPerMaterial[Metal] << ", dielectric "
+		<< Stats.HitsPerMaterial[Dielectric] << '\n';
+	std::cout << "Paths: " << 100.0 * Stats.PathsEscaped / PathCount << "% escaped, " << 100.0 * Stats.PathsAbsorbed / PathCount << "% absorbed, "
+		<< 100.0 * Stats.PathsKilledByDepth / PathCount << "% killed by max depth, " << 100.0 * Stats.PathsKilledByRoulette / PathCount << "% ended by roulette\n";
+	std::cout << "Path lengths:";
+	for (unsigned int i = 0; i <= g_StatsMaxDepth; i++)
+	{
+		if (Stats.PathLengths[i] > 0)
+		{
+			std::cout << ' ' << i << ':' << Stats.PathLengths[i];
+		}
+	}
+	std::cout << '\n';
+	//Paths killed at the max depth pile up in its bucket, if that is more than 1 in 1000 paths the depth is cutting real light off
+	const unsigned int Length99 = Stats.GetPathLengthPercentile(0.99);
+	const unsigned int Length999 = Stats.GetPathLengthPercentile(0.999);
+	std::cout << "Path length percentiles: 99% <= " << Length99 << ", 99.9% <= " << Length999 << " (max depth " << MaxDepth << ")";
+	if (Length999 < MaxDepth)
+	{
+		std::cout << ", a max depth of " << Length999 << " would change under 0.1% of the paths";
+	}
+	std::cout << '\n';
+}
+
+static void PrintPerfCounterLine(const char* Label, const PerfCounterValues& Values)
+{
+	if (Values.IsEmpty())
+	{
+		return;
+	}
+	std::cout << Label << ':';
+	const uint64_t Instructions = Values.Get(PerfCounter::Instructions);
+	const uint64_t Cycles = Values.Get(PerfCounter::Cycles);
+	if (Values.Has(PerfCounter::Cycles))
+	{
+		std::cout << ' ' << Cycles << " cycles";
+	}
+	if (Values.Has(PerfCounter::Instructions))
+	{
+		std::cout << ", " << Instructions << " instructions";
+	}
+	if (Values.Has(PerfCounter::Cycles) && Values.Has(PerfCounter::Instructions) && Cycles > 0)
+	{
+		std::cout << ", IPC " << (double)Instructions / (double)Cycles;
+	}
+	//Per 1000 instructions, so phases of very different length compare directly
+	const double PerKiloInstruction = Instructions > 0 ? 1000.0 / (double)Instructions : 0.0;
+	if (Values.Has(PerfCounter::CacheMisses))
+	{
+		std::cout << ", " << Values.Get(PerfCounter::CacheMisses) << " cache misses";
+		if (Instructions > 0)
+		{
+			std::cout << " (" << Values.Get(PerfCounter::CacheMisses) * PerKiloInstruction << " per 1k instr)";
+		}
+	}
+	if (Values.Has(PerfCounter::BranchMisses))
+	{
+		std::cout << ", " << Values.Get(PerfCounter::BranchMisses) << " branch misses";
+		if (Instructions > 0)
+		{
+			std::cout << " (" << Values.Get(PerfCounter::BranchMisses) * PerKiloInstruction << " per 1k instr)";
+		}
+	}
+	if (Values.Has(PerfCounter::BackendStalls) && Cycles > 0)
+	{
+		std::cout << ", backend stalled " << 100.0 * (double)Values.Get(PerfCounter::BackendStalls) / (double)Cycles << "% of cycles";
+	}
+	std::cout << '\n';
+}
+
+static void PrintPerfCounters(const RenderCore& Core, const PerfCounterValues& WriteImage)
+{
+	const RenderPerfCounters& Counters = Core.GetPerfCounters();
+	if (!Counters.Error.empty())
+	{
+		std::cout << "Hardware counters unavailable: " << Counters.Error << '\n';
+		return;
+	}
+	PrintPerfCounterLine("Counters CreateWorld", Counters.CreateWorld);
+	PrintPerfCounterLine("Counters BuildBVH", Counters.BuildBVH);
+	PrintPerfCounterLine("Counters Trace", Counters.Trace);
+	for (size_t i = 0; i < Counters.Workers.size(); i++)
+	{
+		const std::string Label = "Counters worker " + std::to_string(i);
+		PrintPerfCounterLine(Label.c_str(), Counters.Workers[i]);
+	}
+	PrintPerfCounterLine("Counters WriteImage", WriteImage);
+}
+
+int main(int Argc, char** Argv)
+{
+	RenderSettings Settings;
+	std::string OutputPath = "render.ppm";
+	unsigned int ThreadCount = (unsigned int)Settings.ThreadCount;
+	bool ShouldPrintWorkerStats = false;
+	bool ShouldPrintRenderStats = false;
+	bool ShouldWriteSnapshots = false;
+	unsigned int TimeLimitSeconds = 0;
+	std::string HeatmapPath;
+	std::string TracePath;
+	std::string ScenePath;
+	std::string SaveScenePath;
+	std::string HDRPath;
+	bool ShouldRender = true;
+
+	for (int i = 1; i < Argc; i++)
+	{
+		bool Parsed = true;
+		if (std::strcmp(Argv[i], "--width") == 0)
+		{
+			Parsed = ParseUnsigned(i, Argc, Argv, Settings.Width);
+		}
+		else if (std::strcmp(Argv[i], "--height") == 0)
+		{
+			Parsed = ParseUnsigned(i, Argc, Argv, Settings.Height);
+		}
+		else if (std::strcmp(Argv[i], "--samples") == 0)
+		{
+			Parsed = ParseUnsigned(i, Argc, Argv, Settings.SampleCount);
+		}
+		else if (std::strcmp(Argv[i], "--depth") == 0)
+		{
+			Parsed = ParseUnsigned(i, Argc, Argv, Settings.MaxDepth);
+		}
+		else if (std::strcmp(Argv[i], "--threads") == 0)
+		{
+			Parsed = ParseUnsigned(i, Argc, Argv, ThreadCount);
+		}
+		else if (std::strcmp(Argv[i], "--output") == 0 && i + 1 < Argc)
+		{
+			OutputPath = Argv[++i];
+		}
+		else if (std::strcmp(Argv[i], "--no-bvh") == 0)
+		{
+			Settings.UseBVH = false;
+		}
+		else if (std::strcmp(Argv[i], "--bvh-stats") == 0)
+		{
+			Settings.CollectTraversalStats = true;
+		}
+		else if (std::strcmp(Argv[i], "--tile-size") == 0)
+		{
+			Parsed = ParseUnsigned(i, Argc, Argv, Settings.TileSize) && Settings.TileSize > 0;
+		}
+		else if (std::strcmp(Argv[i], "--pin") == 0 && i + 1 < Argc)
+		{
+			const char* Mode = Argv[++i];
+			Settings.Placement = std::strcmp(Mode, "cores") == 0 ? ThreadPlacement::Cores : std::strcmp(Mode, "numa") == 0 ? ThreadPlacement::NUMANodes : ThreadPlacement::None;
+			Parsed = Settings.Placement != ThreadPlacement::None || std::strcmp(Mode, "none") == 0;
+		}
+		else if (std::strcmp(Argv[i], "--numa-nodes") == 0)
+		{
+			Parsed = ParseUnsigned(i, Argc, Argv, Settings.NUMANodeLimit);
+		}
+		else if (std::strcmp(Argv[i], "--progressive") == 0)
+		{
+			Parsed = ParseUnsigned(i, Argc, Argv, Settings.ProgressivePassSamples);
+		}
+		else if (std::strcmp(Argv[i], "--snapshots") == 0)
+		{
+			ShouldWriteSnapshots = true;
+		}
+		else if (std::strcmp(Argv[i], "--time-limit") == 0)
+		{
+			Parsed = ParseUnsigned(i, Argc, Argv, TimeLimitSeconds);
+		}
+		else if (std::strcmp(Argv[i], "--adaptive") == 0)
+		{
+			Parsed = ParsePositiveFloat(i, Argc, Argv, Settings.AdaptiveThreshold);
+		}
+		else if (std::strcmp(Argv[i], "--min-samples") == 0)
+		{
+			Parsed = ParseUnsigned(i, Argc, Argv, Settings.AdaptiveMinSamples);
+		}
+		else if (std::strcmp(Argv[i], "--max-samples") == 0)
+		{
+			Parsed = ParseUnsigned(i, Argc, Argv, Settings.AdaptiveMaxSamples);
+		}
+		else if (std::strcmp(Argv[i], "--heatmap") == 0 && i + 1 < Argc)
+		{
+			HeatmapPath = Argv[++i];
+		}
+		else if (std::strcmp(Argv[i], "--roulette") == 0)
+		{
+			Parsed = ParseUnsigned(i, Argc, Argv, Settings.RouletteMinDepth);
+		}
+		else if (std::strcmp(Argv[i], "--sampler") == 0 && i + 1 < Argc)
+		{
+			Parsed = VSampler::ParseSamplerName(Argv[++i], Settings.Sampler);
+		}
+		else if (std::strcmp(Argv[i], "--denoise") == 0)
+		{
+			Settings.Denoise = true;
+		}
+		else if (std::strcmp(Argv[i], "--denoise-iterations") == 0)
+		{
+			Parsed = ParseUnsigned(i, Argc, Argv, Settings.DenoiserSettings.Iterations);
+		}
+		else if (std::strcmp(Argv[i], "--aov") == 0 && i + 1 < Argc)
+		{
+			Parsed = VAOVBuffer::ParsePlaneList(Argv[++i], Settings.AOVs);
+		}
+		else if (std::strcmp(Argv[i], "--hdr") == 0 && i + 1 < Argc)
+		{
+			HDRPath = Argv[++i];
+		}
+		else if (std::strcmp(Argv[i], "--scene-density") == 0)
+		{
+			Parsed = ParseUnsigned(i, Argc, Argv, Settings.SceneDensity);
+		}
+		else if (std::strcmp(Argv[i], "--scene") == 0 && i + 1 < Argc)
+		{
+			ScenePath = Argv[++i];
+		}
+		else if (std::strcmp(Argv[i], "--save-scene") == 0 && i + 1 < Argc)
+		{
+			SaveScenePath = Argv[++i];
+		}
+		else if (std::strcmp(Argv[i], "--no-render") == 0)
+		{
+			ShouldRender = false;
+		}
+		else if (std::strcmp(Argv[i], "--perf-counters") == 0)
+		{
+			Settings.CollectPerfCounters = true;
+		}
+		else if (std::strcmp(Argv[i], "--trace") == 0 && i + 1 < Argc)
+		{
+			TracePath = Argv[++i];
+		}
+		else if (std::strcmp(Argv[i], "--seed") == 0 && i + 1 < Argc)
+		{
+			const char* Seed = Argv[++i];
+			char* End = nullptr;
+			Settings.Seed = std::strcmp(Seed, "random") == 0 ? ((uint64_t)std::random_device()() << 32u) | std::random_device()() : std::strtoull(Seed, &End, 10);
+			Parsed = End == nullptr || (End != Seed && *End == '\0');
+		}
+		else if (std::strcmp(Argv[i], "--worker-stats") == 0)
+		{
+			ShouldPrintWorkerStats = true;
+		}
+		else if (std::strcmp(Argv[i], "--render-stats") == 0)
+		{
+			ShouldPrintRenderStats = true;
+		}
+		else if (std::strcmp(Argv[i], "--isa") == 0 && i + 1 < Argc)
+		{
+			ISALevel Level;
+			Parsed = CPUDispatch::ParseISAName(Argv[++i], Level);
+			if (Parsed && !CPUDispatch::SetActiveISA(Level))
+			{
+				std::cerr << "This CPU does not support " << Argv[i] << ", the best it can do is " << CPUDispatch::GetISAName(CPUDispatch::GetSupportedISA()) << '\n';
+				return 1;
+			}
+		}
+		else if (std::strcmp(Argv[i], "--help") == 0)
+		{
+			PrintUsage(Argv[0]);
+			return 0;
+		}
+		else
+		{
+			Parsed = false;
+		}
+
+		if (!Parsed)
+		{
+			std::cerr << "Invalid argument: " << Argv[i] << '\n';
+			PrintUsage(Argv[0]);
+			return 1;
+		}
+	}
+	Settings.ThreadCount = ThreadCount;
+	//Before the core exists, so the pool workers and the first-touch pass are on the timeline too
+	if (!TracePath.empty())
+	{
+		VTraceRecorder::SetThreadName("Main");
+		VTraceRecorder::Enable();
+	}
+
+	RenderCore Core(Settings);
+	bool WasInitialized = false;
+	{
+		VProfileZone InitializeZone("Initialize");
+		WasInitialized = Core.Initialize();
+	}
+	if (!WasInitialized)
+	{
+		std::cerr << "Failed to initialize the render core!\n";
+		return 1;
+	}
+
+	if (!ScenePath.empty())
+	{
+		VTimer LoadTimer;
+		LoadTimer.Start();
+		std::string Error;
+		SceneTextStats TextStats;
+		if (!Core.LoadWorld(ScenePath, &Error, &TextStats))
+		{
+			std::cerr << "Failed to load the scene: " << Error << '\n';
+			return 1;
+		}
+		LoadTimer.Stop();
+		std::cout << "Loaded " << Core.GetWorld()->GetNumObjects() << " spheres from " << ScenePath << " in " << (double)LoadTimer.GetLastDurationUs() / 1000.0 << " ms"
+			<< (Core.GetWorld()->GetBVH().IsBuilt() ? ", BVH included" : "") << '\n';
+		if (TextStats.Chunks > 0)
+		{
+			std::cout << "Parsed " << (double)TextStats.Bytes / 1e6 << " MB, " << TextStats.Lines << " lines in " << TextStats.ParseMs << " ms: " << TextStats.GetMBPerSecond()
+				<< " MB/s over " << TextStats.Chunks << " chunks\n";
+		}
+	}
+	if (!SaveScenePath.empty())
+	{
+		std::string Error;
+		if (!Core.SaveWorld(SaveScenePath, &Error))
+		{
+			std::cerr << "Failed to save the scene: " << Error << '\n';
+			return 1;
+		}
+		std::cout << "Saved " << Core.GetWorld()->GetNumObjects() << " spheres to " << SaveScenePath << '\n';
+	}
+	if (!ShouldRender)
+	{
+		VProfiler::PrintSummary(std::cout);
+		return 0;
+	}
+
+	if (!HDRPath.empty())
+	{
+		std::string Error;
+		if (!Core.OpenHDROutput(HDRPath, &Error))
+		{
+			std::cerr << "Failed to open the HDR output: " << Error << '\n';
+			return 1;
+		}
+	}
+	std::cout << "Threads: " << Core.GetThreadPool()->GetThreadCount() << " (" << Core.GetThreadPool()->GetThreadCountReason() << ")\n";
+	std::cout << "ISA: " << CPUDispatch::GetISAName(CPUDispatch::GetActiveISA()) << " (sphere kernel " << SphereKernels::GetKernelName() << ")\n";
+	std::cout << "Rendering " << Settings.Width << "x" << Settings.Height << ", " << Settings.SampleCount << " spp, depth " << Settings.MaxDepth << ", seed " << Settings.Seed << ", " << VSampler::GetSamplerName(Settings.Sampler) << " sampler...\n";
+	const bool IsAdaptive = Settings.AdaptiveThreshold > 0.f;
+	const bool IsProgressive = Settings.ProgressivePassSamples > 0 || IsAdaptive;
+	bool WasSnapshotWritten = true;
+	Core.RenderFrameBuffer(nullptr, [&](const ProgressivePass& Pass)
+	{
+		if (!IsProgressive)
+		{
+			return true;
+		}
+		std::cout << "Pass " << Pass.PassIndex + 1 << "/" << Pass.PassCount << ": " << Pass.SamplesSoFar << " spp after " << Pass.ElapsedMs / 1000.0 << " seconds";
+		if (IsAdaptive)
+		{
+			std::cout << ", " << Pass.ActivePixels << " pixels still sampling";
+		}
+		std::cout << '\n';
+		if (ShouldWriteSnapshots)
+		{
+			WasSnapshotWritten = ImageWriter::WritePPM(GetSnapshotPath(OutputPath, Pass.PassIndex), Pass.Snapshot, Core.GetWidth(), Core.GetHeight()) && WasSnapshotWritten;
+		}
+		return TimeLimitSeconds == 0 || Pass.ElapsedMs < TimeLimitSeconds * 1000.0;
+	});
+	std::cout << "Render Complete! Time used: " << (double)Core.GetLastRenderTime() / 1000.0 << " seconds\n";
+	if (Settings.Denoise)
+	{
+		std::cout << "Denoised in " << Core.GetLastDenoiseTime() / 1000.0 << " seconds\n";
+	}
+	if (IsProgressive)
+	{
+		std::cout << "Time to first image: " << Core.GetTimeToFirstImage() / 1000.0 << " seconds, " << Core.GetAccumulatedSamples() << " spp accumulated\n";
+	}
+	if (IsAdaptive)
+	{
+		const size_t PixelCount = (size_t)Core.GetWidth() * Core.GetHeight();
+		const uint32_t* SampleCounts = Core.GetSampleCounts();
+		unsigned long long TotalSamples = 0;
+		uint32_t MaxSamples = 0;
+		for (size_t i = 0; i < PixelCount; i++)
+		{
+			TotalSamples += SampleCounts[i];
+			MaxSamples = std::max(MaxSamples, SampleCounts[i]);
+		}
+		const double AverageSamples = PixelCount > 0 ? (double)TotalSamples / (double)PixelCount : 0.0;
+		std::cout << "Adaptive sampling: " << AverageSamples << " spp on average, most samples in one pixel " << MaxSamples << ", "
+			<< 100.0 * (1.0 - AverageSamples / (double)Settings.SampleCount) << "% fewer samples than a fixed " << Settings.SampleCount << " spp\n";
+		if (!HeatmapPath.empty() && !ImageWriter::WriteSampleHeatmapPPM(HeatmapPath, SampleCounts, Core.GetWidth(), Core.GetHeight(), MaxSamples))
+		{
+			std::cerr << "Failed to write " << HeatmapPath << '\n';
+		}
+	}
+	if (!WasSnapshotWritten)
+	{
+		std::cerr << "Failed to write some of the pass snapshots\n";
+	}
+	if (ShouldPrintWorkerStats)
+	{
+		PrintWorkerStats(Core);
+	}
+	if (Settings.CollectTraversalStats)
+	{
+		PrintTraversalStats(Core);
+	}
+	if (ShouldPrintRenderStats)
+	{
+		PrintRenderStats(Core, Settings.MaxDepth);
+	}
+
+	std::cout << "Image hash: " << std::hex << HashFrameBuffer(Core.GetFrameBuffer(), (size_t)Core.GetWidth() * Core.GetHeight() * 4) << std::dec << '\n';
+	bool WasImageWritten = false;
+	PerfCounterValues WriteImageCounters;
+	{
+		VProfileZone WriteZone("WriteImage");
+		//Output runs on this thread after the render, so it gets a group of its own rather than the core's
+		VPerfCounterGroup WriteCounters;
+		if (Settings.CollectPerfCounters)
+		{
+			WriteCounters.Open();
+		}
+		WasImageWritten = ImageWriter::WritePPM(OutputPath, Core.GetFrameBuffer(), Core.GetWidth(), Core.GetHeight());
+		if (Settings.AOVs != 0 && !ImageWriter::WriteAOVs(OutputPath, Core.GetAOVs()))
+		{
+			std::cerr << "Failed to write the AOV planes next to " << OutputPath << '\n';
+			WasImageWritten = false;
+		}
+		WriteImageCounters = WriteCounters.Read();
+	}
+	if (!WasImageWritten)
+	{
+		std::cerr << "Failed to write " << OutputPath << '\n';
+		return 1;
+	}
+	std::cout << "Wrote " << OutputPath << '\n';
+	if (!HDRPath.empty())
+	{
+		std::string Error;
+		if (!Core.CloseHDROutput(&Error))
+		{
+			std::cerr << "Failed to write the HDR output: " << Error << '\n';
+			return 1;
+		}
+		std::cout << "Wrote " << HDRPath << " while rendering\n";
+	}
+	if (Settings.CollectPerfCounters)
+	{
+		PrintPerfCounters(Core, WriteImageCounters);
+	}
+	VProfiler::PrintSummary(std::cout);
+	if (!TracePath.empty())
+	{
+		//Workers still asleep in the pool have an open Wait event, those are simply not in the file
+		size_t EventCount = 0;
+		size_t DroppedCount = 0;
+		if (!VTraceRecorder::WriteChromeTrace(TracePath, &EventCount, &DroppedCount))
+		{
+			std::cerr << "Failed to write " << TracePath << '\n';
+			return 1;
+		}
+		std::cout << "Wrote " << TracePath << " (" << EventCount << " events";
+		if (DroppedCount > 0)
+		{
+			std::cout << ", " << DroppedCount << " older events overwritten";
+		}
+		std::cout << ")\n";
+	}
+	return 0;
+}
@@ -0,0 +1,82 @@
+#include "Public/AOVBuffer.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace
+{
+	template<typename T>
+	void ResizePlane(AlignedVector<T>& Plane, bool IsWanted, size_t PixelCount)
+	{
+		if (IsWanted)
+		{
+			Plane.resize(PixelCount);
+		}
+		else
+		{
+			Plane.clear();
+			Plane.shrink_to_fit();
+		}
+	}
+
+	const uint32_t g_Planes[] = { AOVPlane::Distance, AOVPlane::Normal, AOVPlane::Albedo, AOVPlane::ObjectID, AOVPlane::Material };
+}
+
+void VAOVBuffer::Allocate(unsigned int Width, unsigned int Height, uint32_t Planes)
+{
+	m_Width = Width;
+	m_Height = Height;
+	m_Planes = Planes & AOVPlane::All;
+	const size_t PixelCount = (size_t)Width * Height;
+	ResizePlane(m_Distance, Has(AOVPlane::Distance), PixelCount);
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		ResizePlane(m_Normal[i], Has(AOVPlane::Normal), PixelCount);
+		ResizePlane(m_Albedo[i], Has(AOVPlane::Albedo), PixelCount);
+	}
+	ResizePlane(m_ObjectID, Has(AOVPlane::ObjectID), PixelCount);
+	ResizePlane(m_Material, Has(AOVPlane::Material), PixelCount);
+}
+
+const char* VAOVBuffer::GetPlaneName(uint32_t Plane)
+{
+	switch (Plane)
+	{
+	case AOVPlane::Distance:
+		return "distance";
+	case AOVPlane::Normal:
+		return "normal";
+	case AOVPlane::Albedo:
+		return "albedo";
+	case AOVPlane::ObjectID:
+		return "id";
+	case AOVPlane::Material:
+		return "material";
+	default:
+		return "unknown";
+	}
+}
+
+bool VAOVBuffer::ParsePlaneList(const char* List, uint32_t& OutPlanes)
+{
+	OutPlanes = 0;
+	const std::string Names(List);
+	size_t Start = 0;
+	while (Start <= Names.size())
+	{
+		const size_t End = std::min(Names.find(',', Start), Names.size());
+		const std::string Name = Names.substr(Start, End - Start);
+		uint32_t Plane = Name == "all" ? AOVPlane::All : 0;
+		for (uint32_t Candidate : g_Planes)
+		{
+			Plane = Name == GetPlaneName(Candidate) ? Candidate : Plane;
+		}
+		if (Plane == 0)
+		{
+			return false;
+		}
+		OutPlanes |= Plane;
+		Start = End + 1;
+	}
+	return OutPlanes != 0;
+}
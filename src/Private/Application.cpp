@@ -22,6 +22,7 @@ Application::Application() : m_WindowClass(WNDCLASS{}), m_WindowHandle(NULL), m_
 	m_Resolutions = { {640, 480}, {800, 600}, {1024, 768}, {1280, 720}, {1920, 1080}, {2560, 1440} };
 	m_SampleCounts = { 3, 5, 10, 15, 20, 50, 75, 100, 150, 200, 500 };
 	m_MaxDepths = { 5, 10, 15, 25, 50 };
+	m_RouletteMinDepths = { 0, 3, 5, 10 };
 
 }
 
@@ -104,7 +105,7 @@ bool Application::Initialize(HINSTANCE InhInstance, int InpCmdShow)
 	if (m_RendererType == RenderType::Software)
 	{
 		m_SoftwareRenderer = std::make_unique<SoftwareRenderer>(m_Width, m_Height, AspectRatio);
-		bool Result = m_SoftwareRenderer->Initialize(m_WindowHandle, m_SampleCount, m_MaxDepth);
+		bool Result = m_SoftwareRenderer->Initialize(m_WindowHandle, m_SampleCount, m_MaxDepth, m_RouletteMinDepth);
 		if (!Result)
 		{
 			return false;
@@ -113,7 +114,7 @@ bool Application::Initialize(HINSTANCE InhInstance, int InpCmdShow)
 	else
 	{
 		m_HardwareRenderer = std::make_unique<HardwareRenderer>(m_Width, m_Height, AspectRatio);
-		bool Result = m_HardwareRenderer->Intialize(m_WindowHandle, m_SampleCount, m_MaxDepth);
+		bool Result = m_HardwareRenderer->Intialize(m_WindowHandle, m_SampleCount, m_MaxDepth, m_RouletteMinDepth);
 		if (!Result)
 		{
 			return false;
@@ -385,6 +386,22 @@ long long Application::SettingsDialogProc(HWND hDlg, UINT uMsg, WPARAM wParam, L
 			SendMessageW(ComboListHandle, CB_ADDSTRING, 0, (LPARAM)ListContents.data());
 		}
 		SendMessageW(ComboListHandle, CB_SETCURSEL, 2, 0);//Set default selection to 15 max depth	
+		//Initialize russian roulette combo list
+		ComboListHandle = GetDlgItem(hDlg, IDC_COMBO_ROULETTE);
+		ListContents.clear();
+		for (const unsigned int RouletteMinDepth : AppPtr->m_RouletteMinDepths)
+		{
+			if (RouletteMinDepth == 0)
+			{
+				ListContents = L"Off";
+			}
+			else
+			{
+				ListContents = std::format(L"{}", RouletteMinDepth);
+			}
+			SendMessageW(ComboListHandle, CB_ADDSTRING, 0, (LPARAM)ListContents.data());
+		}
+		SendMessageW(ComboListHandle, CB_SETCURSEL, 0, 0);//Set default selection to no russian roulette
 		return TRUE;
 
 	}
@@ -415,12 +432,14 @@ long long Application::HandleSettingsDialogMessage(HWND hDlg, UINT uMsg, WPARAM
 					size_t RenderTypeIndex = SendMessageW(GetDlgItem(hDlg, IDC_RENDER_TYPE), CB_GETCURSEL, 0, 0);
 					size_t SampleCountIndex = SendMessageW(GetDlgItem(hDlg, IDC_COMBO_SAMPLE), CB_GETCURSEL, 0, 0);
 					size_t MaxDepthIndex = SendMessageW(GetDlgItem(hDlg, IDC_COMBO_DEPTH), CB_GETCURSEL, 0, 0);
+					size_t RouletteIndex = SendMessageW(GetDlgItem(hDlg, IDC_COMBO_ROULETTE), CB_GETCURSEL, 0, 0);
 					
 					m_Width = m_Resolutions[ResolutionIndex >= 0 ? ResolutionIndex : 0].first;
 					m_Height = m_Resolutions[ResolutionIndex >= 0 ? ResolutionIndex : 0].second;
 					m_RendererType = RenderType(RenderTypeIndex >= 0 ? RenderTypeIndex : 0);
 					m_SampleCount = m_SampleCounts[SampleCountIndex >= 0 ? SampleCountIndex : 0];
 					m_MaxDepth = m_MaxDepths[MaxDepthIndex >= 0 ? MaxDepthIndex : 0];
+					m_RouletteMinDepth = m_RouletteMinDepths[RouletteIndex >= 0 ? RouletteIndex : 0];
 					EndDialog(hDlg, TRUE);
 					return TRUE;
 				}
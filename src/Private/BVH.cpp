@@ -0,0 +1,341 @@
+#include "Public/BVH.h"
+#include "Public/HittableList.h"
+#include "Public/Timer.h"
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+	//Number of buckets the centroids are binned into when evaluating the SAH. 16 gets within a few percent of a full sweep at a fraction of the build cost
+	constexpr unsigned int g_SAHBinCount = 16;
+	//Cost of one node visit relative to one ray-sphere test
+	constexpr float g_TraversalCost = 1.f;
+	//Leaves above this size(or the kernel batch size, whichever is larger) are always split, no matter what the SAH says
+	constexpr unsigned int g_MaxLeafSize = 8;
+	//Leaves are forced past this depth so the traversal stack can never overflow
+	constexpr unsigned int g_MaxBuildDepth = 48;
+
+	inline float Component(const Vector3D& V, int Axis)
+	{
+		return Axis == 0 ? V.X : (Axis == 1 ? V.Y : V.Z);
+	}
+
+	inline Vector3D Min(const Vector3D& A, const Vector3D& B)
+	{
+		return Vector3D(std::min(A.X, B.X), std::min(A.Y, B.Y), std::min(A.Z, B.Z));
+	}
+
+	inline Vector3D Max(const Vector3D& A, const Vector3D& B)
+	{
+		return Vector3D(std::max(A.X, B.X), std::max(A.Y, B.Y), std::max(A.Z, B.Z));
+	}
+}
+
+void SphereBVH::Build(const std::vector<SphereTransformData>& Spheres, std::vector<unsigned int>& OutPrimitiveOrder, unsigned int LeafBatchSize)
+{
+	VTimer BuildTimer;
+	BuildTimer.Start();
+	Clear();
+	m_LeafBatchSize = std::max(1u, LeafBatchSize);
+
+	const unsigned int PrimitiveCount = (unsigned int)Spheres.size();
+	if (PrimitiveCount == 0)
+	{
+		OutPrimitiveOrder.clear();
+		return;
+	}
+
+	std::vector<BuildPrimitive> Primitives(PrimitiveCount);
+	for (unsigned int i = 0; i < PrimitiveCount; i++)
+	{
+		const Vector3D Extent(Spheres[i].SphereRadius, Spheres[i].SphereRadius, Spheres[i].SphereRadius);
+		Primitives[i].BoundsMin = Spheres[i].SphereCenter - Extent;
+		Primitives[i].BoundsMax = Spheres[i].SphereCenter + Extent;
+		Primitives[i].Centroid = Spheres[i].SphereCenter;
+	}
+	OutPrimitiveOrder.resize(PrimitiveCount);
+	std::iota(OutPrimitiveOrder.begin(), OutPrimitiveOrder.end(), 0u);
+
+	//A binary tree with N leaves has 2N - 1 nodes, plus the padding node after the root
+	m_Nodes.resize((size_t)PrimitiveCount * 2 + 1);
+	BVHNode& Root = m_Nodes[0];
+	Root.LeftFirst = 0;
+	Root.PrimitiveCount = PrimitiveCount;
+	m_NodesUsed = 2;
+	UpdateNodeBounds(0, Primitives, OutPrimitiveOrder);
+	Subdivide(0, 0, Primitives, OutPrimitiveOrder);
+	m_Nodes.resize(m_NodesUsed);
+	m_Nodes.shrink_to_fit();
+	GatherBuildStats();
+
+	BuildTimer.Stop();
+	m_BuildStats.BuildTimeMs = (double)BuildTimer.GetLastDurationUs() / 1000.0;
+}
+
+bool SphereBVH::Assign(const BVHNode* Nodes, unsigned int NodeCount, unsigned int PrimitiveCount)
+{
+	Clear();
+	if (NodeCount < 2 || PrimitiveCount == 0)
+	{
+		return false;
+	}
+
+	//Walk the tree once: every node must be reached exactly once, from a parent with a smaller index, and no deeper than the build would go
+	struct PendingNode
+	{
+		unsigned int NodeIndex;
+		unsigned int Depth;
+	};
+	std::vector<PendingNode> Pending;
+	Pending.push_back(PendingNode{ 0, 0 });
+	unsigned int MaxDepth = 0;
+	unsigned int ReachedCount = 0;
+	while (!Pending.empty())
+	{
+		const PendingNode Current = Pending.back();
+		Pending.pop_back();
+		const BVHNode& Node = Nodes[Current.NodeIndex];
+		MaxDepth = std::max(MaxDepth, Current.Depth);
+		//More visits than nodes means a node with two parents, stop before shared subtrees multiply the walk
+		if (++ReachedCount >= NodeCount || Current.Depth > g_MaxBuildDepth)
+		{
+			return false;
+		}
+		if (Node.IsLeaf())
+		{
+			if (Node.LeftFirst >= PrimitiveCount || Node.PrimitiveCount > PrimitiveCount - Node.LeftFirst)
+			{
+				return false;
+			}
+			continue;
+		}
+		//Sibling pairs start on even indices past the root and its padding node, see the class comment
+		if (Node.LeftFirst <= Current.NodeIndex || Node.LeftFirst < 2 || (Node.LeftFirst & 1u) != 0 || Node.LeftFirst + 1 >= NodeCount)
+		{
+			return false;
+		}
+		Pending.push_back(PendingNode{ Node.LeftFirst + 1, Current.Depth + 1 });
+		Pending.push_back(PendingNode{ Node.LeftFirst, Current.Depth + 1 });
+	}
+	//Strictly increasing child indices already rule out cycles. Every node but the padding one must have been reached
+	if (ReachedCount != NodeCount - 1)
+	{
+		return false;
+	}
+
+	m_Nodes.assign(Nodes, Nodes + NodeCount);
+	m_NodesUsed = NodeCount;
+	GatherBuildStats();
+	m_BuildStats.MaxDepth = MaxDepth;
+	return true;
+}
+
+void SphereBVH::GatherBuildStats()
+{
+	//The SAH cost of the whole tree is the sum over all nodes of area(node)/area(root) times the node's cost
+	const float RootArea = SurfaceArea(m_Nodes[0].BoundsMin, m_Nodes[0].BoundsMax);
+	m_BuildStats.NodeCount = m_NodesUsed - 1;
+	float TreeCost = 0.f;
+	for (unsigned int i = 0; i < m_NodesUsed; i++)
+	{
+		if (i == 1)
+		{
+			continue;
+		}
+		const BVHNode& Node = m_Nodes[i];
+		float RelativeArea = RootArea > 0.f ? SurfaceArea(Node.BoundsMin, Node.BoundsMax) / RootArea : 1.f;
+		if (Node.IsLeaf())
+		{
+			m_BuildStats.LeafCount++;
+			m_BuildStats.MaxLeafSize = std::max(m_BuildStats.MaxLeafSize, Node.PrimitiveCount);
+			TreeCost += RelativeArea * LeafCost(Node.PrimitiveCount);
+		}
+		else
+		{
+			TreeCost += RelativeArea * g_TraversalCost;
+		}
+	}
+	m_BuildStats.SAHCost = TreeCost;
+}
+
+void SphereBVH::Clear()
+{
+	m_Nodes.clear();
+	m_NodesUsed = 0;
+	m_BuildStats = BVHBuildStats{};
+}
+
+void SphereBVH::UpdateNodeBounds(unsigned int NodeIndex, const std::vector<BuildPrimitive>& Primitives, const std::vector<unsigned int>& PrimitiveOrder)
+{
+	BVHNode& Node = m_Nodes[NodeIndex];
+	Node.BoundsMin = Vector3D(Constants::g_Infinity, Constants::g_Infinity, Constants::g_Infinity);
+	Node.BoundsMax = -Node.BoundsMin;
+	for (unsigned int i = 0; i < Node.PrimitiveCount; i++)
+	{
+		const BuildPrimitive& Primitive = Primitives[PrimitiveOrder[Node.LeftFirst + i]];
+		Node.BoundsMin = Min(Node.BoundsMin, Primitive.BoundsMin);
+		Node.BoundsMax = Max(Node.BoundsMax, Primitive.BoundsMax);
+	}
+}
+
+float SphereBVH::FindBestSplit(const BVHNode& Node, const std::vector<BuildPrimitive>& Primitives, const std::vector<unsigned int>& PrimitiveOrder, int& OutAxis, float& OutSplitPos) const
+{
+	struct Bin
+	{
+		Vector3D BoundsMin = Vector3D(Constants::g_Infinity, Constants::g_Infinity, Constants::g_Infinity);
+		Vector3D BoundsMax = Vector3D(-Constants::g_Infinity, -Constants::g_Infinity, -Constants::g_Infinity);
+		unsigned int Count = 0;
+	};
+
+	float BestCost = Constants::g_Infinity;
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		//Bin by centroid, not by box, so large spheres(like the ground) do not stretch the bins
+		float CentroidMin = Constants::g_Infinity;
+		float CentroidMax = -Constants::g_Infinity;
+		for (unsigned int i = 0; i < Node.PrimitiveCount; i++)
+		{
+			float Centroid = Component(Primitives[PrimitiveOrder[Node.LeftFirst + i]].Centroid, Axis);
+			CentroidMin = std::min(CentroidMin, Centroid);
+			CentroidMax = std::max(CentroidMax, Centroid);
+		}
+		if (CentroidMax <= CentroidMin)
+		{
+			continue;
+		}
+
+		Bin Bins[g_SAHBinCount];
+		const float Scale = (float)g_SAHBinCount / (CentroidMax - CentroidMin);
+		for (unsigned int i = 0; i < Node.PrimitiveCount; i++)
+		{
+			const BuildPrimitive& Primitive = Primitives[PrimitiveOrder[Node.LeftFirst + i]];
+			unsigned int BinIndex = std::min(g_SAHBinCount - 1, (unsigned int)((Component(Primitive.Centroid, Axis) - CentroidMin) * Scale));
+			Bins[BinIndex].Count++;
+			Bins[BinIndex].BoundsMin = Min(Bins[BinIndex].BoundsMin, Primitive.BoundsMin);
+			Bins[BinIndex].BoundsMax = Max(Bins[BinIndex].BoundsMax, Primitive.BoundsMax);
+		}
+
+		//Sweep from both sides so every split plane between bins is evaluated in O(bins)
+		float LeftArea[g_SAHBinCount - 1];
+		float RightArea[g_SAHBinCount - 1];
+		unsigned int LeftCount[g_SAHBinCount - 1];
+		unsigned int RightCount[g_SAHBinCount - 1];
+		Bin LeftBox;
+		Bin RightBox;
+		unsigned int LeftSum = 0;
+		unsigned int RightSum = 0;
+		for (unsigned int i = 0; i < g_SAHBinCount - 1; i++)
+		{
+			LeftSum += Bins[i].Count;
+			LeftCount[i] = LeftSum;
+			LeftBox.BoundsMin = Min(LeftBox.BoundsMin, Bins[i].BoundsMin);
+			LeftBox.BoundsMax = Max(LeftBox.BoundsMax, Bins[i].BoundsMax);
+			LeftArea[i] = LeftSum > 0 ? SurfaceArea(LeftBox.BoundsMin, LeftBox.BoundsMax) : 0.f;
+
+			const unsigned int j = g_SAHBinCount - 1 - i;
+			RightSum += Bins[j].Count;
+			RightCount[j - 1] = RightSum;
+			RightBox.BoundsMin = Min(RightBox.BoundsMin, Bins[j].BoundsMin);
+			RightBox.BoundsMax = Max(RightBox.BoundsMax, Bins[j].BoundsMax);
+			RightArea[j - 1] = RightSum > 0 ? SurfaceArea(RightBox.BoundsMin, RightBox.BoundsMax) : 0.f;
+		}
+
+		const float BinWidth = (CentroidMax - CentroidMin) / (float)g_SAHBinCount;
+		for (unsigned int i = 0; i < g_SAHBinCount - 1; i++)
+		{
+			if (LeftCount[i] == 0 || RightCount[i] == 0)
+			{
+				continue;
+			}
+			float Cost = LeafCost(LeftCount[i]) * LeftArea[i] + LeafCost(RightCount[i]) * RightArea[i];
+			if (Cost < BestCost)
+			{
+				BestCost = Cost;
+				OutAxis = Axis;
+				OutSplitPos = CentroidMin + BinWidth * (float)(i + 1);
+			}
+		}
+	}
+	return BestCost;
+}
+
+void SphereBVH::Subdivide(unsigned int NodeIndex, unsigned int Depth, std::vector<BuildPrimitive>& Primitives, std::vector<unsigned int>& PrimitiveOrder)
+{
+	m_BuildStats.MaxDepth = std::max(m_BuildStats.MaxDepth, Depth);
+	BVHNode& Node = m_Nodes[NodeIndex];
+	if (Node.PrimitiveCount <= 1 || Depth >= g_MaxBuildDepth)
+	{
+		return;
+	}
+
+	int Axis = -1;
+	float SplitPos = 0.f;
+	float SplitCost = FindBestSplit(Node, Primitives, PrimitiveOrder, Axis, SplitPos);
+	if (Axis < 0)
+	{
+		//Every centroid is in the same spot, nothing to split on
+		return;
+	}
+
+	//Both costs are in area * primitive units, the leaf cost is what we pay for testing every sphere in this node
+	const float NodeArea = SurfaceArea(Node.BoundsMin, Node.BoundsMax);
+	const float NoSplitCost = LeafCost(Node.PrimitiveCount) * NodeArea;
+	SplitCost += g_TraversalCost * NodeArea;
+	if (SplitCost >= NoSplitCost && Node.PrimitiveCount <= std::max(g_MaxLeafSize, m_LeafBatchSize))
+	{
+		return;
+	}
+
+	//Partition the primitive order in place around the split plane
+	unsigned int i = Node.LeftFirst;
+	unsigned int j = i + Node.PrimitiveCount - 1;
+	while (i <= j)
+	{
+		if (Component(Primitives[PrimitiveOrder[i]].Centroid, Axis) < SplitPos)
+		{
+			i++;
+		}
+		else
+		{
+			std::swap(PrimitiveOrder[i], PrimitiveOrder[j]);
+			if (j == 0)
+			{
+				break;
+			}
+			j--;
+		}
+	}
+
+	const unsigned int LeftCount = i - Node.LeftFirst;
+	if (LeftCount == 0 || LeftCount == Node.PrimitiveCount)
+	{
+		return;
+	}
+
+	//Children are allocated as a pair right next to each other
+	const unsigned int LeftChild = m_NodesUsed;
+	m_NodesUsed += 2;
+	m_Nodes[LeftChild].LeftFirst = Node.LeftFirst;
+	m_Nodes[LeftChild].PrimitiveCount = LeftCount;
+	m_Nodes[LeftChild + 1].LeftFirst = i;
+	m_Nodes[LeftChild + 1].PrimitiveCount = Node.PrimitiveCount - LeftCount;
+	Node.LeftFirst = LeftChild;
+	Node.PrimitiveCount = 0;
+
+	UpdateNodeBounds(LeftChild, Primitives, PrimitiveOrder);
+	UpdateNodeBounds(LeftChild + 1, Primitives, PrimitiveOrder);
+	Subdivide(LeftChild, Depth + 1, Primitives, PrimitiveOrder);
+	Subdivide(LeftChild + 1, Depth + 1, Primitives, PrimitiveOrder);
+}
+
+//Number of kernel batches needed to test PrimitiveCount spheres. With the scalar kernel this is just the sphere count
+float SphereBVH::LeafCost(unsigned int PrimitiveCount) const
+{
+	return (float)((PrimitiveCount + m_LeafBatchSize - 1) / m_LeafBatchSize);
+}
+
+float SphereBVH::SurfaceArea(const Vector3D& BoundsMin, const Vector3D& BoundsMax)
+{
+	const Vector3D Extent = BoundsMax - BoundsMin;
+	return 2.f * (Extent.X * Extent.Y + Extent.Y * Extent.Z + Extent.Z * Extent.X);
+}
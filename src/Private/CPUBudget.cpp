@@ -0,0 +1,344 @@
+#include "Public/CPUBudget.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#elif defined(_WIN32)
+//This file calls std::min/std::max, keep <Windows.h> from defining them as macros even when built outside CMake
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#endif
+
+namespace
+{
+#ifdef __linux__
+	struct CgroupMount
+	{
+		std::string MountPoint;
+		//The part of the cgroup tree that is mounted there, "/" outside of containers
+		std::string Root;
+	};
+
+	bool HasOption(const std::string& Options, const char* Option)
+	{
+		std::stringstream Stream(Options);
+		std::string Token;
+		while (std::getline(Stream, Token, ','))
+		{
+			if (Token == Option)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//Find the cgroup v2 mount and the v1 mount that has the cpu controller
+	void FindCgroupMounts(CgroupMount& OutV2, CgroupMount& OutV1)
+	{
+		std::ifstream MountInfo("/proc/self/mountinfo");
+		std::string Line;
+		while (std::getline(MountInfo, Line))
+		{
+			//Format: ID ParentID Major:Minor Root MountPoint Options [Optional fields...] - FSType Source SuperOptions
+			const size_t Separator = Line.find(" - ");
+			if (Separator == std::string::npos)
+			{
+				continue;
+			}
+			std::stringstream Head(Line.substr(0, Separator));
+			std::stringstream Tail(Line.substr(Separator + 3));
+			std::string ID, ParentID, Device, Root, MountPoint, FSType, Source, SuperOptions;
+			Head >> ID >> ParentID >> Device >> Root >> MountPoint;
+			Tail >> FSType >> Source >> SuperOptions;
+			if (FSType == "cgroup2" && OutV2.MountPoint.empty())
+			{
+				OutV2 = CgroupMount{ MountPoint, Root };
+			}
+			else if (FSType == "cgroup" && OutV1.MountPoint.empty() && HasOption(SuperOptions, "cpu"))
+			{
+				OutV1 = CgroupMount{ MountPoint, Root };
+			}
+		}
+	}
+
+	//Our cgroup path for the v2 hierarchy("0::/path") and for the v1 hierarchy holding the cpu controller("N:cpu,cpuacct:/path")
+	void FindOwnCgroups(std::string& OutV2Path, std::string& OutV1Path)
+	{
+		std::ifstream Cgroups("/proc/self/cgroup");
+		std::string Line;
+		while (std::getline(Cgroups, Line))
+		{
+			const size_t FirstColon = Line.find(':');
+			const size_t SecondColon = Line.find(':', FirstColon + 1);
+			if (FirstColon == std::string::npos || SecondColon == std::string::npos)
+			{
+				continue;
+			}
+			const std::string Controllers = Line.substr(FirstColon + 1, SecondColon - FirstColon - 1);
+			const std::string Path = Line.substr(SecondColon + 1);
+			if (Line.compare(0, FirstColon, "0") == 0 && Controllers.empty())
+			{
+				OutV2Path = Path;
+			}
+			else if (HasOption(Controllers, "cpu"))
+			{
+				OutV1Path = Path;
+			}
+		}
+	}
+
+	/*
+	* Every directory from our own cgroup up to the mount point, deepest first
+	* Inside a container the path in /proc/self/cgroup is often relative to the host's root and does not exist in our mount namespace, in that case only the mount point is checked
+	*/
+	std::vector<std::string> GetCgroupDirectories(const CgroupMount& Mount, std::string Path)
+	{
+		std::vector<std::string> Directories;
+		if (Mount.Root != "/" && Path.compare(0, Mount.Root.size(), Mount.Root) == 0)
+		{
+			Path = Path.substr(Mount.Root.size());
+		}
+		while (!Path.empty() && Path != "/")
+		{
+			if (std::ifstream(Mount.MountPoint + Path + "/cgroup.procs").good())
+			{
+				Directories.push_back(Mount.MountPoint + Path);
+			}
+			const size_t LastSlash = Path.find_last_of('/');
+			Path = LastSlash == std::string::npos ? std::string() : Path.substr(0, LastSlash);
+		}
+		Directories.push_back(Mount.MountPoint);
+		return Directories;
+	}
+
+	//cpu.max holds "max 100000" or "<quota> <period>"
+	double ReadQuotaV2(const std::string& Directory)
+	{
+		std::ifstream File(Directory + "/cpu.max");
+		std::string Quota;
+		double Period = 0.0;
+		if (!(File >> Quota >> Period) || Quota == "max" || Period <= 0.0)
+		{
+			return 0.0;
+		}
+		char* End = nullptr;
+		const double QuotaValue = std::strtod(Quota.c_str(), &End);
+		return End != Quota.c_str() && QuotaValue > 0.0 ? QuotaValue / Period : 0.0;
+	}
+
+	//cpu.cfs_quota_us is -1 when there is no limit
+	double ReadQuotaV1(const std::string& Directory)
+	{
+		std::ifstream QuotaFile(Directory + "/cpu.cfs_quota_us");
+		std::ifstream PeriodFile(Directory + "/cpu.cfs_period_us");
+		double Quota = 0.0;
+		double Period = 0.0;
+		if (!(QuotaFile >> Quota) || !(PeriodFile >> Period) || Quota <= 0.0 || Period <= 0.0)
+		{
+			return 0.0;
+		}
+		return Quota / Period;
+	}
+
+	//The tightest quota along the path wins, 0 if no level has one
+	double ReadTightestQuota(const CgroupMount& Mount, const std::string& Path, double(*ReadQuota)(const std::string&))
+	{
+		double Tightest = 0.0;
+		if (Mount.MountPoint.empty())
+		{
+			return Tightest;
+		}
+		for (const std::string& Directory : GetCgroupDirectories(Mount, Path))
+		{
+			const double Quota = ReadQuota(Directory);
+			if (Quota > 0.0 && (Tightest == 0.0 || Quota < Tightest))
+			{
+				Tightest = Quota;
+			}
+		}
+		return Tightest;
+	}
+	//Parse a kernel CPU list such as "0-3,8-11"
+	std::vector<unsigned int> ParseCPUList(const std::string& List)
+	{
+		std::vector<unsigned int> CPUs;
+		std::stringstream Stream(List);
+		std::string Range;
+		while (std::getline(Stream, Range, ','))
+		{
+			unsigned int First = 0;
+			unsigned int Last = 0;
+			const int Matched = std::sscanf(Range.c_str(), "%u-%u", &First, &Last);
+			if (Matched < 1)
+			{
+				continue;
+			}
+			if (Matched == 1)
+			{
+				Last = First;
+			}
+			for (unsigned int CPU = First; CPU <= Last; CPU++)
+			{
+				CPUs.push_back(CPU);
+			}
+		}
+		return CPUs;
+	}
+#endif
+}
+
+CPUBudgetInfo CPUBudget::Detect()
+{
+	CPUBudgetInfo Info;
+	Info.HardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	Info.AffinityThreads = Info.HardwareThreads;
+
+#ifdef __linux__
+	cpu_set_t AffinityMask;
+	CPU_ZERO(&AffinityMask);
+	if (sched_getaffinity(0, sizeof(AffinityMask), &AffinityMask) == 0)
+	{
+		Info.AffinityThreads = std::max(1, CPU_COUNT(&AffinityMask));
+	}
+
+	CgroupMount V2Mount;
+	CgroupMount V1Mount;
+	std::string V2Path;
+	std::string V1Path;
+	FindCgroupMounts(V2Mount, V1Mount);
+	FindOwnCgroups(V2Path, V1Path);
+	//A hybrid setup mounts both, the cpu controller can only be attached to one of them
+	Info.QuotaCPUs = ReadTightestQuota(V2Mount, V2Path, &ReadQuotaV2);
+	Info.QuotaSource = "cgroup v2";
+	if (Info.QuotaCPUs == 0.0)
+	{
+		Info.QuotaCPUs = ReadTightestQuota(V1Mount, V1Path, &ReadQuotaV1);
+		Info.QuotaSource = "cgroup v1";
+	}
+	if (Info.QuotaCPUs == 0.0)
+	{
+		Info.QuotaSource = "";
+	}
+#endif
+
+	Info.AvailableThreads = Info.AffinityThreads;
+	if (Info.QuotaCPUs > 0.0)
+	{
+		//Round down: a quota of 2.5 CPUs with 3 busy threads gets throttled every period
+		Info.AvailableThreads = std::min(Info.AvailableThreads, std::max(1u, (unsigned int)std::floor(Info.QuotaCPUs)));
+	}
+	return Info;
+}
+
+std::vector<unsigned int> CPUBudget::GetAffinityCPUs()
+{
+	std::vector<unsigned int> CPUs;
+#ifdef __linux__
+	cpu_set_t AffinityMask;
+	CPU_ZERO(&AffinityMask);
+	if (sched_getaffinity(0, sizeof(AffinityMask), &AffinityMask) == 0)
+	{
+		for (unsigned int CPU = 0; CPU < CPU_SETSIZE; CPU++)
+		{
+			if (CPU_ISSET(CPU, &AffinityMask))
+			{
+				CPUs.push_back(CPU);
+			}
+		}
+	}
+#endif
+	if (CPUs.empty())
+	{
+		for (unsigned int CPU = 0; CPU < std::max(1u, std::thread::hardware_concurrency()); CPU++)
+		{
+			CPUs.push_back(CPU);
+		}
+	}
+	return CPUs;
+}
+
+std::vector<NUMANodeInfo> CPUBudget::DetectNUMANodes()
+{
+	const std::vector<unsigned int> AffinityCPUs = GetAffinityCPUs();
+	std::vector<NUMANodeInfo> Nodes;
+#ifdef __linux__
+	if (DIR* NodeDirectory = opendir("/sys/devices/system/node"))
+	{
+		while (dirent* Entry = readdir(NodeDirectory))
+		{
+			unsigned int NodeNumber = 0;
+			char Trailing = 0;
+			if (std::sscanf(Entry->d_name, "node%u%c", &NodeNumber, &Trailing) != 1)
+			{
+				continue;
+			}
+			std::ifstream CPUListFile(std::string("/sys/devices/system/node/") + Entry->d_name + "/cpulist");
+			std::string CPUList;
+			std::getline(CPUListFile, CPUList);
+
+			NUMANodeInfo Node;
+			Node.Node = NodeNumber;
+			for (unsigned int CPU : ParseCPUList(CPUList))
+			{
+				if (std::binary_search(AffinityCPUs.begin(), AffinityCPUs.end(), CPU))
+				{
+					Node.CPUs.push_back(CPU);
+				}
+			}
+			if (!Node.CPUs.empty())
+			{
+				Nodes.push_back(std::move(Node));
+			}
+		}
+		closedir(NodeDirectory);
+	}
+	std::sort(Nodes.begin(), Nodes.end(), [](const NUMANodeInfo& A, const NUMANodeInfo& B)
+	{
+		return A.Node < B.Node;
+	});
+#endif
+	//No NUMA information(or no sysfs): one node with every CPU we may use
+	if (Nodes.empty())
+	{
+		NUMANodeInfo Node;
+		Node.CPUs = AffinityCPUs;
+		Nodes.push_back(std::move(Node));
+	}
+	return Nodes;
+}
+
+bool CPUBudget::PinCurrentThread(unsigned int CPU)
+{
+#ifdef __linux__
+	if (CPU >= CPU_SETSIZE)
+	{
+		return false;
+	}
+	cpu_set_t Mask;
+	CPU_ZERO(&Mask);
+	CPU_SET(CPU, &Mask);
+	return pthread_setaffinity_np(pthread_self(), sizeof(Mask), &Mask) == 0;
+#elif defined(_WIN32)
+	if (CPU >= sizeof(DWORD_PTR) * 8)
+	{
+		return false;
+	}
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << CPU) != 0;
+#else
+	(void)CPU;
+	return false;
+#endif
+}
@@ -0,0 +1,180 @@
+#include "Public/CPUDispatch.h"
+#include "Public/SphereKernels.h"
+#include "Public/VMaterial.h"
+#include "Public/Color.h"
+#include "Public/Random.h"
+#include <cstdlib>
+#include <cstring>
+
+#if RAYTRACER_X86_DISPATCH
+#ifdef _MSC_VER
+//MSVC instrinsics
+#include <intrin.h>
+#else
+//GCC or Clang
+#include <cpuid.h>
+#endif
+#endif
+
+namespace
+{
+#if RAYTRACER_X86_DISPATCH
+	void QueryCPUID(unsigned int Leaf, unsigned int SubLeaf, unsigned int (&OutRegisters)[4])
+	{
+	#ifdef _MSC_VER
+		int CPUIDInfo[4];
+		__cpuidex(CPUIDInfo, (int)Leaf, (int)SubLeaf);
+		for (int i = 0; i < 4; i++)
+		{
+			OutRegisters[i] = (unsigned int)CPUIDInfo[i];
+		}
+	#else
+		if (!__get_cpuid_count(Leaf, SubLeaf, &OutRegisters[0], &OutRegisters[1], &OutRegisters[2], &OutRegisters[3]))
+		{
+			//GCC and Clang return 0 if the CPU does not support the leaf
+			OutRegisters[0] = OutRegisters[1] = OutRegisters[2] = OutRegisters[3] = 0;
+		}
+	#endif
+	}
+
+	//The OS has to save the wider registers on context switches, otherwise the instructions exist but are unusable
+	unsigned long long ReadXCR0()
+	{
+	#ifdef _MSC_VER
+		return _xgetbv(0);
+	#else
+		unsigned int EAX, EDX;
+		__asm__ volatile("xgetbv" : "=a"(EAX), "=d"(EDX) : "c"(0));
+		return ((unsigned long long)EDX << 32) | EAX;
+	#endif
+	}
+#endif
+
+	ISALevel DetectISA()
+	{
+#if RAYTRACER_X86_DISPATCH
+		unsigned int Leaf1[4];
+		unsigned int Leaf7[4];
+		QueryCPUID(0, 0, Leaf1);
+		const unsigned int MaxLeaf = Leaf1[0];
+		QueryCPUID(1, 0, Leaf1);
+		if (MaxLeaf >= 7)
+		{
+			QueryCPUID(7, 0, Leaf7);
+		}
+		else
+		{
+			Leaf7[0] = Leaf7[1] = Leaf7[2] = Leaf7[3] = 0;
+		}
+
+		const bool HasSSE42 = (Leaf1[2] >> 20) & 1;
+		const bool HasFMA = (Leaf1[2] >> 12) & 1;
+		const bool HasOSXSAVE = (Leaf1[2] >> 27) & 1;
+		const bool HasAVX = (Leaf1[2] >> 28) & 1;
+		const bool HasAVX2 = (Leaf7[1] >> 5) & 1;
+		const bool HasAVX512F = (Leaf7[1] >> 16) & 1;
+
+		const unsigned long long XCR0 = HasOSXSAVE ? ReadXCR0() : 0;
+		//Bits 1 and 2 are the SSE and AVX state, bits 5 to 7 are the AVX-512 opmask and ZMM state
+		const bool OSSavesAVX = (XCR0 & 0x6) == 0x6;
+		const bool OSSavesAVX512 = (XCR0 & 0xE6) == 0xE6;
+
+		if (HasAVX512F && HasAVX2 && HasFMA && OSSavesAVX512)
+		{
+			return ISALevel::AVX512;
+		}
+		if (HasAVX && HasAVX2 && HasFMA && OSSavesAVX)
+		{
+			return ISALevel::AVX2;
+		}
+		if (HasSSE42)
+		{
+			return ISALevel::SSE42;
+		}
+#endif
+		return ISALevel::Scalar;
+	}
+
+	//Picks the startup ISA: the environment override if it is valid and supported, the best supported level otherwise
+	ISALevel& ActiveISA()
+	{
+		static ISALevel Level = []()
+		{
+			ISALevel Supported = CPUDispatch::GetSupportedISA();
+			ISALevel Requested;
+			const char* Override = std::getenv("RAYTRACER_ISA");
+			if (Override && CPUDispatch::ParseISAName(Override, Requested))
+			{
+				if (Requested <= Supported)
+				{
+					return Requested;
+				}
+				std::cerr << "RAYTRACER_ISA=" << Override << " is not supported by this CPU, using " << CPUDispatch::GetISAName(Supported) << '\n';
+			}
+			return Supported;
+		}();
+		return Level;
+	}
+}
+
+ISALevel CPUDispatch::GetSupportedISA()
+{
+	static const ISALevel Supported = DetectISA();
+	return Supported;
+}
+
+ISALevel CPUDispatch::GetActiveISA()
+{
+	return ActiveISA();
+}
+
+bool CPUDispatch::SetActiveISA(ISALevel Level)
+{
+	if (Level > GetSupportedISA())
+	{
+		return false;
+	}
+	ActiveISA() = Level;
+	SphereKernels::SelectISA(Level);
+	VMaterial::SelectISA(Level);
+	SelectColorConversionISA(Level);
+	VRandom8::SelectISA(Level);
+	return true;
+}
+
+const char* CPUDispatch::GetISAName(ISALevel Level)
+{
+	switch (Level)
+	{
+		case ISALevel::SSE42:
+		{
+			return "sse4.2";
+		}
+		case ISALevel::AVX2:
+		{
+			return "avx2";
+		}
+		case ISALevel::AVX512:
+		{
+			return "avx512";
+		}
+		default:
+		{
+			return "scalar";
+		}
+	}
+}
+
+bool CPUDispatch::ParseISAName(const char* Name, ISALevel& OutLevel)
+{
+	const ISALevel Levels[] = { ISALevel::Scalar, ISALevel::SSE42, ISALevel::AVX2, ISALevel::AVX512 };
+	for (ISALevel Level : Levels)
+	{
+		if (std::strcmp(Name, GetISAName(Level)) == 0)
+		{
+			OutLevel = Level;
+			return true;
+		}
+	}
+	return false;
+}
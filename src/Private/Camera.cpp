@@ -1,11 +1,39 @@
 #include "Public/Camera.h"
 #include "Public/Material.h"
 #include "Public/VMaterial.h"
+#include "Public/RenderStats.h"
+#include <algorithm>
 
 //Initialize camera parameters and delta U,V
 //The camera center is also the origin of our coordinate system
 Camera::Camera(Point3D InCameraCenter, float InFocalLength, int InSamplePerPixel, float InVerticalFOV) : CameraCenter(InCameraCenter), FocalLength(InFocalLength),
 VerticalFOV(InVerticalFOV), m_SamplesPerPixel(InSamplePerPixel)
+{
+	UpdateBasis();
+}
+
+void Camera::SetView(const CameraView& View)
+{
+	CameraCenter = View.CameraCenter;
+	LookAt = View.LookAt;
+	VerticalFOV = View.VerticalFOV;
+	FocusDistance = View.FocusDistance;
+	DefocusAngle = View.DefocusAngle;
+	UpdateBasis();
+}
+
+CameraView Camera::GetView() const
+{
+	CameraView View;
+	View.CameraCenter = CameraCenter;
+	View.LookAt = LookAt;
+	View.VerticalFOV = VerticalFOV;
+	View.FocusDistance = FocusDistance;
+	View.DefocusAngle = DefocusAngle;
+	return View;
+}
+
+void Camera::UpdateBasis()
 {
 	FocalLength = (LookAt - CameraCenter).Length();
 
@@ -16,21 +44,56 @@ VerticalFOV(InVerticalFOV), m_SamplesPerPixel(InSamplePerPixel)
 	float DefocusRadius = FocusDistance * std::tan(Utility::DegreeToRadian(DefocusAngle / 2.f));
 	DefocusDiskU = DefocusRadius * CameraU;
 	DefocusDiskV = DefocusRadius * CameraV;
-
 }
-Color Camera::CalculateHitColor(HittableList& World, Point3D PixelLocation, Vector3D PixelDeltaU, Vector3D PixelDeltaV) const
+
+Color Camera::CalculateHitColor(HittableList& World, Point3D PixelLocation, Vector3D PixelDeltaU, Vector3D PixelDeltaV, uint32_t PixelIndex) const
 {
 	//Later we need to multiply the calculation from multiple samples with this to average them
 	float SampleScaleFactor = 1.f / (float)m_SamplesPerPixel;
 
+	Color PixelColor = AccumulateSamples(World, PixelLocation, PixelDeltaU, PixelDeltaV, PixelIndex, 0, m_SamplesPerPixel);
+	PixelColor *= SampleScaleFactor;
+	PixelColor = NormalizeColor(PixelColor);
+	return PixelColor;
+}
+
+Color Camera::AccumulateSamples(HittableList& World, Point3D PixelLocation, Vector3D PixelDeltaU, Vector3D PixelDeltaV, uint32_t PixelIndex, uint32_t FirstSampleIndex, int SampleCount,
+	float* OutLuminanceSquaredSum, FirstHitFeatures* OutFeatureSum) const
+{
 	Color PixelColor = Color(0.f, 0.f, 0.f);
-	for (int i = 0; i < m_SamplesPerPixel; i++)
+	float LuminanceSquaredSum = 0.f;
+	FirstHitFeatures FeatureSum;
+	for (int i = 0; i < SampleCount; i++)
 	{
+		VRandom::SeedPixelSample(PixelIndex, FirstSampleIndex + (uint32_t)i, m_Seed);
+		VSampler::BeginSample(m_Sampler, PixelIndex, m_ImageWidth, FirstSampleIndex + (uint32_t)i, m_Seed);
 		Ray CurrentRay = SendRayToSample(PixelLocation, PixelDeltaU, PixelDeltaV);
-		PixelColor += PerformPathTrace(CurrentRay, World);
+		FirstHitFeatures SampleFeatures;
+		Color SampleColor = PerformPathTrace(CurrentRay, World, OutFeatureSum ? &SampleFeatures : nullptr);
+		if (OutFeatureSum)
+		{
+			FeatureSum.Albedo += SampleFeatures.Albedo;
+			FeatureSum.Normal += SampleFeatures.Normal;
+			if (i == 0)
+			{
+				//Averaging these over an edge would give a depth or id that belongs to neither side, so they come from one sample
+				FeatureSum.Distance = SampleFeatures.Distance;
+				FeatureSum.ObjectID = SampleFeatures.ObjectID;
+				FeatureSum.Material = SampleFeatures.Material;
+			}
+		}
+		PixelColor += SampleColor;
+		const float SampleLuminance = Luminance(SampleColor);
+		LuminanceSquaredSum += SampleLuminance * SampleLuminance;
+	}
+	if (OutLuminanceSquaredSum)
+	{
+		*OutLuminanceSquaredSum = LuminanceSquaredSum;
+	}
+	if (OutFeatureSum)
+	{
+		*OutFeatureSum = FeatureSum;
 	}
-	PixelColor *= SampleScaleFactor;
-	PixelColor = NormalizeColor(PixelColor);
 	return PixelColor;
 }
 
@@ -48,7 +111,10 @@ Ray Camera::SendRayToSample(Point3D PixelLocation, Vector3D PixelDeltaU, Vector3
 
 Vector3D Camera::SampleSquare() const
 {
-	return Vector3D(Utility::RandomFloat(-0.5f, 0.5f), Utility::RandomFloat(-0.5f, 0.5f), 0.f);
+	float U = 0.f;
+	float V = 0.f;
+	VSampler::Get2D(SampleDimension::PixelJitter, U, V);
+	return Vector3D(U - 0.5f, V - 0.5f, 0.f);
 }
 
 /*
@@ -56,7 +122,7 @@ Vector3D Camera::SampleSquare() const
 * It's not optimal, since we would only ever have one Ray on the stack
 * It had since been changed to using a for-loop. However, the stack implementations are kept for reference and possible future uses
 */
-Color Camera::PerformPathTrace(const Ray& R, HittableList& World) const
+Color Camera::PerformPathTrace(const Ray& R, HittableList& World, FirstHitFeatures* OutFeatures) const
 {
 	Color PixelColor = Color{ 0.f, 0.f, 0.f };
 	HitRecord TempHitRecord;
@@ -65,36 +131,70 @@ Color Camera::PerformPathTrace(const Ray& R, HittableList& World) const
 	Color TotalAttenuation = Color{1.f, 1.f, 1.f};
 	for (int i = 0; i < m_MaxDepth; i++)
 	{
+		RAYTRACER_STAT(RenderStats::Local().RaysPerDepth[RenderStats::DepthBucket(i)]++);
+		VSampler::SetBounce((uint32_t)i);
 		if (World.VBulkHit(CurrentRay, Interval(0.001f, Constants::g_Infinity), TempHitRecord, MatScatterData))
 		{
 			Ray ScatteredRay;
 			Color Attenuation;
-			if (VMaterial::DispatchScatter(CurrentRay, TempHitRecord, Attenuation, ScatteredRay, MatScatterData, TempHitRecord.VHitMaterial))
+			const bool HasScattered = VMaterial::DispatchScatter(CurrentRay, TempHitRecord, Attenuation, ScatteredRay, MatScatterData, TempHitRecord.VHitMaterial);
+			if (i == 0 && OutFeatures)
+			{
+				//The attenuation rather than MaterialScatterData::Albedo, glass leaves the albedo at 0 but lets everything through
+				OutFeatures->Albedo = HasScattered ? Attenuation : MatScatterData.Albedo;
+				OutFeatures->Normal = TempHitRecord.HitNormal;
+				OutFeatures->Distance = TempHitRecord.t * CurrentRay.Direction().Length();
+				OutFeatures->ObjectID = (int32_t)World.GetSphereID(TempHitRecord.SphereIndex);
+				OutFeatures->Material = (uint8_t)TempHitRecord.VHitMaterial;
+			}
+			if (HasScattered)
 			{
 				CurrentRay = ScatteredRay;
 				TotalAttenuation = TotalAttenuation * Attenuation;
+				if (m_RouletteMinDepth > 0 && i + 1 >= m_RouletteMinDepth)
+				{
+					//The floor keeps a nearly black path from being boosted by a huge factor on the rare occasions it survives
+					const float SurvivalProbability = std::clamp(std::max(TotalAttenuation.R(), std::max(TotalAttenuation.G(), TotalAttenuation.B())), 0.05f, 1.f);
+					if (VSampler::Get1D(SampleDimension::Roulette) >= SurvivalProbability)
+					{
+						RAYTRACER_STAT(RenderStats::Local().PathsKilledByRoulette++; RenderStats::Local().PathLengths[RenderStats::DepthBucket(i + 1)]++);
+						return Color(0.f, 0.f, 0.f);
+					}
+					TotalAttenuation /= SurvivalProbability;
+				}
 			}
 			else
 			{
+				RAYTRACER_STAT(RenderStats::Local().PathsAbsorbed++; RenderStats::Local().PathLengths[RenderStats::DepthBucket(i + 1)]++);
 				return Color(0.f, 0.f, 0.f);
 			}
 		}
 		else
 		{
+			RAYTRACER_STAT(RenderStats::Local().PathsEscaped++; RenderStats::Local().PathLengths[RenderStats::DepthBucket(i + 1)]++);
 			Vector3D UnitDirection = CurrentRay.Direction().Normalize();
 			float t = 0.5f * (UnitDirection.Y + 1.f);//We are working with a unit vector with X in [-1,1] so we have to map X from [-1,1] to [0,1] first
 			PixelColor += ((1.f - t) * Color(0.9f, 0.9f, 0.9f) + t * Color(0.5f, 0.7f, 1.f));
+			if (i == 0 && OutFeatures)
+			{
+				OutFeatures->Albedo = PixelColor;
+				OutFeatures->Normal = Vector3D(0.f, 0.f, 0.f);
+			}
 			return TotalAttenuation * PixelColor;
 		}
 		
 	}
 
+	RAYTRACER_STAT(RenderStats::Local().PathsKilledByDepth++; RenderStats::Local().PathLengths[RenderStats::DepthBucket(m_MaxDepth)]++);
 	return Color{ 0.f, 0.f, 0.f };
 }
 
 Point3D Camera::SampleDefocusDisk() const
 {
 	//Used to implement depth of field, not used in hardware renderer because I was lazy :(
-	Point3D Point = Vector3D::RandomOnUnitDisk();
+	float U = 0.f;
+	float V = 0.f;
+	VSampler::Get2D(SampleDimension::Lens, U, V);
+	Point3D Point = VSampler::ConcentricDisk(U, V);
 	return CameraCenter + Point.X * DefocusDiskU + Point.Y * DefocusDiskV;
 }
@@ -1,20 +1,9 @@
 #include "Public/Color.h"
 #include "Public/Interval.h"
+#if RAYTRACER_X86_DISPATCH
+#include <immintrin.h>
+#endif
 
-//This function is kind of outdated, keeping it here so the RenderToPPM function does not break
-void WriteColor(std::ostream& OutFileStream, const Color& PixelColor)
-{
-	float R = PixelColor.R();
-	float G = PixelColor.G();
-	float B = PixelColor.B();
-
-	//In case we want to run to a ppm file, not needed for direct render to screen
-	int AdjustedRed = (int)(255.999f * R);
-	int AdjustedGreen = (int)(255.999f * G);
-	int AdjustedBlue = (int)(255.999f * B);
-
-	OutFileStream << AdjustedRed << ' ' << AdjustedGreen << ' ' << AdjustedBlue << '\n';
-}
 //Clamp color to 0 to 1
 Color NormalizeColor(const Color& PixelColor)
 {
@@ -36,3 +25,153 @@ float LinearToGamma(const float Component)
 	}
 	return 0.f;
 }
+
+namespace
+{
+	using ConvertScanlineFunc = void(*)(const Color*, unsigned char*, unsigned int);
+
+	//Color is three tightly packed floats, so a row can be walked as a flat float array
+	static_assert(sizeof(Color) == sizeof(float) * 3, "The scanline conversion treats Color as a packed float triple");
+
+	RAYTRACER_FORCEINLINE unsigned char ConvertComponent(float Component)
+	{
+		Component = Component > 0.f ? Component : 0.f;
+		Component = Component < 0.999f ? Component : 0.999f;
+		return (unsigned char)(255.999f * std::sqrt(Component));
+	}
+
+	//Scalar tail shared by every variant, also the whole conversion for the scalar path
+	RAYTRACER_FORCEINLINE void ConvertPixels(const float* Linear, unsigned char* OutBGRA, unsigned int Begin, unsigned int End)
+	{
+		for (unsigned int i = Begin; i < End; i++)
+		{
+			OutBGRA[i * 4] = ConvertComponent(Linear[i * 3 + 2]);
+			OutBGRA[i * 4 + 1] = ConvertComponent(Linear[i * 3 + 1]);
+			OutBGRA[i * 4 + 2] = ConvertComponent(Linear[i * 3]);
+			OutBGRA[i * 4 + 3] = 255;
+		}
+	}
+
+	//Swizzle a block of already converted RGB integers into BGRA bytes
+	RAYTRACER_FORCEINLINE void StoreBlock(const int32_t* RGB, unsigned char* OutBGRA, unsigned int PixelCount)
+	{
+		for (unsigned int k = 0; k < PixelCount; k++)
+		{
+			OutBGRA[k * 4] = (unsigned char)RGB[k * 3 + 2];
+			OutBGRA[k * 4 + 1] = (unsigned char)RGB[k * 3 + 1];
+			OutBGRA[k * 4 + 2] = (unsigned char)RGB[k * 3];
+			OutBGRA[k * 4 + 3] = 255;
+		}
+	}
+
+	void ConvertScanlineScalar(const Color* Linear, unsigned char* OutBGRA, unsigned int Count)
+	{
+		ConvertPixels(reinterpret_cast<const float*>(Linear), OutBGRA, 0, Count);
+	}
+
+#if RAYTRACER_X86_DISPATCH
+	/*
+	* A block of N pixels is exactly three registers of floats(RGBRGB...), the component order does not matter for clamp/sqrt/scale
+	* so each register is processed as is and only the final byte swizzle is done per pixel
+	*/
+	RAYTRACER_TARGET_SSE42 void ConvertScanlineSSE42(const Color* Linear, unsigned char* OutBGRA, unsigned int Count)
+	{
+		const float* Components = reinterpret_cast<const float*>(Linear);
+		const __m128 Zero = _mm_setzero_ps();
+		const __m128 Max = _mm_set1_ps(0.999f);
+		const __m128 Scale = _mm_set1_ps(255.999f);
+		alignas(16) int32_t RGB[12];
+		unsigned int i = 0;
+		for (; i + 4 <= Count; i += 4)
+		{
+			for (unsigned int r = 0; r < 3; r++)
+			{
+				__m128 Value = _mm_loadu_ps(Components + i * 3 + r * 4);
+				Value = _mm_min_ps(_mm_max_ps(Value, Zero), Max);
+				_mm_store_si128(reinterpret_cast<__m128i*>(RGB + r * 4), _mm_cvttps_epi32(_mm_mul_ps(_mm_sqrt_ps(Value), Scale)));
+			}
+			StoreBlock(RGB, OutBGRA + i * 4, 4);
+		}
+		ConvertPixels(Components, OutBGRA, i, Count);
+	}
+
+	RAYTRACER_TARGET_AVX2 void ConvertScanlineAVX2(const Color* Linear, unsigned char* OutBGRA, unsigned int Count)
+	{
+		const float* Components = reinterpret_cast<const float*>(Linear);
+		const __m256 Zero = _mm256_setzero_ps();
+		const __m256 Max = _mm256_set1_ps(0.999f);
+		const __m256 Scale = _mm256_set1_ps(255.999f);
+		alignas(32) int32_t RGB[24];
+		unsigned int i = 0;
+		for (; i + 8 <= Count; i += 8)
+		{
+			for (unsigned int r = 0; r < 3; r++)
+			{
+				__m256 Value = _mm256_loadu_ps(Components + i * 3 + r * 8);
+				Value = _mm256_min_ps(_mm256_max_ps(Value, Zero), Max);
+				_mm256_store_si256(reinterpret_cast<__m256i*>(RGB + r * 8), _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_sqrt_ps(Value), Scale)));
+			}
+			StoreBlock(RGB, OutBGRA + i * 4, 8);
+		}
+		ConvertPixels(Components, OutBGRA, i, Count);
+	}
+
+	RAYTRACER_TARGET_AVX512 void ConvertScanlineAVX512(const Color* Linear, unsigned char* OutBGRA, unsigned int Count)
+	{
+		const float* Components = reinterpret_cast<const float*>(Linear);
+		const __m512 Zero = _mm512_setzero_ps();
+		const __m512 Max = _mm512_set1_ps(0.999f);
+		const __m512 Scale = _mm512_set1_ps(255.999f);
+		alignas(64) int32_t RGB[48];
+		unsigned int i = 0;
+		for (; i + 16 <= Count; i += 16)
+		{
+			for (unsigned int r = 0; r < 3; r++)
+			{
+				__m512 Value = _mm512_loadu_ps(Components + i * 3 + r * 16);
+				Value = _mm512_min_ps(_mm512_max_ps(Value, Zero), Max);
+				_mm512_store_si512(RGB + r * 16, _mm512_cvttps_epi32(_mm512_mul_ps(_mm512_sqrt_ps(Value), Scale)));
+			}
+			StoreBlock(RGB, OutBGRA + i * 4, 16);
+		}
+		ConvertPixels(Components, OutBGRA, i, Count);
+	}
+#endif
+
+	ConvertScanlineFunc SelectConvertScanline(ISALevel Level)
+	{
+		switch (Level)
+		{
+#if RAYTRACER_X86_DISPATCH
+			case ISALevel::AVX512:
+			{
+				return &ConvertScanlineAVX512;
+			}
+			case ISALevel::AVX2:
+			{
+				return &ConvertScanlineAVX2;
+			}
+			case ISALevel::SSE42:
+			{
+				return &ConvertScanlineSSE42;
+			}
+#endif
+			default:
+			{
+				return &ConvertScanlineScalar;
+			}
+		}
+	}
+
+	ConvertScanlineFunc g_ConvertScanline = SelectConvertScanline(CPUDispatch::GetActiveISA());
+}
+
+void ConvertScanlineToBGRA8(const Color* Linear, unsigned char* OutBGRA, unsigned int Count)
+{
+	g_ConvertScanline(Linear, OutBGRA, Count);
+}
+
+void SelectColorConversionISA(ISALevel Level)
+{
+	g_ConvertScanline = SelectConvertScanline(Level);
+}
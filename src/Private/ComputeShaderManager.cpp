@@ -10,11 +10,12 @@ m_ComputeOutputUAV(nullptr), m_CSBeginQuery(nullptr), m_CSEndQuery(nullptr), m_D
 
 
 
-bool ComputeShaderManager::InitializeShaders(unsigned int ObjectCount, unsigned int Depth, unsigned int SampleCount)
+bool ComputeShaderManager::InitializeShaders(unsigned int ObjectCount, unsigned int Depth, unsigned int SampleCount, unsigned int RouletteMinDepth)
 {
 	HRESULT Result;
 	ID3DBlob* ShaderBlob = nullptr;
 	m_MaxDepth = Depth;
+	m_RouletteMinDepth = RouletteMinDepth;
 	m_SampleCount = SampleCount;
 	m_ObjectCount = ObjectCount;
 	//Get the .exe path so we know where to load the shader
@@ -197,6 +198,7 @@ bool ComputeShaderManager::SetShaderParams(const XMFLOAT3& CameraPos, const XMFL
 	GlobalBufferData->ScreenSize = XMUINT2(m_Width, m_Height);
 	GlobalBufferData->Depth = m_MaxDepth;
 	GlobalBufferData->SampleCount = m_SampleCount;
+	GlobalBufferData->RouletteMinDepth = m_RouletteMinDepth;
 
 	m_DeviceContext->Unmap(m_CSConstantBuffer, 0);
 
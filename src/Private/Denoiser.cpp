@@ -0,0 +1,147 @@
+#include "Public/Denoiser.h"
+#include "Public/Timer.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace
+{
+	//1D B3-spline, the 5x5 kernel is its outer product
+	constexpr float g_Kernel[5] = { 1.f / 16.f, 1.f / 4.f, 3.f / 8.f, 1.f / 4.f, 1.f / 16.f };
+	//Keeps dark albedos(and the black first hits of absorbed paths) from blowing the demodulated color up
+	constexpr float g_AlbedoEpsilon = 0.01f;
+
+	//exp(-X) for X >= 0 to 0.02% relative error, plenty for filter weights. std::exp was most of the filter's time
+	float FastNegativeExp(float X)
+	{
+		//Past this the weight is below 1e-30 and the exponent bits would underflow
+		if (X > 69.f)
+		{
+			return 0.f;
+		}
+		const float Power = -X * 1.44269504f;
+		//Floor by truncation, std::floor is a library call without SSE4.1
+		int32_t Whole = (int32_t)Power;
+		Whole -= Power < (float)Whole ? 1 : 0;
+		const float Fraction = Power - (float)Whole;
+		//Cubic fit of 2^Fraction on [0, 1), the whole part goes straight into the exponent bits
+		const float Mantissa = 1.f + Fraction * (0.69606564f + Fraction * (0.22449434f + Fraction * 0.07944024f));
+		return Mantissa * std::bit_cast<float>((Whole + 127) << 23);
+	}
+
+	float DistanceSquared(const float* A, const float* B)
+	{
+		const float X = A[0] - B[0];
+		const float Y = A[1] - B[1];
+		const float Z = A[2] - B[2];
+		return X * X + Y * Y + Z * Z;
+	}
+}
+
+VDenoiser::VDenoiser(unsigned int Width, unsigned int Height) : m_Width(Width), m_Height(Height)
+{
+	const size_t Size = (size_t)Width * Height * 3;
+	m_Color.reset(new float[Size]);
+	m_Albedo.reset(new float[Size]);
+	m_Normal.reset(new float[Size]);
+	m_Ping.reset(new float[Size]);
+	m_Pong.reset(new float[Size]);
+	m_Output.reset(new float[Size]);
+}
+
+void VDenoiser::Denoise(VTileScheduler& Scheduler, unsigned int TileSize, const DenoiseSettings& Settings)
+{
+	Scheduler.Run(m_Width, m_Height, TileSize, [this](const RenderTile& Tile, unsigned int)
+	{
+		Demodulate(Tile);
+	});
+
+	float* Source = m_Ping.get();
+	float* Destination = m_Pong.get();
+	float ColorSigma = Settings.ColorSigma;
+	for (unsigned int i = 0; i < Settings.Iterations; i++)
+	{
+		VProfileZone IterationZone("Iteration", "step", 1ll << i);
+		const unsigned int Step = 1u << i;
+		Scheduler.Run(m_Width, m_Height, TileSize, [this, Source, Destination, Step, &Settings, ColorSigma](const RenderTile& Tile, unsigned int)
+		{
+			FilterTile(Tile, Source, Destination, Step, Settings, ColorSigma);
+		});
+		std::swap(Source, Destination);
+		ColorSigma *= 0.5f;
+	}
+
+	Scheduler.Run(m_Width, m_Height, TileSize, [this, Source](const RenderTile& Tile, unsigned int)
+	{
+		Remodulate(Tile, Source);
+	});
+}
+
+void VDenoiser::Demodulate(const RenderTile& Tile)
+{
+	for (unsigned int y = Tile.Y0; y < Tile.Y1; y++)
+	{
+		for (size_t i = ((size_t)y * m_Width + Tile.X0) * 3; i < ((size_t)y * m_Width + Tile.X1) * 3; i++)
+		{
+			m_Ping[i] = m_Color[i] / (m_Albedo[i] + g_AlbedoEpsilon);
+		}
+	}
+}
+
+void VDenoiser::FilterTile(const RenderTile& Tile, const float* Source, float* Destination, unsigned int Step, const DenoiseSettings& Settings, float ColorSigma) const
+{
+	const float InverseColorSigma = 1.f / (ColorSigma * ColorSigma);
+	const float InverseNormalSigma = 1.f / (Settings.NormalSigma * Settings.NormalSigma);
+	const float InverseAlbedoSigma = 1.f / (Settings.AlbedoSigma * Settings.AlbedoSigma);
+	for (unsigned int y = Tile.Y0; y < Tile.Y1; y++)
+	{
+		for (unsigned int x = Tile.X0; x < Tile.X1; x++)
+		{
+			const size_t Center = ((size_t)y * m_Width + x) * 3;
+			float Sum[3] = { 0.f, 0.f, 0.f };
+			float WeightSum = 0.f;
+			for (int j = 0; j < 5; j++)
+			{
+				const int TapY = (int)y + (j - 2) * (int)Step;
+				if (TapY < 0 || TapY >= (int)m_Height)
+				{
+					continue;
+				}
+				for (int i = 0; i < 5; i++)
+				{
+					const int TapX = (int)x + (i - 2) * (int)Step;
+					if (TapX < 0 || TapX >= (int)m_Width)
+					{
+						continue;
+					}
+					//One exp per tap: the three edge stopping weights multiply, so their exponents add
+					const size_t Tap = ((size_t)TapY * m_Width + TapX) * 3;
+					const float Exponent = DistanceSquared(Source + Center, Source + Tap) * InverseColorSigma
+						+ DistanceSquared(m_Normal.get() + Center, m_Normal.get() + Tap) * InverseNormalSigma
+						+ DistanceSquared(m_Albedo.get() + Center, m_Albedo.get() + Tap) * InverseAlbedoSigma;
+					const float Weight = g_Kernel[i] * g_Kernel[j] * FastNegativeExp(Exponent);
+					Sum[0] += Weight * Source[Tap];
+					Sum[1] += Weight * Source[Tap + 1];
+					Sum[2] += Weight * Source[Tap + 2];
+					WeightSum += Weight;
+				}
+			}
+			//The center tap always has weight, so WeightSum is never 0
+			const float InverseWeightSum = 1.f / WeightSum;
+			Destination[Center] = Sum[0] * InverseWeightSum;
+			Destination[Center + 1] = Sum[1] * InverseWeightSum;
+			Destination[Center + 2] = Sum[2] * InverseWeightSum;
+		}
+	}
+}
+
+void VDenoiser::Remodulate(const RenderTile& Tile, const float* Source)
+{
+	for (unsigned int y = Tile.Y0; y < Tile.Y1; y++)
+	{
+		for (size_t i = ((size_t)y * m_Width + Tile.X0) * 3; i < ((size_t)y * m_Width + Tile.X1) * 3; i++)
+		{
+			m_Output[i] = Source[i] * (m_Albedo[i] + g_AlbedoEpsilon);
+		}
+	}
+}
@@ -0,0 +1,347 @@
+#include "Public/HDRTileWriter.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+//No min/max macros, LayOutEXR and WriteAt call std::min
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	static_assert(std::endian::native == std::endian::little, "PFM and EXR pixels are written straight from memory as little-endian");
+	//PFM rows go out straight from the Color rows
+	static_assert(sizeof(Color) == sizeof(float) * 3, "The PFM writer treats Color as a packed float triple");
+
+	//Chunk header in front of every EXR tile: tile x, tile y, level x, level y, pixel data size
+	constexpr uint64_t g_EXRChunkHeaderSize = 5 * sizeof(int32_t);
+
+	/*
+	* IEEE half from float, rounding to nearest even like the hardware conversion does
+	* 1. Infinity and NaN keep their class, finite values that round past 65504 become infinity
+	* 2. Below the smallest normal half the float adder does the rounding: adding 0.5 lines the half subnormal step(2^-24) up with the float ulp
+	* 3. Normal values rebias the exponent and round the 13 dropped mantissa bits
+	*/
+	uint16_t FloatToHalf(float Value)
+	{
+		const uint32_t Bits = std::bit_cast<uint32_t>(Value);
+		const uint16_t Sign = (uint16_t)((Bits >> 16) & 0x8000u);
+		const uint32_t Magnitude = Bits & 0x7fffffffu;
+		if (Magnitude >= 0x7f800000u)
+		{
+			return Sign | (Magnitude > 0x7f800000u ? 0x7e00u : 0x7c00u);
+		}
+		if (Magnitude >= 0x477ff000u)
+		{
+			return Sign | 0x7c00u;
+		}
+		if (Magnitude < 0x38800000u)
+		{
+			const float Shifted = std::bit_cast<float>(Magnitude) + 0.5f;
+			return Sign | (uint16_t)(std::bit_cast<uint32_t>(Shifted) - 0x3f000000u);
+		}
+		const uint32_t Rounded = Magnitude + 0xfffu + ((Magnitude >> 13) & 1u);
+		return Sign | (uint16_t)((Rounded - 0x38000000u) >> 13);
+	}
+
+	void AppendBytes(std::vector<unsigned char>& OutBytes, const void* Data, size_t ByteCount)
+	{
+		const unsigned char* Bytes = static_cast<const unsigned char*>(Data);
+		OutBytes.insert(OutBytes.end(), Bytes, Bytes + ByteCount);
+	}
+
+	template<typename T>
+	void AppendValue(std::vector<unsigned char>& OutBytes, const T& Value)
+	{
+		AppendBytes(OutBytes, &Value, sizeof(T));
+	}
+
+	//One EXR header attribute: name, type name, value size, value
+	void AppendAttribute(std::vector<unsigned char>& OutHeader, const char* Name, const char* TypeName, const void* Value, int32_t ValueSize)
+	{
+		AppendBytes(OutHeader, Name, std::strlen(Name) + 1);
+		AppendBytes(OutHeader, TypeName, std::strlen(TypeName) + 1);
+		AppendValue(OutHeader, ValueSize);
+		AppendBytes(OutHeader, Value, (size_t)ValueSize);
+	}
+
+	void SetError(std::string* OutError, const std::string& Message)
+	{
+		if (OutError)
+		{
+			*OutError = Message;
+		}
+	}
+}
+
+VHDRTileWriter::~VHDRTileWriter()
+{
+	Close();
+}
+
+bool VHDRTileWriter::GetFormatFromPath(const std::string& FilePath, HDRFormat& OutFormat)
+{
+	const auto HasExtension = [&FilePath](const char* Extension)
+	{
+		const size_t Length = std::strlen(Extension);
+		return FilePath.size() > Length && FilePath.compare(FilePath.size() - Length, Length, Extension) == 0;
+	};
+	if (HasExtension(".pfm"))
+	{
+		OutFormat = HDRFormat::PFM;
+		return true;
+	}
+	if (HasExtension(".exr"))
+	{
+		OutFormat = HDRFormat::TiledEXR;
+		return true;
+	}
+	return false;
+}
+
+bool VHDRTileWriter::Open(const std::string& FilePath, HDRFormat Format, unsigned int Width, unsigned int Height, unsigned int TileSize, std::string* OutError)
+{
+	Close();
+	if (Width == 0 || Height == 0 || TileSize == 0)
+	{
+		SetError(OutError, "can not stream an empty image to " + FilePath);
+		return false;
+	}
+	m_FilePath = FilePath;
+	m_Format = Format;
+	m_Width = Width;
+	m_Height = Height;
+	m_TileSize = TileSize;
+	m_TilesX = (Width + TileSize - 1) / TileSize;
+	m_HasFailed = false;
+
+#ifdef _WIN32
+	HANDLE File = CreateFileA(FilePath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	m_File = File == INVALID_HANDLE_VALUE ? -1 : (intptr_t)File;
+#else
+	m_File = open(FilePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+	if (m_File < 0)
+	{
+		SetError(OutError, "can not open " + FilePath + " for writing");
+		return false;
+	}
+	//Size the file to its full length right away, tiles that have not been written yet read as zeros
+	bool WasLaidOut = Format == HDRFormat::PFM ? LayOutPFM() : LayOutEXR();
+#ifdef _WIN32
+	LARGE_INTEGER Size;
+	Size.QuadPart = (LONGLONG)m_FileSize;
+	WasLaidOut = WasLaidOut && SetFilePointerEx((HANDLE)m_File, Size, nullptr, FILE_BEGIN) && SetEndOfFile((HANDLE)m_File);
+#else
+	WasLaidOut = WasLaidOut && ftruncate((int)m_File, (off_t)m_FileSize) == 0;
+#endif
+	if (!WasLaidOut)
+	{
+		Close();
+		SetError(OutError, "failed to lay out " + FilePath);
+		return false;
+	}
+	return true;
+}
+
+bool VHDRTileWriter::LayOutPFM()
+{
+	//A negative scale marks the floats as little-endian
+	const std::string Header = "PF\n" + std::to_string(m_Width) + " " + std::to_string(m_Height) + "\n-1.0\n";
+	m_PixelOffset = Header.size();
+	m_FileSize = m_PixelOffset + (uint64_t)m_Width * m_Height * 3 * sizeof(float);
+	return WriteAt(0, Header.data(), Header.size());
+}
+
+bool VHDRTileWriter::LayOutEXR()
+{
+	/*
+	* Single part, single level tiled file, see the OpenEXR file layout document:
+	* 1. Magic number and version 2 with the tiled bit set
+	* 2. Header attributes, then an empty name to end them
+	* 3. Tile offset table, one uint64 per tile in increasing y order
+	* 4. Tile chunks in the same order, every one a chunk header followed by the tile's rows, each row its B, G and R halves
+	*/
+	std::vector<unsigned char> Header;
+	AppendValue(Header, (int32_t)20000630);
+	AppendValue(Header, (int32_t)(2 | 0x200));
+
+	//Channels have to be listed alphabetically: name, pixel type(1 = half), linear flag, 3 reserved bytes, x and y sampling
+	std::vector<unsigned char> Channels;
+	for (const char* Name : { "B", "G", "R" })
+	{
+		AppendBytes(Channels, Name, 2);
+		AppendValue(Channels, (int32_t)1);
+		AppendValue(Channels, (uint32_t)0);
+		AppendValue(Channels, (int32_t)1);
+		AppendValue(Channels, (int32_t)1);
+	}
+	Channels.push_back(0);
+	AppendAttribute(Header, "channels", "chlist", Channels.data(), (int32_t)Channels.size());
+	const uint8_t NoCompression = 0;
+	AppendAttribute(Header, "compression", "compression", &NoCompression, 1);
+	const int32_t Window[4] = { 0, 0, (int32_t)m_Width - 1, (int32_t)m_Height - 1 };
+	AppendAttribute(Header, "dataWindow", "box2i", Window, sizeof(Window));
+	AppendAttribute(Header, "displayWindow", "box2i", Window, sizeof(Window));
+	const uint8_t IncreasingY = 0;
+	AppendAttribute(Header, "lineOrder", "lineOrder", &IncreasingY, 1);
+	const float One = 1.f;
+	AppendAttribute(Header, "pixelAspectRatio", "float", &One, sizeof(One));
+	const float WindowCenter[2] = { 0.f, 0.f };
+	AppendAttribute(Header, "screenWindowCenter", "v2f", WindowCenter, sizeof(WindowCenter));
+	AppendAttribute(Header, "screenWindowWidth", "float", &One, sizeof(One));
+	//Tile width and height, then the level mode(0 = one level) and rounding mode packed in one byte
+	unsigned char TileDescription[9] = {};
+	std::memcpy(TileDescription, &m_TileSize, sizeof(uint32_t));
+	std::memcpy(TileDescription + 4, &m_TileSize, sizeof(uint32_t));
+	AppendAttribute(Header, "tiles", "tiledesc", TileDescription, sizeof(TileDescription));
+	Header.push_back(0);
+
+	//Every tile's chunk size is known up front because nothing is compressed, so the offset table and the chunk headers can go out right away
+	const unsigned int TilesY = (m_Height + m_TileSize - 1) / m_TileSize;
+	const size_t TileCount = (size_t)m_TilesX * TilesY;
+	m_PixelOffset = Header.size() + TileCount * sizeof(uint64_t);
+	std::vector<uint64_t> Offsets(TileCount);
+	std::vector<unsigned char> ChunkHeaders;
+	ChunkHeaders.reserve(TileCount * g_EXRChunkHeaderSize);
+	uint64_t Offset = m_PixelOffset;
+	for (unsigned int TileY = 0; TileY < TilesY; TileY++)
+	{
+		const unsigned int TileHeight = std::min(m_TileSize, m_Height - TileY * m_TileSize);
+		for (unsigned int TileX = 0; TileX < m_TilesX; TileX++)
+		{
+			const unsigned int TileWidth = std::min(m_TileSize, m_Width - TileX * m_TileSize);
+			const int32_t ChunkHeader[5] = { (int32_t)TileX, (int32_t)TileY, 0, 0, (int32_t)(TileWidth * TileHeight * 3 * sizeof(uint16_t)) };
+			Offsets[(size_t)TileY * m_TilesX + TileX] = Offset;
+			AppendBytes(ChunkHeaders, ChunkHeader, sizeof(ChunkHeader));
+			Offset += g_EXRChunkHeaderSize + (uint64_t)ChunkHeader[4];
+		}
+	}
+	m_FileSize = Offset;
+	if (!WriteAt(0, Header.data(), Header.size()) || !WriteAt(Header.size(), Offsets.data(), Offsets.size() * sizeof(uint64_t)))
+	{
+		return false;
+	}
+	for (size_t i = 0; i < TileCount; i++)
+	{
+		if (!WriteAt(Offsets[i], ChunkHeaders.data() + i * g_EXRChunkHeaderSize, g_EXRChunkHeaderSize))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void VHDRTileWriter::WriteTile(const RenderTile& Tile, const Color* Pixels, size_t RowStride)
+{
+	if (!IsOpen())
+	{
+		return;
+	}
+	const unsigned int TileWidth = Tile.X1 - Tile.X0;
+	const unsigned int TileHeight = Tile.Y1 - Tile.Y0;
+	//Reused by every tile this thread writes, so it settles at one tile's size
+	thread_local std::vector<unsigned char> t_Encoded;
+	bool WasWritten = true;
+	if (m_Format == HDRFormat::PFM)
+	{
+		//PFM rows run bottom to top, so every tile row lands in a different place
+		const size_t RowBytes = (size_t)TileWidth * 3 * sizeof(float);
+		for (unsigned int i = 0; i < TileHeight && WasWritten; i++)
+		{
+			const uint64_t Row = m_Height - 1 - (Tile.Y0 + i);
+			const uint64_t Offset = m_PixelOffset + (Row * m_Width + Tile.X0) * 3 * sizeof(float);
+			WasWritten = WriteAt(Offset, Pixels + i * RowStride, RowBytes);
+		}
+	}
+	else
+	{
+		//The chunk header was written by Open, the pixels follow it row by row with the channels in file order
+		const size_t PixelBytes = (size_t)TileWidth * TileHeight * 3 * sizeof(uint16_t);
+		t_Encoded.resize(PixelBytes);
+		uint16_t* Halves = reinterpret_cast<uint16_t*>(t_Encoded.data());
+		for (unsigned int i = 0; i < TileHeight; i++)
+		{
+			const Color* Row = Pixels + i * RowStride;
+			uint16_t* Blue = Halves + (size_t)i * TileWidth * 3;
+			uint16_t* Green = Blue + TileWidth;
+			uint16_t* Red = Green + TileWidth;
+			for (unsigned int j = 0; j < TileWidth; j++)
+			{
+				Blue[j] = FloatToHalf(Row[j].B());
+				Green[j] = FloatToHalf(Row[j].G());
+				Red[j] = FloatToHalf(Row[j].R());
+			}
+		}
+		//Every tile row before this one is full height and every tile before it in its row is full width
+		const unsigned int TileX = Tile.X0 / m_TileSize;
+		const unsigned int TileY = Tile.Y0 / m_TileSize;
+		const uint64_t TileRowBytes = (uint64_t)m_TilesX * g_EXRChunkHeaderSize + (uint64_t)m_Width * m_TileSize * 3 * sizeof(uint16_t);
+		const uint64_t ChunkBytes = g_EXRChunkHeaderSize + (uint64_t)m_TileSize * TileHeight * 3 * sizeof(uint16_t);
+		const uint64_t ChunkOffset = m_PixelOffset + TileY * TileRowBytes + TileX * ChunkBytes;
+		WasWritten = WriteAt(ChunkOffset + g_EXRChunkHeaderSize, t_Encoded.data(), PixelBytes);
+	}
+	if (!WasWritten)
+	{
+		m_HasFailed.store(true, std::memory_order_relaxed);
+	}
+}
+
+bool VHDRTileWriter::WriteAt(uint64_t Offset, const void* Data, size_t ByteCount)
+{
+	const char* Bytes = static_cast<const char*>(Data);
+	while (ByteCount > 0)
+	{
+#ifdef _WIN32
+		//An OVERLAPPED offset makes WriteFile positional, so workers do not share a file pointer
+		OVERLAPPED Overlapped = {};
+		Overlapped.Offset = (DWORD)Offset;
+		Overlapped.OffsetHigh = (DWORD)(Offset >> 32);
+		DWORD Written = 0;
+		const DWORD Chunk = (DWORD)std::min<size_t>(ByteCount, 1u << 30);
+		if (!WriteFile((HANDLE)m_File, Bytes, Chunk, &Written, &Overlapped) || Written == 0)
+		{
+			return false;
+		}
+#else
+		const ssize_t Written = pwrite((int)m_File, Bytes, ByteCount, (off_t)Offset);
+		if (Written <= 0)
+		{
+			return false;
+		}
+#endif
+		Bytes += Written;
+		Offset += (uint64_t)Written;
+		ByteCount -= (size_t)Written;
+	}
+	return true;
+}
+
+bool VHDRTileWriter::Close(std::string* OutError)
+{
+	if (!IsOpen())
+	{
+		return !m_HasFailed;
+	}
+#ifdef _WIN32
+	const bool WasClosed = CloseHandle((HANDLE)m_File) != 0;
+#else
+	const bool WasClosed = close((int)m_File) == 0;
+#endif
+	m_File = -1;
+	if (!WasClosed || m_HasFailed)
+	{
+		m_HasFailed = true;
+		SetError(OutError, "failed to write " + m_FilePath);
+		return false;
+	}
+	return true;
+}
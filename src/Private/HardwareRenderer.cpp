@@ -10,7 +10,7 @@ m_ComputeShaderManager(nullptr), m_hWnd(NULL), m_Device(nullptr), m_DeviceContex
 
 
 
-bool HardwareRenderer::Intialize(HWND hWnd, unsigned int SampleCount, unsigned int MaxDepth)
+bool HardwareRenderer::Intialize(HWND hWnd, unsigned int SampleCount, unsigned int MaxDepth, unsigned int RouletteMinDepth)
 {
 	m_hWnd = hWnd;
 
@@ -27,6 +27,7 @@ bool HardwareRenderer::Intialize(HWND hWnd, unsigned int SampleCount, unsigned i
 	m_Camera = Camera();
 	m_Camera.SetSampleCount(SampleCount);
 	m_Camera.SetMaxDepth(MaxDepth);
+	m_Camera.SetRouletteMinDepth((int)RouletteMinDepth);
 	m_Device = m_D3D11->GetDevice();
 	m_DeviceContext = m_D3D11->GetDeviceContext();
 
@@ -34,9 +35,10 @@ bool HardwareRenderer::Intialize(HWND hWnd, unsigned int SampleCount, unsigned i
 	m_ComputeShaderManager = (std::make_unique<ComputeShaderManager>(m_Device, m_DeviceContext, m_Width, m_Height));
 
 	//Create the world and initialize the shader manager
-	CreateWorld();
+	//Same seed as the software renderer's default, so both paths show the same scene
+	CreateWorld(0);
 
-	if (!m_ComputeShaderManager->InitializeShaders(m_World->GetNumObjects(), m_Camera.GetMaxDepth(), m_Camera.GetSampleCount()))
+	if (!m_ComputeShaderManager->InitializeShaders(m_World->GetNumObjects(), m_Camera.GetMaxDepth(), m_Camera.GetSampleCount(), (unsigned int)m_Camera.GetRouletteMinDepth()))
 	{
 		MessageBox(NULL, L"Failed to initialize compute shader!", L"Error", MB_OK);
 		return false;
@@ -118,8 +120,10 @@ void HardwareRenderer::GetShaderBuffers()
 
 
 
-void HardwareRenderer::CreateWorld()
+void HardwareRenderer::CreateWorld(uint64_t Seed)
 {
+	VRandom::SeedSceneGeneration(Seed);
+
 	//Create the materials and spheres in the world, I am keeping both my and the book's implementations so I can do some benchmark
 	/*
 	* Note on the calculation of RI for the glass sphere and the bubble. The glass is straightforward, it's just 1.5
@@ -127,6 +131,8 @@ void HardwareRenderer::CreateWorld()
 	* Therefore, we have 1.f(air bubble) / 1.5f(glass layer)
 	*/
 	m_World = std::make_unique<HittableList>();
+	//At most one sphere per grid cell plus the ground and the three big ones
+	m_World->Reserve(22 * 22 + 4);
 	MaterialScatterData MatScatterData(0.f, Color(0.5f, 0.5f, 0.5f));
 	m_World->VAddSphere(SphereObjectData(Point3D(0.f, -1000.f, 0.f), 1000.f), MatScatterData, MaterialType::Lambertian);
 	for (int a = -11; a < 11; a++)
@@ -1,7 +1,11 @@
 #include "Public/HittableList.h"
 #include "Public/Material.h"
 #include "Public/VMaterial.h"
+#include "Public/SphereKernels.h"
+#include "Public/RenderStats.h"
+#ifdef _WIN32
 #include "Public/ComputeShaderManager.h"
+#endif
 
 
 HittableList::HittableList() : m_SphereTransforms(SphereTransformComponent{}), m_CSTransformBuffer(nullptr),
@@ -37,27 +41,57 @@ bool HittableList::Hit(const Ray& R, Interval HitInterval, HitRecord& OutHitReco
 }
 
 //These two functions are just here temporarily. Obviously this is not a good architecture but we go with it FOR NOW
+//The kernels only track the nearest distance and sphere index, the hit record is filled in once for the winning sphere at the end
 bool HittableList::VBulkHit(const Ray& R, Interval HitInterval, HitRecord& OutHitRecord, MaterialScatterData& OutScatterData)
 {
-	bool HasHit = false;
 	float ClosestSoFar = HitInterval.Max;
-	HitRecord ClosestHitRecord;
+	int ClosestIndex = -1;
+	unsigned int NodesVisited = 0;
+	unsigned int SphereTests = 0;
 
-	for (size_t i = 0; i < m_NumObjects; i++)
+	if (m_BVH.IsBuilt())
 	{
-		if (VSphereHit(R, Interval(HitInterval.Min, ClosestSoFar), m_SphereTransforms.TransformData[i].SphereCenter, m_SphereTransforms.TransformData[i].SphereRadius, OutHitRecord))
+		m_BVH.Traverse(R, HitInterval, ClosestSoFar, [&](unsigned int First, unsigned int Count, float& Closest)
 		{
-			HasHit = true;
-			ClosestSoFar = OutHitRecord.t;
-			OutScatterData = m_VSphereMatComponent.MaterialData[i];
-			OutHitRecord.VHitMaterial = m_VSphereMatComponent.MaterialTypes[i];
-			
-		}
+			int Index = SphereKernels::NearestHit(m_SphereSoA, R, HitInterval.Min, Closest, First, Count);
+			if (Index >= 0)
+			{
+				ClosestIndex = Index;
+			}
+			SphereTests += Count;
+		}, NodesVisited);
+	}
+	else
+	{
+		ClosestIndex = SphereKernels::NearestHit(m_SphereSoA, R, HitInterval.Min, ClosestSoFar, 0, m_NumObjects);
+		SphereTests = m_NumObjects;
 	}
 
-	return HasHit;
+	RAYTRACER_STAT(RenderStats::Local().SphereTests += SphereTests);
+	if (m_ShouldCollectStats)
+	{
+		m_StatRays.fetch_add(1, std::memory_order_relaxed);
+		m_StatNodesVisited.fetch_add(NodesVisited, std::memory_order_relaxed);
+		m_StatSphereTests.fetch_add(SphereTests, std::memory_order_relaxed);
+	}
+
+	if (ClosestIndex < 0)
+	{
+		return false;
+	}
+
+	const SphereTransformData& Sphere = m_SphereTransforms.TransformData[ClosestIndex];
+	OutHitRecord.t = ClosestSoFar;
+	OutHitRecord.HitPoint = R.At(ClosestSoFar);
+	Vector3D OutwardNormal = (OutHitRecord.HitPoint - Sphere.SphereCenter) / Sphere.SphereRadius;
+	Hittable::SetFaceNormal(R, OutwardNormal, OutHitRecord);
+	OutScatterData = m_VSphereMatComponent.MaterialData[ClosestIndex];
+	OutHitRecord.VHitMaterial = m_VSphereMatComponent.MaterialTypes[ClosestIndex];
+	OutHitRecord.SphereIndex = (unsigned int)ClosestIndex;
+	return true;
 }
 
+//Single sphere test that writes the full hit record. VBulkHit no longer uses it, it's kept for the legacy path and for benchmarking
 bool HittableList::VSphereHit(const Ray& R, Interval HitInterval, const Vector3D& Center, const float Radius, HitRecord& OutHitRecord)
 {
 	//A simple function to do ray sphere intersection
@@ -84,7 +118,7 @@ bool HittableList::VSphereHit(const Ray& R, Interval HitInterval, const Vector3D
 		return false;
 	}
 
-	float SqrtDis = std::sqrtf(Discriminant);
+	float SqrtDis = std::sqrt(Discriminant);
 
 	float Root = (h - SqrtDis) / a;
 
@@ -120,9 +154,162 @@ void HittableList::VAddSphere(const SphereObjectData& Data, const MaterialScatte
 	m_SphereTransforms.TransformData.emplace_back(Data.Center, Data.Radius);
 	m_VSphereMatComponent.MaterialData.emplace_back(MatData.FuzzOrRI, MatData.Albedo);
 	m_VSphereMatComponent.MaterialTypes.push_back(MatType);
+	m_VSphereMatComponent.SphereIDs.push_back(m_NumObjects);
+	m_SphereSoA.Append(Data.Center, Data.Radius);
 	m_NumObjects++;
+	if (m_BVH.IsBuilt())
+	{
+		m_BVH.Clear();
+	}
 }
 
+void HittableList::VAddSpheres(const SphereTransformData* Transforms, const MaterialScatterData* MatData, const MaterialType* MatTypes, size_t Count, const uint32_t* SphereIDs)
+{
+	Reserve(m_NumObjects + Count);
+	m_SphereTransforms.TransformData.insert(m_SphereTransforms.TransformData.end(), Transforms, Transforms + Count);
+	m_VSphereMatComponent.MaterialData.insert(m_VSphereMatComponent.MaterialData.end(), MatData, MatData + Count);
+	m_VSphereMatComponent.MaterialTypes.insert(m_VSphereMatComponent.MaterialTypes.end(), MatTypes, MatTypes + Count);
+	if (SphereIDs)
+	{
+		m_VSphereMatComponent.SphereIDs.insert(m_VSphereMatComponent.SphereIDs.end(), SphereIDs, SphereIDs + Count);
+	}
+	else
+	{
+		for (size_t i = 0; i < Count; i++)
+		{
+			m_VSphereMatComponent.SphereIDs.push_back(m_NumObjects + (uint32_t)i);
+		}
+	}
+	for (size_t i = 0; i < Count; i++)
+	{
+		m_SphereSoA.Append(Transforms[i].SphereCenter, Transforms[i].SphereRadius);
+	}
+	m_NumObjects += (unsigned int)Count;
+	if (m_BVH.IsBuilt())
+	{
+		m_BVH.Clear();
+	}
+}
+
+void HittableList::Reserve(size_t SphereCount)
+{
+	m_SphereTransforms.TransformData.reserve(SphereCount);
+	m_VSphereMatComponent.MaterialData.reserve(SphereCount);
+	m_VSphereMatComponent.MaterialTypes.reserve(SphereCount);
+	m_VSphereMatComponent.SphereIDs.reserve(SphereCount);
+	m_SphereSoA.Reserve(SphereCount);
+}
+
+bool HittableList::AssignBVH(const BVHNode* Nodes, unsigned int NodeCount)
+{
+	return m_BVH.Assign(Nodes, NodeCount, m_NumObjects);
+}
+
+void HittableList::BuildBVH()
+{
+	std::vector<unsigned int> PrimitiveOrder;
+	//Leaves are tested a whole SIMD batch at a time, so let the SAH know a leaf up to the lane width costs about as much as a single sphere
+	m_BVH.Build(m_SphereTransforms.TransformData, PrimitiveOrder, SphereKernels::GetLaneWidth());
+
+	//Apply the BVH order to every component array so the leaves index them directly
+	std::vector<SphereTransformData> SortedTransforms;
+	std::vector<MaterialScatterData> SortedMaterialData;
+	std::vector<MaterialType> SortedMaterialTypes;
+	std::vector<uint32_t> SortedSphereIDs;
+	SortedTransforms.reserve(m_NumObjects);
+	SortedMaterialData.reserve(m_NumObjects);
+	SortedMaterialTypes.reserve(m_NumObjects);
+	SortedSphereIDs.reserve(m_NumObjects);
+	for (unsigned int Index : PrimitiveOrder)
+	{
+		SortedTransforms.push_back(m_SphereTransforms.TransformData[Index]);
+		SortedMaterialData.push_back(m_VSphereMatComponent.MaterialData[Index]);
+		SortedMaterialTypes.push_back(m_VSphereMatComponent.MaterialTypes[Index]);
+		SortedSphereIDs.push_back(m_VSphereMatComponent.SphereIDs[Index]);
+	}
+	m_SphereTransforms.TransformData = std::move(SortedTransforms);
+	m_VSphereMatComponent.MaterialData = std::move(SortedMaterialData);
+	m_VSphereMatComponent.MaterialTypes = std::move(SortedMaterialTypes);
+	m_VSphereMatComponent.SphereIDs = std::move(SortedSphereIDs);
+	m_SphereSoA.Rebuild(m_SphereTransforms.TransformData);
+}
+
+void SphereSoAComponent::Append(const Vector3D& Center, float SphereRadius)
+{
+	//Grow one padding block at a time, the new entries start out as NaN padding
+	if (Count + g_SphereSoAPadding >= CenterX.size())
+	{
+		const size_t NewSize = CenterX.size() + g_SphereSoAPadding;
+		const float Padding = std::numeric_limits<float>::quiet_NaN();
+		CenterX.resize(NewSize, Padding);
+		CenterY.resize(NewSize, Padding);
+		CenterZ.resize(NewSize, Padding);
+		Radius.resize(NewSize, Padding);
+	}
+	CenterX[Count] = Center.X;
+	CenterY[Count] = Center.Y;
+	CenterZ[Count] = Center.Z;
+	Radius[Count] = SphereRadius;
+	Count++;
+}
+
+void SphereSoAComponent::Reserve(size_t SphereCount)
+{
+	//The padded size Append grows to once SphereCount spheres are in
+	const size_t PaddedSize = (SphereCount / g_SphereSoAPadding + 2) * g_SphereSoAPadding;
+	CenterX.reserve(PaddedSize);
+	CenterY.reserve(PaddedSize);
+	CenterZ.reserve(PaddedSize);
+	Radius.reserve(PaddedSize);
+}
+
+void SphereSoAComponent::Rebuild(const std::vector<SphereTransformData>& Transforms)
+{
+	CenterX.clear();
+	CenterY.clear();
+	CenterZ.clear();
+	Radius.clear();
+	Count = 0;
+	//Reserve the final padded size up front so Append never reallocates
+	Reserve(Transforms.size());
+	for (const SphereTransformData& Transform : Transforms)
+	{
+		Append(Transform.SphereCenter, Transform.SphereRadius);
+	}
+}
+
+std::unique_ptr<HittableList> HittableList::CloneSceneData() const
+{
+	std::unique_ptr<HittableList> Clone = std::make_unique<HittableList>();
+	Clone->m_Objects = m_Objects;
+	Clone->m_SphereTransforms = m_SphereTransforms;
+	Clone->m_SphereSoA = m_SphereSoA;
+	Clone->m_SphereMaterials = m_SphereMaterials;
+	Clone->m_VSphereMatComponent = m_VSphereMatComponent;
+	Clone->m_NumObjects = m_NumObjects;
+	Clone->m_BVH = m_BVH;
+	Clone->m_ShouldCollectStats = m_ShouldCollectStats;
+	return Clone;
+}
+
+TraversalStats HittableList::GetTraversalStats() const
+{
+	TraversalStats Stats;
+	Stats.Rays = m_StatRays.load(std::memory_order_relaxed);
+	Stats.NodesVisited = m_StatNodesVisited.load(std::memory_order_relaxed);
+	Stats.SphereTests = m_StatSphereTests.load(std::memory_order_relaxed);
+	return Stats;
+}
+
+void HittableList::ResetTraversalStats()
+{
+	m_StatRays.store(0, std::memory_order_relaxed);
+	m_StatNodesVisited.store(0, std::memory_order_relaxed);
+	m_StatSphereTests.store(0, std::memory_order_relaxed);
+}
+
+//The compute shader buffers only exist in the Win32 build, the headless build has no D3D11 to hand them to
+#ifdef _WIN32
 SphereTransformBufferType* HittableList::GetCSTransformBuffer()
 {
 	if (m_CSTransformBuffer)
@@ -149,18 +336,21 @@ SphereMaterialBufferType* HittableList::GetCSMaterialBuffer()
 	m_CSMaterialBuffer = new SphereMaterialBufferType[m_NumObjects];
 	for (size_t i = 0; i < m_NumObjects; i++)
 	{
-		auto& [MaterialType, MaterialData] = m_VSphereMatComponent;
-		m_CSMaterialBuffer[i].Albedo = XMFLOAT3(MaterialData[i].Albedo.X, MaterialData[i].Albedo.Y, MaterialData[i].Albedo.Z);
-		m_CSMaterialBuffer[i].FuzzOrRI = MaterialData[i].FuzzOrRI;
-		m_CSMaterialBuffer[i].Type = MaterialType[i];
+		const MaterialScatterData& Data = m_VSphereMatComponent.MaterialData[i];
+		m_CSMaterialBuffer[i].Albedo = XMFLOAT3(Data.Albedo.X, Data.Albedo.Y, Data.Albedo.Z);
+		m_CSMaterialBuffer[i].FuzzOrRI = Data.FuzzOrRI;
+		m_CSMaterialBuffer[i].Type = m_VSphereMatComponent.MaterialTypes[i];
 	}
 	return m_CSMaterialBuffer;
 }
+#endif
 
 HittableList::~HittableList()
 {
+#ifdef _WIN32
 	delete[] m_CSTransformBuffer;
-	m_CSTransformBuffer = nullptr;
 	delete[] m_CSMaterialBuffer;
+#endif
+	m_CSTransformBuffer = nullptr;
 	m_CSMaterialBuffer = nullptr;
 }
\ No newline at end of file
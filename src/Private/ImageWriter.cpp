@@ -0,0 +1,131 @@
+#include "Public/ImageWriter.h"
+#include "Public/AOVBuffer.h"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+bool ImageWriter::WritePPM(const std::string& FilePath, const unsigned char* FrameBuffer, unsigned int Width, unsigned int Height)
+{
+	std::ofstream OutFile(FilePath, std::ios::binary);
+	if (!OutFile)
+	{
+		return false;
+	}
+	OutFile << "P6\n" << Width << ' ' << Height << "\n255\n";
+
+	//PPM wants R8G8B8, so swizzle one scanline at a time instead of copying the whole image
+	std::vector<unsigned char> Scanline((size_t)Width * 3);
+	for (unsigned int i = 0; i < Height; i++)
+	{
+		const unsigned char* Row = FrameBuffer + (size_t)i * Width * 4;
+		for (unsigned int j = 0; j < Width; j++)
+		{
+			Scanline[j * 3] = Row[j * 4 + 2];
+			Scanline[j * 3 + 1] = Row[j * 4 + 1];
+			Scanline[j * 3 + 2] = Row[j * 4];
+		}
+		OutFile.write(reinterpret_cast<const char*>(Scanline.data()), Scanline.size());
+	}
+	return (bool)OutFile;
+}
+
+bool ImageWriter::WriteSampleHeatmapPPM(const std::string& FilePath, const uint32_t* SampleCounts, unsigned int Width, unsigned int Height, uint32_t MaxCount)
+{
+	std::ofstream OutFile(FilePath, std::ios::binary);
+	if (!OutFile)
+	{
+		return false;
+	}
+	OutFile << "P6\n" << Width << ' ' << Height << "\n255\n";
+
+	//Piecewise linear ramp over four stops, t is the sample count relative to MaxCount
+	const float Stops[4][3] = { { 0.f, 0.f, 0.f }, { 0.f, 0.f, 255.f }, { 0.f, 255.f, 0.f }, { 255.f, 0.f, 0.f } };
+	const float Scale = MaxCount > 0 ? 1.f / (float)MaxCount : 0.f;
+	std::vector<unsigned char> Scanline((size_t)Width * 3);
+	for (unsigned int i = 0; i < Height; i++)
+	{
+		for (unsigned int j = 0; j < Width; j++)
+		{
+			const float t = std::min((float)SampleCounts[(size_t)i * Width + j] * Scale, 1.f) * 3.f;
+			const int Stop = std::min((int)t, 2);
+			const float Blend = t - (float)Stop;
+			for (int Channel = 0; Channel < 3; Channel++)
+			{
+				Scanline[j * 3 + Channel] = (unsigned char)(Stops[Stop][Channel] + (Stops[Stop + 1][Channel] - Stops[Stop][Channel]) * Blend);
+			}
+		}
+		OutFile.write(reinterpret_cast<const char*>(Scanline.data()), Scanline.size());
+	}
+	return (bool)OutFile;
+}
+
+bool ImageWriter::WritePFM(const std::string& FilePath, const float* const* Planes, unsigned int ChannelCount, unsigned int Width, unsigned int Height)
+{
+	std::ofstream OutFile(FilePath, std::ios::binary);
+	if (!OutFile || (ChannelCount != 1 && ChannelCount != 3))
+	{
+		return false;
+	}
+	//A negative scale marks the floats as little-endian, which is every platform this builds for
+	OutFile << (ChannelCount == 3 ? "PF\n" : "Pf\n") << Width << ' ' << Height << "\n-1.0\n";
+
+	//Interleave one scanline at a time, the planes stay planar in memory
+	std::vector<float> Scanline((size_t)Width * ChannelCount);
+	for (unsigned int i = Height; i-- > 0;)
+	{
+		const size_t RowStart = (size_t)i * Width;
+		for (unsigned int Channel = 0; Channel < ChannelCount; Channel++)
+		{
+			const float* Row = Planes[Channel] + RowStart;
+			for (unsigned int j = 0; j < Width; j++)
+			{
+				Scanline[j * ChannelCount + Channel] = Row[j];
+			}
+		}
+		OutFile.write(reinterpret_cast<const char*>(Scanline.data()), Scanline.size() * sizeof(float));
+	}
+	return (bool)OutFile;
+}
+
+bool ImageWriter::WriteAOVs(const std::string& BasePath, const VAOVBuffer& AOVs)
+{
+	const size_t Dot = BasePath.find_last_of('.');
+	const size_t Slash = BasePath.find_last_of("/\\");
+	const bool HasExtension = Dot != std::string::npos && (Slash == std::string::npos || Dot > Slash);
+	const std::string Stem = HasExtension ? BasePath.substr(0, Dot) : BasePath;
+	const unsigned int Width = AOVs.GetWidth();
+	const unsigned int Height = AOVs.GetHeight();
+	const size_t PixelCount = (size_t)Width * Height;
+	bool WasWritten = true;
+	std::vector<float> Converted;
+	if (AOVs.Has(AOVPlane::Distance))
+	{
+		const float* Planes[1] = { AOVs.GetDistance() };
+		WasWritten = WritePFM(Stem + "." + VAOVBuffer::GetPlaneName(AOVPlane::Distance) + ".pfm", Planes, 1, Width, Height) && WasWritten;
+	}
+	if (AOVs.Has(AOVPlane::Normal))
+	{
+		const float* Planes[3] = { AOVs.GetNormal(0), AOVs.GetNormal(1), AOVs.GetNormal(2) };
+		WasWritten = WritePFM(Stem + "." + VAOVBuffer::GetPlaneName(AOVPlane::Normal) + ".pfm", Planes, 3, Width, Height) && WasWritten;
+	}
+	if (AOVs.Has(AOVPlane::Albedo))
+	{
+		const float* Planes[3] = { AOVs.GetAlbedo(0), AOVs.GetAlbedo(1), AOVs.GetAlbedo(2) };
+		WasWritten = WritePFM(Stem + "." + VAOVBuffer::GetPlaneName(AOVPlane::Albedo) + ".pfm", Planes, 3, Width, Height) && WasWritten;
+	}
+	if (AOVs.Has(AOVPlane::ObjectID))
+	{
+		const int32_t* ObjectIDs = AOVs.GetObjectID();
+		Converted.assign(ObjectIDs, ObjectIDs + PixelCount);
+		const float* Planes[1] = { Converted.data() };
+		WasWritten = WritePFM(Stem + "." + VAOVBuffer::GetPlaneName(AOVPlane::ObjectID) + ".pfm", Planes, 1, Width, Height) && WasWritten;
+	}
+	if (AOVs.Has(AOVPlane::Material))
+	{
+		const uint8_t* Materials = AOVs.GetMaterial();
+		Converted.assign(Materials, Materials + PixelCount);
+		const float* Planes[1] = { Converted.data() };
+		WasWritten = WritePFM(Stem + "." + VAOVBuffer::GetPlaneName(AOVPlane::Material) + ".pfm", Planes, 1, Width, Height) && WasWritten;
+	}
+	return WasWritten;
+}
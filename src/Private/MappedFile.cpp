@@ -0,0 +1,71 @@
+#include "Public/MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+VMappedFile::~VMappedFile()
+{
+	if (!m_Data)
+	{
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(m_Data);
+#else
+	munmap(const_cast<unsigned char*>(m_Data), m_Size);
+#endif
+}
+
+bool VMappedFile::Open(const std::string& FilePath)
+{
+#ifdef _WIN32
+	HANDLE File = CreateFileA(FilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER FileSize;
+	HANDLE Mapping = nullptr;
+	if (GetFileSizeEx(File, &FileSize) && FileSize.QuadPart > 0)
+	{
+		Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	if (Mapping)
+	{
+		m_Data = static_cast<const unsigned char*>(MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0));
+		m_Size = m_Data ? (size_t)FileSize.QuadPart : 0;
+		//The view keeps the mapping alive on its own
+		CloseHandle(Mapping);
+	}
+	CloseHandle(File);
+	return m_Data != nullptr;
+#else
+	const int File = open(FilePath.c_str(), O_RDONLY);
+	if (File < 0)
+	{
+		return false;
+	}
+	struct stat FileStat;
+	if (fstat(File, &FileStat) == 0 && FileStat.st_size > 0)
+	{
+		void* Data = mmap(nullptr, (size_t)FileStat.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+		if (Data != MAP_FAILED)
+		{
+			//Every byte gets read front to back right away, let the kernel read ahead aggressively
+			madvise(Data, (size_t)FileStat.st_size, MADV_SEQUENTIAL);
+			madvise(Data, (size_t)FileStat.st_size, MADV_WILLNEED);
+			m_Data = static_cast<const unsigned char*>(Data);
+			m_Size = (size_t)FileStat.st_size;
+		}
+	}
+	//The mapping stays valid after the descriptor is closed
+	close(File);
+	return m_Data != nullptr;
+#endif
+}
@@ -0,0 +1,168 @@
+#include "Public/PerfCounters.h"
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+	struct PerfCounterConfig
+	{
+		uint32_t Type;
+		uint64_t Config;
+	};
+
+	//Indexed by PerfCounter. Cache misses are the last level cache misses, which is what tells us whether the hot loop waits on memory
+	const PerfCounterConfig g_CounterConfigs[(size_t)PerfCounter::Count] = {
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND },
+	};
+
+	int OpenCounter(const PerfCounterConfig& Config, int GroupFd)
+	{
+		perf_event_attr Attributes;
+		std::memset(&Attributes, 0, sizeof(Attributes));
+		Attributes.size = sizeof(Attributes);
+		Attributes.type = Config.Type;
+		Attributes.config = Config.Config;
+		Attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		//User space only, that is all perf_event_paranoid 2(the common default) allows and all our hot loops run in anyway
+		Attributes.exclude_kernel = 1;
+		Attributes.exclude_hv = 1;
+		//The leader starts disabled and enables the whole group once every member has joined
+		Attributes.disabled = GroupFd < 0 ? 1 : 0;
+		return (int)syscall(SYS_perf_event_open, &Attributes, 0, -1, GroupFd, 0);
+	}
+}
+
+VPerfCounterGroup::~VPerfCounterGroup()
+{
+	for (int& Fd : m_Fds)
+	{
+		if (Fd >= 0)
+		{
+			close(Fd);
+			Fd = -1;
+		}
+	}
+	m_LeaderFd = -1;
+}
+
+bool VPerfCounterGroup::Open(std::string* OutError)
+{
+	if (IsOpen())
+	{
+		return true;
+	}
+	int FirstErrno = 0;
+	for (size_t i = 0; i < (size_t)PerfCounter::Count; i++)
+	{
+		//The first counter that opens leads the group, so a CPU without a cycles event still gets the others
+		const int Fd = OpenCounter(g_CounterConfigs[i], m_LeaderFd);
+		if (Fd < 0)
+		{
+			FirstErrno = FirstErrno != 0 ? FirstErrno : errno;
+			continue;
+		}
+		m_Fds[i] = Fd;
+		m_LeaderFd = m_LeaderFd >= 0 ? m_LeaderFd : Fd;
+		m_ReadOrder[m_OpenCount++] = (PerfCounter)i;
+	}
+	if (!IsOpen())
+	{
+		if (OutError)
+		{
+			*OutError = std::string("perf_event_open failed: ") + std::strerror(FirstErrno);
+			if (FirstErrno == EACCES || FirstErrno == EPERM)
+			{
+				*OutError += " (see /proc/sys/kernel/perf_event_paranoid, or the container's seccomp profile)";
+			}
+			else if (FirstErrno == ENOENT || FirstErrno == EOPNOTSUPP)
+			{
+				*OutError += " (this CPU or VM exposes no hardware counters)";
+			}
+		}
+		return false;
+	}
+	ioctl(m_LeaderFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(m_LeaderFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return true;
+}
+
+PerfCounterValues VPerfCounterGroup::Read() const
+{
+	PerfCounterValues Result;
+	if (!IsOpen())
+	{
+		return Result;
+	}
+	//PERF_FORMAT_GROUP layout: count, time enabled, time running, then one value per member
+	uint64_t Buffer[3 + (size_t)PerfCounter::Count] = {};
+	const ssize_t BytesRead = read(m_LeaderFd, Buffer, sizeof(Buffer));
+	if (BytesRead < (ssize_t)(3 * sizeof(uint64_t)))
+	{
+		return Result;
+	}
+	const uint64_t Count = Buffer[0] < m_OpenCount ? Buffer[0] : m_OpenCount;
+	const uint64_t Enabled = Buffer[1];
+	const uint64_t Running = Buffer[2];
+	for (uint64_t i = 0; i < Count; i++)
+	{
+		uint64_t Value = Buffer[3 + i];
+		if (Running > 0 && Running < Enabled)
+		{
+			Value = (uint64_t)((double)Value * (double)Enabled / (double)Running);
+		}
+		Result.Values[(size_t)m_ReadOrder[i]] = Value;
+		Result.ValidMask |= 1u << (unsigned int)m_ReadOrder[i];
+	}
+	return Result;
+}
+
+#else
+
+VPerfCounterGroup::~VPerfCounterGroup()
+{
+}
+
+bool VPerfCounterGroup::Open(std::string* OutError)
+{
+	if (OutError)
+	{
+		*OutError = "hardware counters are only read on Linux";
+	}
+	return false;
+}
+
+PerfCounterValues VPerfCounterGroup::Read() const
+{
+	return PerfCounterValues();
+}
+
+#endif
+
+const char* VPerfCounterGroup::GetCounterName(PerfCounter Counter)
+{
+	switch (Counter)
+	{
+	case PerfCounter::Cycles:
+		return "cycles";
+	case PerfCounter::Instructions:
+		return "instructions";
+	case PerfCounter::CacheMisses:
+		return "cache misses";
+	case PerfCounter::BranchMisses:
+		return "branch misses";
+	case PerfCounter::BackendStalls:
+		return "backend stalls";
+	default:
+		return "unknown";
+	}
+}
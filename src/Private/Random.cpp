@@ -0,0 +1,90 @@
+#include "Public/Random.h"
+
+#if RAYTRACER_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+/*
+* PCG-RXS-M-XS with 32-bit state, one LCG per lane
+* 1. Advance the state with the 32-bit LCG
+* 2. Permute the old state: a random xorshift(the shift amount comes from the top 4 bits), a multiply and a fixed xorshift
+* Only 32-bit multiplies and per-lane shifts, which is exactly what AVX2 has(and what SSE4.2 lacks, the per-lane shift needs AVX2)
+*/
+namespace
+{
+	constexpr uint32_t g_LCGMultiplier = 747796405u;
+	constexpr uint32_t g_LCGIncrement = 2891336453u;
+	constexpr uint32_t g_OutputMultiplier = 277803737u;
+
+	using NextFloat8Func = void(*)(uint32_t* Lanes, float* Out);
+
+	void NextFloat8Scalar(uint32_t* Lanes, float* Out)
+	{
+		for (int i = 0; i < 8; i++)
+		{
+			const uint32_t State = Lanes[i];
+			Lanes[i] = State * g_LCGMultiplier + g_LCGIncrement;
+			uint32_t Word = ((State >> ((State >> 28u) + 4u)) ^ State) * g_OutputMultiplier;
+			Word = (Word >> 22u) ^ Word;
+			Out[i] = (float)(Word >> 8u) * (1.f / 16777216.f);
+		}
+	}
+
+#if RAYTRACER_X86_DISPATCH
+	RAYTRACER_TARGET_AVX2 void NextFloat8AVX2(uint32_t* Lanes, float* Out)
+	{
+		const __m256i State = _mm256_load_si256(reinterpret_cast<const __m256i*>(Lanes));
+		const __m256i NextState = _mm256_add_epi32(_mm256_mullo_epi32(State, _mm256_set1_epi32((int)g_LCGMultiplier)), _mm256_set1_epi32((int)g_LCGIncrement));
+		_mm256_store_si256(reinterpret_cast<__m256i*>(Lanes), NextState);
+
+		const __m256i Shift = _mm256_add_epi32(_mm256_srli_epi32(State, 28), _mm256_set1_epi32(4));
+		__m256i Word = _mm256_mullo_epi32(_mm256_xor_si256(_mm256_srlv_epi32(State, Shift), State), _mm256_set1_epi32((int)g_OutputMultiplier));
+		Word = _mm256_xor_si256(_mm256_srli_epi32(Word, 22), Word);
+		//After dropping 8 bits the value fits a signed int, so the signed conversion is exact
+		const __m256 Result = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(Word, 8)), _mm256_set1_ps(1.f / 16777216.f));
+		_mm256_storeu_ps(Out, Result);
+	}
+#endif
+
+	struct Random8Variant
+	{
+		NextFloat8Func NextFloat8;
+		const char* Name;
+	};
+
+	Random8Variant GetVariant(ISALevel Level)
+	{
+#if RAYTRACER_X86_DISPATCH
+		if (Level >= ISALevel::AVX2)
+		{
+			return Random8Variant{ &NextFloat8AVX2, "AVX2" };
+		}
+#endif
+		return Random8Variant{ &NextFloat8Scalar, "Scalar" };
+	}
+
+	Random8Variant g_ActiveVariant = GetVariant(CPUDispatch::GetActiveISA());
+}
+
+VRandom8::VRandom8(uint64_t Seed)
+{
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		m_Lanes[i] = (uint32_t)VRandom::MixSeed(Seed * 8u + i);
+	}
+}
+
+void VRandom8::NextFloat8(float* Out)
+{
+	g_ActiveVariant.NextFloat8(m_Lanes, Out);
+}
+
+void VRandom8::SelectISA(ISALevel Level)
+{
+	g_ActiveVariant = GetVariant(Level);
+}
+
+const char* VRandom8::GetKernelName()
+{
+	return g_ActiveVariant.Name;
+}
@@ -0,0 +1,700 @@
+#include "Public/RenderCore.h"
+#include "Public/SceneFile.h"
+#include "Public/SceneText.h"
+#include "Public/Timer.h"
+#include "Public/TraceRecorder.h"
+#include "Public/VMaterial.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	//The calling thread's counter group, opened on first use and kept for the life of the thread. Returns nullptr if this thread can not have one
+	VPerfCounterGroup* GetThreadPerfCounters(std::string* OutError = nullptr)
+	{
+		thread_local VPerfCounterGroup t_Group;
+		thread_local bool t_HasTriedOpen = false;
+		thread_local std::string t_Error;
+		if (!t_HasTriedOpen)
+		{
+			t_HasTriedOpen = true;
+			t_Group.Open(&t_Error);
+		}
+		if (OutError)
+		{
+			*OutError = t_Error;
+		}
+		return t_Group.IsOpen() ? &t_Group : nullptr;
+	}
+}
+
+RenderCore::RenderCore(const RenderSettings& Settings) : m_Settings(Settings), m_World(nullptr), m_FrameBuffer(nullptr), m_ThreadPool(nullptr)
+{
+
+}
+
+//Some of the viewport, fov, and aspect ratio logics can be moved into the camera class
+//But for this project such set up is fine
+bool RenderCore::Initialize()
+{
+	const unsigned int Width = m_Settings.Width;
+	const unsigned int Height = m_Settings.Height;
+	if (Width == 0 || Height == 0)
+	{
+		return false;
+	}
+
+	//Remember that our camera center is also the center of our coordinate system
+	m_Camera = Camera();
+	m_Camera.SetSampleCount(m_Settings.SampleCount);
+	m_Camera.SetMaxDepth(m_Settings.MaxDepth);
+	m_Camera.SetRouletteMinDepth((int)m_Settings.RouletteMinDepth);
+	m_Camera.SetSeed(m_Settings.Seed);
+	m_Camera.SetSampler(m_Settings.Sampler, Width);
+	UpdateViewport();
+
+	ThreadPoolPlacement Placement;
+	Placement.Mode = m_Settings.Placement;
+	Placement.NodeLimit = m_Settings.NUMANodeLimit;
+	m_ThreadPool = std::make_unique<VThreadPool>(m_Settings.ThreadCount, true, ThreadPoolQueueType::Mutex, 4096, Placement);
+	m_TileScheduler = std::make_unique<VTileScheduler>(*m_ThreadPool);
+
+	//Large new[] allocations are fresh mmap memory that nothing has touched yet, FirstTouch decides which node the pages land on
+	m_FrameBuffer = new unsigned char[(size_t)Width * Height * 4];//Each pixel needs four bytes for B8G8R8A8
+	FirstTouch(m_FrameBuffer, 4);
+	//The denoiser and the AOVs need the features only the accumulating path gathers, so they keep the sums like progressive mode does even when the frame is a single pass
+	const uint32_t AOVPlanes = m_Settings.AOVs & AOVPlane::All;
+	if (m_Settings.ProgressivePassSamples > 0 || m_Settings.AdaptiveThreshold > 0.f || m_Settings.Denoise || AOVPlanes != 0)
+	{
+		m_Accumulation.reset(new float[(size_t)Width * Height * 3]);
+		FirstTouch(m_Accumulation.get(), sizeof(float) * 3);
+	}
+	if (m_Settings.AdaptiveThreshold > 0.f)
+	{
+		m_LuminanceSquared.reset(new float[(size_t)Width * Height]);
+		m_SampleCounts.reset(new uint32_t[(size_t)Width * Height]);
+		m_Converged.reset(new uint8_t[(size_t)Width * Height]);
+		FirstTouch(m_LuminanceSquared.get(), sizeof(float));
+		FirstTouch(m_SampleCounts.get(), sizeof(uint32_t));
+		FirstTouch(m_Converged.get(), sizeof(uint8_t));
+	}
+	if (m_Settings.Denoise || (AOVPlanes & (AOVPlane::Albedo | AOVPlane::Normal)) != 0)
+	{
+		m_AlbedoSum.reset(new float[(size_t)Width * Height * 3]);
+		m_NormalSum.reset(new float[(size_t)Width * Height * 3]);
+		FirstTouch(m_AlbedoSum.get(), sizeof(float) * 3);
+		FirstTouch(m_NormalSum.get(), sizeof(float) * 3);
+	}
+	if (m_Settings.Denoise)
+	{
+		m_Denoiser = std::make_unique<VDenoiser>(Width, Height);
+	}
+	m_AOVs.Allocate(Width, Height, AOVPlanes);
+	m_ShouldCollectFeatures = m_Settings.Denoise || AOVPlanes != 0;
+
+	return true;
+}
+
+void RenderCore::SetCameraView(const CameraView& View)
+{
+	m_Camera.SetView(View);
+	UpdateViewport();
+}
+
+bool RenderCore::OpenHDROutput(const std::string& FilePath, std::string* OutError)
+{
+	HDRFormat Format;
+	if (!VHDRTileWriter::GetFormatFromPath(FilePath, Format))
+	{
+		if (OutError)
+		{
+			*OutError = FilePath + " is neither a .pfm nor an .exr path";
+		}
+		return false;
+	}
+	std::unique_ptr<VHDRTileWriter> Writer = std::make_unique<VHDRTileWriter>();
+	if (!Writer->Open(FilePath, Format, m_Settings.Width, m_Settings.Height, m_Settings.TileSize, OutError))
+	{
+		return false;
+	}
+	m_HDRWriter = std::move(Writer);
+	const size_t TilePixels = (size_t)m_Settings.TileSize * m_Settings.TileSize;
+	m_HDRTiles.assign(m_ThreadPool->GetThreadCount(), std::vector<Color>(TilePixels));
+	return true;
+}
+
+bool RenderCore::CloseHDROutput(std::string* OutError)
+{
+	if (!m_HDRWriter)
+	{
+		return true;
+	}
+	const bool WasWritten = m_HDRWriter->Close(OutError);
+	m_HDRWriter.reset();
+	m_HDRTiles.clear();
+	return WasWritten;
+}
+
+void RenderCore::UpdateViewport()
+{
+	float VFovAngle = Utility::DegreeToRadian(m_Camera.VerticalFOV);
+	float h = std::tan(VFovAngle / 2.f);
+	m_ViewportHeight = 2.f * h * m_Camera.FocusDistance;
+	m_ViewportWidth = m_ViewportHeight * ((float)m_Settings.Width / (float)m_Settings.Height);
+
+	m_ViewportU = m_ViewportWidth * m_Camera.CameraU;
+	m_ViewportV = m_ViewportHeight * (-m_Camera.CameraV);//This is negative because the viewport Y is inverted compared to right hand coordinate system
+	m_DeltaU = m_ViewportU / (float)(m_Settings.Width);
+	m_DeltaV = m_ViewportV / (float)(m_Settings.Height);
+}
+
+bool RenderCore::RenderFrameBuffer(const VTileScheduler::TileDoneFunc& OnTileDone, const std::function<bool(const ProgressivePass&)>& OnPassDone)
+{
+	/*
+	* Few things to note about getting the viewport upper left and the first pixel position:
+	* 1. The camera is pointing straight down the negative Z axis(Right-hand system btw), and pointing at the center of the viewport, hence subtracting focal length in Z
+	* 2. The viewport contains all the pixels(from 0th to Width - 1), however, we add half-pixel length spacings in both left-right and top-bottom, so the viewport can be divided nicely into Width x Height areas
+	* 3. Step 2 means we need to add half of the delta U and V to get to the first pixel location
+	*/
+	const unsigned int Width = m_Settings.Width;
+	const unsigned int Height = m_Settings.Height;
+	Point3D CameraCenter = m_Camera.CameraCenter;
+	Vector3D ViewportUpperLeft = CameraCenter - m_Camera.CameraW * m_Camera.FocusDistance - (m_ViewportU / 2.f) - (m_ViewportV / 2.f);
+	m_FirstPixelPos = ViewportUpperLeft + 0.5f * (m_DeltaU + m_DeltaV);
+	VProfileZone FrameZone("RenderFrameBuffer");
+	m_PerfCounters = RenderPerfCounters();
+	VPerfCounterGroup* PerfCounters = m_Settings.CollectPerfCounters ? GetThreadPerfCounters(&m_PerfCounters.Error) : nullptr;
+	PerfCounterValues PhaseStart;
+
+	if (!m_World)
+	{
+		VProfileZone CreateWorldZone("CreateWorld");
+		PhaseStart = PerfCounters ? PerfCounters->Read() : PerfCounterValues();
+		CreateWorld(m_Settings.Seed);
+		m_PerfCounters.CreateWorld = PerfCounters ? PerfCounterValues::Delta(PerfCounters->Read(), PhaseStart) : PerfCounterValues();
+	}
+	if (m_Settings.UseBVH && !m_World->GetBVH().IsBuilt())
+	{
+		VProfileZone BuildBVHZone("BuildBVH");
+		PhaseStart = PerfCounters ? PerfCounters->Read() : PerfCounterValues();
+		m_World->BuildBVH();
+		m_PerfCounters.BuildBVH = PerfCounters ? PerfCounterValues::Delta(PerfCounters->Read(), PhaseStart) : PerfCounterValues();
+	}
+	m_World->SetCollectTraversalStats(m_Settings.CollectTraversalStats);
+	m_World->ResetTraversalStats();
+	m_RenderStats.Reset();
+	if (RenderStats::IsCompiledIn())
+	{
+		m_WorkerRenderStats.assign(m_ThreadPool->GetThreadCount(), RenderStats());
+	}
+	if (m_Settings.CollectPerfCounters)
+	{
+		m_PerfCounters.Workers.assign(m_ThreadPool->GetThreadCount(), PerfCounterValues());
+	}
+	//Fresh copies every frame, cloning a few hundred spheres is nothing next to a frame and it keeps them in sync with the world
+	const unsigned int NodeCount = m_ThreadPool->GetNodeCount();
+	m_NodeWorlds.clear();
+	if (NodeCount > 1)
+	{
+		m_NodeWorlds.resize(NodeCount);
+		m_NodeWorldFlags = std::make_unique<std::once_flag[]>(NodeCount);
+	}
+
+	//Without progressive mode this is a single pass over every sample. Adaptive sampling may go past SampleCount on the pixels that stay noisy
+	const bool IsAdaptive = m_SampleCounts != nullptr;
+	unsigned int SampleCount = std::max(m_Settings.SampleCount, 1u);
+	if (IsAdaptive && m_Settings.AdaptiveMaxSamples > 0)
+	{
+		SampleCount = m_Settings.AdaptiveMaxSamples;
+	}
+	unsigned int PassSamples = SampleCount;
+	if (m_Settings.ProgressivePassSamples > 0 || IsAdaptive)
+	{
+		PassSamples = m_Settings.ProgressivePassSamples > 0 ? m_Settings.ProgressivePassSamples : 4;
+		PassSamples = std::min(PassSamples, SampleCount);
+	}
+	const unsigned int PassCount = (SampleCount + PassSamples - 1) / PassSamples;
+	m_AccumulatedSamples = 0;
+	m_TimeToFirstImage = 0.0;
+	bool Completed = true;
+	//The render time the UI and the headless executable report, world creation not included
+	VProfileZone TraceZone("Trace");
+	for (unsigned int Pass = 0; Pass < PassCount && Completed; Pass++)
+	{
+		const unsigned int SamplesBefore = m_AccumulatedSamples;
+		const unsigned int SamplesThisPass = std::min(PassSamples, SampleCount - SamplesBefore);
+		m_ActivePixels = 0;
+		VProfileZone PassZone("Pass", "pass", Pass);
+		Completed = m_TileScheduler->Run(Width, Height, m_Settings.TileSize, [this, SamplesThisPass, SamplesBefore](const RenderTile& Tile, unsigned int WorkerIndex)
+		{
+			TraceTile(Tile, WorkerIndex, SamplesThisPass, SamplesBefore);
+		}, OnTileDone);
+		if (!Completed)
+		{
+			break;
+		}
+
+		m_AccumulatedSamples += SamplesThisPass;
+		PassZone.Stop();
+		const double ElapsedMs = (double)TraceZone.GetElapsedNs() / 1e6;
+		if (Pass == 0)
+		{
+			m_TimeToFirstImage = ElapsedMs;
+		}
+		if (OnPassDone)
+		{
+			ProgressivePass PassInfo;
+			PassInfo.PassIndex = Pass;
+			PassInfo.PassCount = PassCount;
+			PassInfo.SamplesSoFar = m_AccumulatedSamples;
+			PassInfo.ActivePixels = m_ActivePixels;
+			PassInfo.ElapsedMs = ElapsedMs;
+			PassInfo.Snapshot = m_FrameBuffer;
+			Completed = OnPassDone(PassInfo);
+		}
+		if (IsAdaptive && m_ActivePixels == 0)
+		{
+			//Every pixel converged, the remaining passes would not trace a single ray
+			break;
+		}
+	}
+
+	const uint64_t TraceNs = TraceZone.Stop();
+	for (const RenderStats& WorkerStats : m_WorkerRenderStats)
+	{
+		m_RenderStats.Merge(WorkerStats);
+	}
+	for (const PerfCounterValues& WorkerCounters : m_PerfCounters.Workers)
+	{
+		m_PerfCounters.Trace.Add(WorkerCounters);
+	}
+	m_LastRenderTimeNs = TraceNs;
+	m_LastDenoiseTimeNs = 0;
+	if (Completed && m_AOVs.Has(AOVPlane::Albedo | AOVPlane::Normal))
+	{
+		ResolveAOVs();
+	}
+	if (Completed && m_Denoiser)
+	{
+		DenoiseFrame();
+	}
+	return Completed;
+}
+
+void RenderCore::TraceTile(const RenderTile& Tile, unsigned int WorkerIndex, unsigned int PassSamples, unsigned int SamplesBefore)
+{
+	HittableList& World = GetWorkerWorld(WorkerIndex);
+	const unsigned int Width = m_Settings.Width;
+	const float SampleScale = 1.f / (float)(SamplesBefore + PassSamples);
+	//Trace one tile row in linear space first, then convert it to B8G8R8A8 in one go so the conversion can run several pixels per instruction
+	Color LinearRow[256];
+	unsigned int ActivePixels = 0;
+	if (RenderStats::IsCompiledIn())
+	{
+		//Whatever this thread counted outside of a render(e.g. a benchmark calling the camera directly) is not part of this frame
+		RenderStats::Local().Reset();
+	}
+	VPerfCounterGroup* PerfCounters = m_Settings.CollectPerfCounters ? GetThreadPerfCounters() : nullptr;
+	const PerfCounterValues TileStart = PerfCounters ? PerfCounters->Read() : PerfCounterValues();
+	const unsigned int TileWidth = Tile.X1 - Tile.X0;
+	Color* HDRTile = m_HDRWriter ? m_HDRTiles[WorkerIndex].data() : nullptr;
+	for (unsigned int i = Tile.Y0; i < Tile.Y1; i++)
+	{
+		VTraceScope RowScope("Row", "render", "y", i);
+		for (unsigned int Start = Tile.X0; Start < Tile.X1; Start += 256)
+		{
+			const unsigned int Count = std::min(Tile.X1 - Start, 256u);
+			for (unsigned int j = 0; j < Count; j++)
+			{
+				Point3D PixelPos = m_FirstPixelPos + ((float)(Start + j) * m_DeltaU) + ((float)i * m_DeltaV);
+				if (m_SampleCounts)
+				{
+					LinearRow[j] = TraceAdaptivePixel(World, PixelPos, (size_t)i * Width + Start + j, PassSamples, SamplesBefore == 0, ActivePixels);
+					continue;
+				}
+				if (!m_Accumulation)
+				{
+					//Left unclamped for the HDR output, the frame buffer conversion does the same clamp Camera::CalculateHitColor would
+					LinearRow[j] = m_Camera.AccumulateSamples(World, PixelPos, m_DeltaU, m_DeltaV, i * Width + Start + j, 0, (int)PassSamples) * SampleScale;
+					continue;
+				}
+
+				//The accumulation buffer keeps the raw sums, the first pass overwrites whatever the last render left behind
+				FirstHitFeatures Features;
+				Color PassSum = m_Camera.AccumulateSamples(World, PixelPos, m_DeltaU, m_DeltaV, i * Width + Start + j, SamplesBefore, (int)PassSamples, nullptr,
+					m_ShouldCollectFeatures ? &Features : nullptr);
+				if (m_ShouldCollectFeatures)
+				{
+					AccumulateFeatures((size_t)i * Width + Start + j, Features, SamplesBefore == 0);
+				}
+				float* Accumulated = m_Accumulation.get() + ((size_t)i * Width + Start + j) * 3;
+				if (SamplesBefore > 0)
+				{
+					PassSum += Color(Accumulated[0], Accumulated[1], Accumulated[2]);
+				}
+				Accumulated[0] = PassSum.R();
+				Accumulated[1] = PassSum.G();
+				Accumulated[2] = PassSum.B();
+				LinearRow[j] = PassSum * SampleScale;
+			}
+			VTraceScope ConvertScope("ConvertRow", "render");
+			ConvertScanlineToBGRA8(LinearRow, m_FrameBuffer + ((size_t)i * Width + Start) * 4, Count);
+			if (HDRTile)
+			{
+				std::copy(LinearRow, LinearRow + Count, HDRTile + (size_t)(i - Tile.Y0) * TileWidth + (Start - Tile.X0));
+			}
+		}
+	}
+	if (HDRTile)
+	{
+		VTraceScope WriteScope("WriteHDRTile", "render");
+		m_HDRWriter->WriteTile(Tile, HDRTile, TileWidth);
+	}
+	if (ActivePixels > 0)
+	{
+		m_ActivePixels.fetch_add(ActivePixels, std::memory_order_relaxed);
+	}
+	if (RenderStats::IsCompiledIn())
+	{
+		m_WorkerRenderStats[WorkerIndex].Merge(RenderStats::Local());
+	}
+	if (PerfCounters)
+	{
+		m_PerfCounters.Workers[WorkerIndex].Add(PerfCounterValues::Delta(PerfCounters->Read(), TileStart));
+	}
+}
+
+Color RenderCore::TraceAdaptivePixel(HittableList& World, const Point3D& PixelPos, size_t PixelIndex, unsigned int PassSamples, bool IsFirstPass, unsigned int& InOutActivePixels)
+{
+	float* Accumulated = m_Accumulation.get() + PixelIndex * 3;
+	uint32_t& SampleCount = m_SampleCounts[PixelIndex];
+	float& LuminanceSquared = m_LuminanceSquared[PixelIndex];
+	uint8_t& HasConverged = m_Converged[PixelIndex];
+	if (IsFirstPass)
+	{
+		Accumulated[0] = Accumulated[1] = Accumulated[2] = 0.f;
+		SampleCount = 0;
+		LuminanceSquared = 0.f;
+		HasConverged = 0;
+	}
+
+	Color Sum(Accumulated[0], Accumulated[1], Accumulated[2]);
+	if (HasConverged)
+	{
+		return Sum * (1.f / (float)SampleCount);
+	}
+
+	float PassLuminanceSquared = 0.f;
+	FirstHitFeatures Features;
+	Sum += m_Camera.AccumulateSamples(World, PixelPos, m_DeltaU, m_DeltaV, (uint32_t)PixelIndex, SampleCount, (int)PassSamples, &PassLuminanceSquared,
+		m_ShouldCollectFeatures ? &Features : nullptr);
+	if (m_ShouldCollectFeatures)
+	{
+		AccumulateFeatures(PixelIndex, Features, SampleCount == 0);
+	}
+	SampleCount += PassSamples;
+	LuminanceSquared += PassLuminanceSquared;
+	Accumulated[0] = Sum.R();
+	Accumulated[1] = Sum.G();
+	Accumulated[2] = Sum.B();
+
+	/*
+	* Converged once the standard error of the mean luminance is a small enough fraction of the mean
+	* The 0.01 floor keeps near-black pixels from chasing a relative error they can never reach
+	*/
+	const float N = (float)SampleCount;
+	if (SampleCount >= std::max(m_Settings.AdaptiveMinSamples, 2u))
+	{
+		const float Mean = Luminance(Sum) / N;
+		const float Variance = std::max(0.f, (LuminanceSquared / N - Mean * Mean) * N / (N - 1.f));
+		const float StandardError = std::sqrt(Variance / N);
+		HasConverged = StandardError <= m_Settings.AdaptiveThreshold * std::max(Mean, 0.01f) ? 1 : 0;
+	}
+	if (!HasConverged)
+	{
+		InOutActivePixels++;
+	}
+	return Sum * (1.f / N);
+}
+
+void RenderCore::AccumulateFeatures(size_t PixelIndex, const FirstHitFeatures& Features, bool ShouldOverwrite)
+{
+	if (ShouldOverwrite)
+	{
+		if (float* Distance = m_AOVs.GetDistance())
+		{
+			Distance[PixelIndex] = Features.Distance;
+		}
+		if (int32_t* ObjectID = m_AOVs.GetObjectID())
+		{
+			ObjectID[PixelIndex] = Features.ObjectID;
+		}
+		if (uint8_t* Material = m_AOVs.GetMaterial())
+		{
+			Material[PixelIndex] = Features.Material;
+		}
+	}
+	if (!m_AlbedoSum)
+	{
+		return;
+	}
+	float* Albedo = m_AlbedoSum.get() + PixelIndex * 3;
+	float* Normal = m_NormalSum.get() + PixelIndex * 3;
+	if (ShouldOverwrite)
+	{
+		Albedo[0] = Albedo[1] = Albedo[2] = 0.f;
+		Normal[0] = Normal[1] = Normal[2] = 0.f;
+	}
+	Albedo[0] += Features.Albedo.R();
+	Albedo[1] += Features.Albedo.G();
+	Albedo[2] += Features.Albedo.B();
+	Normal[0] += Features.Normal.X;
+	Normal[1] += Features.Normal.Y;
+	Normal[2] += Features.Normal.Z;
+}
+
+void RenderCore::ResolveAOVs()
+{
+	VProfileZone ResolveZone("ResolveAOVs");
+	const unsigned int Width = m_Settings.Width;
+	m_TileScheduler->Run(Width, m_Settings.Height, m_Settings.TileSize, [this, Width](const RenderTile& Tile, unsigned int)
+	{
+		for (unsigned int i = Tile.Y0; i < Tile.Y1; i++)
+		{
+			for (size_t Pixel = (size_t)i * Width + Tile.X0; Pixel < (size_t)i * Width + Tile.X1; Pixel++)
+			{
+				const uint32_t Samples = m_SampleCounts ? m_SampleCounts[Pixel] : m_AccumulatedSamples;
+				const float Scale = 1.f / (float)std::max(Samples, 1u);
+				for (unsigned int c = 0; c < 3; c++)
+				{
+					if (float* Albedo = m_AOVs.GetAlbedo(c))
+					{
+						Albedo[Pixel] = m_AlbedoSum[Pixel * 3 + c] * Scale;
+					}
+					if (float* Normal = m_AOVs.GetNormal(c))
+					{
+						Normal[Pixel] = m_NormalSum[Pixel * 3 + c] * Scale;
+					}
+				}
+			}
+		}
+	});
+}
+
+void RenderCore::DenoiseFrame()
+{
+	VProfileZone DenoiseZone("Denoise");
+	const unsigned int Width = m_Settings.Width;
+	m_TileScheduler->Run(Width, m_Settings.Height, m_Settings.TileSize, [this, Width](const RenderTile& Tile, unsigned int)
+	{
+		float* ColorInput = m_Denoiser->GetColor();
+		float* AlbedoInput = m_Denoiser->GetAlbedo();
+		float* NormalInput = m_Denoiser->GetNormal();
+		for (unsigned int i = Tile.Y0; i < Tile.Y1; i++)
+		{
+			for (size_t Pixel = (size_t)i * Width + Tile.X0; Pixel < (size_t)i * Width + Tile.X1; Pixel++)
+			{
+				//Adaptive sampling gives every pixel its own count
+				const uint32_t Samples = m_SampleCounts ? m_SampleCounts[Pixel] : m_AccumulatedSamples;
+				const float Scale = 1.f / (float)std::max(Samples, 1u);
+				for (size_t c = Pixel * 3; c < Pixel * 3 + 3; c++)
+				{
+					ColorInput[c] = m_Accumulation[c] * Scale;
+					AlbedoInput[c] = m_AlbedoSum[c] * Scale;
+					NormalInput[c] = m_NormalSum[c] * Scale;
+				}
+			}
+		}
+	});
+
+	//Noise falls with the square root of the sample count, so does the color difference the filter should still treat as noise
+	DenoiseSettings Settings = m_Settings.DenoiserSettings;
+	Settings.ColorSigma /= std::sqrt((float)std::max(m_AccumulatedSamples, 1u));
+	m_Denoiser->Denoise(*m_TileScheduler, m_Settings.TileSize, Settings);
+
+	m_TileScheduler->Run(Width, m_Settings.Height, m_Settings.TileSize, [this, Width](const RenderTile& Tile, unsigned int)
+	{
+		//Color is a packed float triple(see ConvertScanlineToBGRA8), so the denoised rows convert in place
+		const Color* Denoised = reinterpret_cast<const Color*>(m_Denoiser->GetOutput());
+		for (unsigned int i = Tile.Y0; i < Tile.Y1; i++)
+		{
+			ConvertScanlineToBGRA8(Denoised + (size_t)i * Width + Tile.X0, m_FrameBuffer + ((size_t)i * Width + Tile.X0) * 4, Tile.X1 - Tile.X0);
+		}
+		if (m_HDRWriter)
+		{
+			m_HDRWriter->WriteTile(Tile, Denoised + (size_t)Tile.Y0 * Width + Tile.X0, Width);
+		}
+	});
+	m_LastDenoiseTimeNs = (long long int)DenoiseZone.Stop();
+}
+
+void RenderCore::FirstTouch(void* Buffer, size_t BytesPerPixel)
+{
+	const unsigned int Width = m_Settings.Width;
+	const unsigned int Height = m_Settings.Height;
+	unsigned char* Bytes = static_cast<unsigned char*>(Buffer);
+	if (m_ThreadPool->GetNodeCount() == 1)
+	{
+		memset(Bytes, 0, (size_t)Width * Height * BytesPerPixel);
+		return;
+	}
+	//Let each node zero its own band, the same bands the tile scheduler hands it while rendering
+	m_TileScheduler->RunNodeLocal(Width, Height, m_Settings.TileSize, [Bytes, Width, BytesPerPixel](const RenderTile& Tile, unsigned int)
+	{
+		for (unsigned int i = Tile.Y0; i < Tile.Y1; i++)
+		{
+			memset(Bytes + ((size_t)i * Width + Tile.X0) * BytesPerPixel, 0, (size_t)(Tile.X1 - Tile.X0) * BytesPerPixel);
+		}
+	});
+}
+
+HittableList& RenderCore::GetWorkerWorld(unsigned int WorkerIndex)
+{
+	if (m_NodeWorlds.empty())
+	{
+		return *m_World;
+	}
+	const unsigned int Node = m_ThreadPool->GetWorkerNode(WorkerIndex);
+	std::call_once(m_NodeWorldFlags[Node], [this, Node]()
+	{
+		//We are running on a worker pinned to this node, so the copy's pages land there
+		VProfileZone CloneZone("CloneWorld", "node", Node);
+		m_NodeWorlds[Node] = m_World->CloneSceneData();
+	});
+	return *m_NodeWorlds[Node];
+}
+
+TraversalStats RenderCore::GetTraversalStats() const
+{
+	TraversalStats Stats = m_World ? m_World->GetTraversalStats() : TraversalStats();
+	for (const std::unique_ptr<HittableList>& NodeWorld : m_NodeWorlds)
+	{
+		if (NodeWorld)
+		{
+			const TraversalStats NodeStats = NodeWorld->GetTraversalStats();
+			Stats.Rays += NodeStats.Rays;
+			Stats.NodesVisited += NodeStats.NodesVisited;
+			Stats.SphereTests += NodeStats.SphereTests;
+		}
+	}
+	return Stats;
+}
+
+RenderCore::~RenderCore()
+{
+	//Join the workers before releasing the frame buffer they may still be writing to
+	m_TileScheduler.reset();
+	m_ThreadPool.reset();
+	delete[] m_FrameBuffer;
+	m_FrameBuffer = nullptr;
+}
+
+bool RenderCore::LoadWorld(const std::string& FilePath, std::string* OutError, SceneTextStats* OutTextStats)
+{
+	VProfileZone LoadWorldZone("LoadWorld");
+	std::unique_ptr<CameraView> Camera;
+	const bool IsLoaded = SceneFile::IsBinaryScene(FilePath) ? SceneFile::Load(FilePath, m_World, Camera, m_Settings.UseBVH, OutError)
+		: SceneText::Load(FilePath, *m_ThreadPool, m_World, Camera, OutTextStats, OutError);
+	if (IsLoaded && Camera)
+	{
+		SetCameraView(*Camera);
+	}
+	return IsLoaded;
+}
+
+bool RenderCore::SaveWorld(const std::string& FilePath, std::string* OutError)
+{
+	if (!m_World)
+	{
+		VProfileZone CreateWorldZone("CreateWorld");
+		CreateWorld(m_Settings.Seed);
+	}
+	if (m_Settings.UseBVH && !m_World->GetBVH().IsBuilt())
+	{
+		VProfileZone BuildBVHZone("BuildBVH");
+		m_World->BuildBVH();
+	}
+	VProfileZone SaveWorldZone("SaveWorld");
+	const CameraView Camera = m_Camera.GetView();
+	return SceneFile::Save(FilePath, *m_World, &Camera, OutError);
+}
+
+void RenderCore::CreateWorld(uint64_t Seed)
+{
+	//The layout only depends on the seed, not on whatever the calling thread drew before
+	VRandom::SeedSceneGeneration(Seed);
+
+	//Create the materials and spheres in the world, I am keeping both my and the book's implementations so I can do some benchmark
+	/*
+	* Note on the calculation of RI for the glass sphere and the bubble. The glass is straightforward, it's just 1.5
+	* For the bubble, we need to remember that the RI of a surface can be interpreted as the RI of itself divided by the enclosing object
+	* Therefore, we have 1.f(air bubble) / 1.5f(glass layer)
+	*/
+	m_World = std::make_unique<HittableList>();
+	//SceneDensity D puts D x D smaller spheres into every cell of the original grid, so the field covers the same area. D = 1 is the original layout
+	const int Density = (int)std::max(m_Settings.SceneDensity, 1u);
+	//At most one sphere per grid cell plus the ground and the three big ones, so the arrays never grow while the field is added
+	m_World->Reserve((size_t)(22 * Density) * (22 * Density) + 4);
+	MaterialScatterData MatScatterData(0.f, Color(0.5f, 0.5f, 0.5f));
+	m_World->VAddSphere(SphereObjectData(Point3D(0.f, -1000.f, 0.f), 1000.f), MatScatterData, MaterialType::Lambertian);
+	const float CellSize = 1.f / (float)Density;
+	const float SmallRadius = 0.2f * CellSize;
+	for (int a = -11 * Density; a < 11 * Density; a++)
+	{
+		for (int b = -11 * Density; b < 11 * Density; b++)
+		{
+			SphereObjectData SphereData;
+			float ChooseMat = Utility::RandomFloat();
+			//Drawn one per statement since the evaluation order of constructor arguments is up to the compiler. Z first is the order the original one-liner got
+			const float OffsetZ = Utility::RandomFloat();
+			const float OffsetX = Utility::RandomFloat();
+			Point3D SphereCenter((a + 0.9f * OffsetX) * CellSize, SmallRadius, (b + 0.9f * OffsetZ) * CellSize);
+
+			if ((SphereCenter - Point3D(4.f, SmallRadius, 0.f)).Length() > 0.9f)
+			{
+				if (ChooseMat < 0.8f)
+				{
+					// diffuse
+					Color Albedo = Color::RandomVector() * Color::RandomVector();
+					MaterialScatterData MatScatterData;
+					MatScatterData.Albedo = Albedo;
+					SphereData.Center = SphereCenter;
+					SphereData.Radius = SmallRadius;
+					m_World->VAddSphere(SphereData, MatScatterData, MaterialType::Lambertian);
+				}
+				else if (ChooseMat < 0.95f)
+				{
+					// metal
+					Color Albedo = Color::RandomVector();
+					float Fuzz = Utility::RandomFloat(0.f, 0.5f);
+					MaterialScatterData MatScatterData;
+					MatScatterData.Albedo = Albedo;
+					MatScatterData.FuzzOrRI = Fuzz;
+					SphereData.Center = SphereCenter;
+					SphereData.Radius = SmallRadius;
+					m_World->VAddSphere(SphereData, MatScatterData, MaterialType::Metal);
+				}
+				else
+				{
+					// glass
+					MaterialScatterData MatScatterData;
+					MatScatterData.FuzzOrRI = 1.5f;
+					SphereData.Center = SphereCenter;
+					SphereData.Radius = SmallRadius;
+					m_World->VAddSphere(SphereData, MatScatterData, MaterialType::Dielectric);
+				}
+			}
+		}
+	}
+	MaterialScatterData ScatterData;
+	ScatterData.FuzzOrRI = 1.5f;
+	m_World->VAddSphere(SphereObjectData(Point3D(0.f, 1.f, 0.f), 1.f), ScatterData, MaterialType::Dielectric);
+
+	ScatterData.Albedo = Color(0.4f, 0.2f, 0.1f);
+	m_World->VAddSphere(SphereObjectData(Point3D(-4, 1, 0), 1.f), ScatterData, MaterialType::Lambertian);
+
+	ScatterData.Albedo = Color(0.7f, 0.6f, 0.5f);
+	ScatterData.FuzzOrRI = 0.f;
+	m_World->VAddSphere(SphereObjectData(Point3D(4, 1, 0), 1.f), ScatterData, MaterialType::Metal);
+}
@@ -0,0 +1,48 @@
+#include "Public/RenderStats.h"
+
+void RenderStats::Merge(const RenderStats& Other)
+{
+	for (unsigned int i = 0; i <= g_StatsMaxDepth; i++)
+	{
+		RaysPerDepth[i] += Other.RaysPerDepth[i];
+		PathLengths[i] += Other.PathLengths[i];
+	}
+	for (unsigned int i = 0; i < g_StatsMaterialCount; i++)
+	{
+		HitsPerMaterial[i] += Other.HitsPerMaterial[i];
+	}
+	SphereTests += Other.SphereTests;
+	PathsKilledByDepth += Other.PathsKilledByDepth;
+	PathsKilledByRoulette += Other.PathsKilledByRoulette;
+	PathsAbsorbed += Other.PathsAbsorbed;
+	PathsEscaped += Other.PathsEscaped;
+}
+
+uint64_t RenderStats::GetTotalRays() const
+{
+	uint64_t Total = 0;
+	for (unsigned int i = 0; i <= g_StatsMaxDepth; i++)
+	{
+		Total += RaysPerDepth[i];
+	}
+	return Total;
+}
+
+unsigned int RenderStats::GetPathLengthPercentile(double Fraction) const
+{
+	const uint64_t PathCount = GetPathCount();
+	if (PathCount == 0)
+	{
+		return 0;
+	}
+	uint64_t Covered = 0;
+	for (unsigned int Length = 0; Length <= g_StatsMaxDepth; Length++)
+	{
+		Covered += PathLengths[Length];
+		if ((double)Covered >= Fraction * (double)PathCount)
+		{
+			return Length;
+		}
+	}
+	return g_StatsMaxDepth;
+}
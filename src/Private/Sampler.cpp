@@ -0,0 +1,397 @@
+#include "Public/Sampler.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace
+{
+	struct SamplerState
+	{
+		SamplerType Type = SamplerType::Independent;
+		uint32_t PixelX = 0;
+		uint32_t PixelY = 0;
+		//Hash of(pixel, seed), every per-pixel scramble starts from it
+		uint32_t PixelSeed = 0;
+		//Hash of the seed alone, for the blue-noise mode where every pixel shares one sequence
+		uint32_t GlobalSeed = 0;
+		uint32_t SampleIndex = 0;
+		uint32_t DimensionBase = 0;
+	};
+
+	//Plain data, so the thread_local needs no init guard
+	thread_local SamplerState t_State;
+
+	constexpr float g_OneMinusEpsilon = 0x1.fffffep-1f;
+
+	uint32_t ReverseBits(uint32_t Value)
+	{
+		Value = (Value << 16u) | (Value >> 16u);
+		Value = ((Value & 0x00ff00ffu) << 8u) | ((Value & 0xff00ff00u) >> 8u);
+		Value = ((Value & 0x0f0f0f0fu) << 4u) | ((Value & 0xf0f0f0f0u) >> 4u);
+		Value = ((Value & 0x33333333u) << 2u) | ((Value & 0xccccccccu) >> 2u);
+		Value = ((Value & 0x55555555u) << 1u) | ((Value & 0xaaaaaaaau) >> 1u);
+		return Value;
+	}
+
+	uint32_t HashCombine(uint32_t Seed, uint32_t Value)
+	{
+		return (uint32_t)VRandom::MixSeed(((uint64_t)Seed << 32u) | Value);
+	}
+
+	//Laine and Karras' hash, each bit only depends on the bits below it. Run on reversed bits that makes it a nested uniform(Owen) scramble
+	uint32_t LaineKarrasPermutation(uint32_t Value, uint32_t Seed)
+	{
+		Value += Seed;
+		Value ^= Value * 0x6c50b47cu;
+		Value ^= Value * 0xb82f1e52u;
+		Value ^= Value * 0xc7afe638u;
+		Value ^= Value * 0x8d22f6e6u;
+		return Value;
+	}
+
+	uint32_t NestedUniformScramble(uint32_t Value, uint32_t Seed)
+	{
+		return ReverseBits(LaineKarrasPermutation(ReverseBits(Value), Seed));
+	}
+
+	//First two Sobol dimensions as 0.32 fixed point: the van der Corput sequence and the Pascal matrix one. Together they form a(0,2)-sequence
+	uint32_t SobolDimension0(uint32_t Index)
+	{
+		return ReverseBits(Index);
+	}
+	//The shuffled index uses all 32 bits, so instead of a 32 step loop over the direction numbers each index byte looks up the XOR of its eight
+	struct SobolDimension1Table
+	{
+		uint32_t Values[4][256];
+		SobolDimension1Table()
+		{
+			uint32_t Directions[32];
+			Directions[0] = 1u << 31u;
+			for (uint32_t i = 1; i < 32; i++)
+			{
+				Directions[i] = Directions[i - 1] ^ (Directions[i - 1] >> 1u);
+			}
+			for (uint32_t Byte = 0; Byte < 4; Byte++)
+			{
+				for (uint32_t Value = 0; Value < 256; Value++)
+				{
+					uint32_t Result = 0;
+					for (uint32_t Bit = 0; Bit < 8; Bit++)
+					{
+						Result ^= (Value >> Bit) & 1u ? Directions[Byte * 8 + Bit] : 0u;
+					}
+					Values[Byte][Value] = Result;
+				}
+			}
+		}
+	};
+	const SobolDimension1Table g_SobolDimension1;
+
+	uint32_t SobolDimension1(uint32_t Index)
+	{
+		return g_SobolDimension1.Values[0][Index & 0xffu] ^ g_SobolDimension1.Values[1][(Index >> 8u) & 0xffu] ^ g_SobolDimension1.Values[2][(Index >> 16u) & 0xffu]
+			^ g_SobolDimension1.Values[3][Index >> 24u];
+	}
+
+	float FixedToFloat(uint32_t Value)
+	{
+		return std::min((float)(Value >> 8u) * (1.f / 16777216.f), g_OneMinusEpsilon);
+	}
+
+	/*
+	* Radical inverse in any base with a nested random digit shift: each digit is shifted by a hash of(Seed, position, the digits before it)
+	* so points that share a prefix(the same stratum) still get independent shifts below it and the stratification of the sequence survives
+	* Digits are taken until the base's weight drops below float precision, leading zeros included, otherwise small indices would all land near 0
+	*/
+	float ScrambledRadicalInverse(uint32_t Base, uint32_t Index, uint32_t Seed)
+	{
+		const double InverseBase = 1.0 / Base;
+		double Result = 0.0;
+		double Scale = InverseBase;
+		uint64_t Prefix = 0;
+		for (uint32_t Digit = 0; Scale > 1.0 / 33554432.0; Digit++)
+		{
+			const uint32_t Value = Index % Base;
+			const uint32_t Shift = HashCombine(Seed + Digit * 0x9e3779b9u, (uint32_t)Prefix) % Base;
+			Result += ((Value + Shift) % Base) * Scale;
+			Prefix = Prefix * Base + Value;
+			Index /= Base;
+			Scale *= InverseBase;
+		}
+		return std::min((float)Result, g_OneMinusEpsilon);
+	}
+
+	/*
+	* 64x64 tileable blue-noise ranks from Ulichney's void-and-cluster method, built once on first use
+	* Every toggle updates the whole 4096 entry energy map, so the build is about 1e8 float operations: roughly 60 ms in a Release build
+	* and a second in Debug, paid by the first --sampler bluenoise render only
+	* 1. Start from a sparse random pattern and swap its tightest cluster into its largest void until that stops changing anything
+	* 2. Rank the starting points by repeatedly removing the tightest cluster, then rank the rest by repeatedly filling the largest void
+	* Energy is a toroidal Gaussian(sigma 1.5), so the mask tiles without seams
+	*/
+	class BlueNoiseMask
+	{
+	public:
+		static constexpr uint32_t Size = 64;
+		static constexpr uint32_t Count = Size * Size;
+
+		BlueNoiseMask()
+		{
+			float Kernel[Count];
+			for (uint32_t y = 0; y < Size; y++)
+			{
+				for (uint32_t x = 0; x < Size; x++)
+				{
+					const float Dx = (float)std::min(x, Size - x);
+					const float Dy = (float)std::min(y, Size - y);
+					Kernel[y * Size + x] = std::exp(-(Dx * Dx + Dy * Dy) / (2.f * 1.5f * 1.5f));
+				}
+			}
+			std::unique_ptr<uint8_t[]> Pattern = std::make_unique<uint8_t[]>(Count);
+			std::unique_ptr<float[]> Energy = std::make_unique<float[]>(Count);
+			std::fill(Pattern.get(), Pattern.get() + Count, (uint8_t)0);
+			std::fill(Energy.get(), Energy.get() + Count, 0.f);
+			auto Toggle = [&](uint32_t Index, bool IsSet)
+			{
+				Pattern[Index] = IsSet ? 1 : 0;
+				const uint32_t Px = Index % Size;
+				const uint32_t Py = Index / Size;
+				const float Sign = IsSet ? 1.f : -1.f;
+				for (uint32_t y = 0; y < Size; y++)
+				{
+					for (uint32_t x = 0; x < Size; x++)
+					{
+						Energy[y * Size + x] += Sign * Kernel[((y - Py) & (Size - 1)) * Size + ((x - Px) & (Size - 1))];
+					}
+				}
+			};
+			auto FindExtreme = [&](uint8_t Value, bool ShouldFindMax)
+			{
+				uint32_t Best = 0;
+				float BestEnergy = ShouldFindMax ? -1e30f : 1e30f;
+				for (uint32_t i = 0; i < Count; i++)
+				{
+					if (Pattern[i] == Value && (ShouldFindMax ? Energy[i] > BestEnergy : Energy[i] < BestEnergy))
+					{
+						Best = i;
+						BestEnergy = Energy[i];
+					}
+				}
+				return Best;
+			};
+
+			//Fixed seed, the mask is part of the sampler and must not change between runs
+			VRandom Generator(0x5eed, 7);
+			uint32_t InitialCount = 0;
+			while (InitialCount < Count / 10)
+			{
+				const uint32_t Index = Generator.NextUInt() % Count;
+				if (!Pattern[Index])
+				{
+					Toggle(Index, true);
+					InitialCount++;
+				}
+			}
+			for (uint32_t Iteration = 0; Iteration < Count; Iteration++)
+			{
+				const uint32_t Cluster = FindExtreme(1, true);
+				Toggle(Cluster, false);
+				const uint32_t Void = FindExtreme(0, false);
+				Toggle(Void, true);
+				if (Void == Cluster)
+				{
+					break;
+				}
+			}
+
+			std::unique_ptr<uint8_t[]> Initial = std::make_unique<uint8_t[]>(Count);
+			std::unique_ptr<float[]> InitialEnergy = std::make_unique<float[]>(Count);
+			std::memcpy(Initial.get(), Pattern.get(), Count);
+			std::memcpy(InitialEnergy.get(), Energy.get(), Count * sizeof(float));
+			for (uint32_t Rank = InitialCount; Rank-- > 0;)
+			{
+				const uint32_t Cluster = FindExtreme(1, true);
+				Toggle(Cluster, false);
+				m_Values[Cluster] = ((float)Rank + 0.5f) / (float)Count;
+			}
+			std::memcpy(Pattern.get(), Initial.get(), Count);
+			std::memcpy(Energy.get(), InitialEnergy.get(), Count * sizeof(float));
+			for (uint32_t Rank = InitialCount; Rank < Count; Rank++)
+			{
+				const uint32_t Void = FindExtreme(0, false);
+				Toggle(Void, true);
+				m_Values[Void] = ((float)Rank + 0.5f) / (float)Count;
+			}
+		}
+
+		float Get(uint32_t X, uint32_t Y) const
+		{
+			return m_Values[(Y & (Size - 1)) * Size + (X & (Size - 1))];
+		}
+
+	private:
+		float m_Values[Count];
+	};
+
+	const BlueNoiseMask& GetBlueNoiseMask()
+	{
+		static const BlueNoiseMask Mask;
+		return Mask;
+	}
+
+	float Wrap(float Value)
+	{
+		return Value >= 1.f ? Value - 1.f : Value;
+	}
+
+	void SamplePair(const SamplerState& State, uint32_t Pair, float& OutU, float& OutV)
+	{
+		switch (State.Type)
+		{
+			case SamplerType::Halton:
+			{
+				const uint32_t Seed = HashCombine(State.PixelSeed, Pair);
+				//Every pair reads the same Halton points, so all but the first(pixel jitter, kept whole) shuffle their order, otherwise sample i
+				//would sit in the same stratum in every pair and the pixel jitter would steer the bounce directions
+				const uint32_t Index = Pair == 0 ? State.SampleIndex : NestedUniformScramble(State.SampleIndex, HashCombine(Seed, 7u));
+				OutU = FixedToFloat(NestedUniformScramble(ReverseBits(Index), Seed));
+				OutV = ScrambledRadicalInverse(3, Index, HashCombine(Seed, 1u));
+				return;
+			}
+			case SamplerType::Sobol:
+			{
+				const uint32_t Seed = HashCombine(State.PixelSeed, Pair);
+				const uint32_t Index = NestedUniformScramble(State.SampleIndex, Seed);
+				OutU = FixedToFloat(NestedUniformScramble(SobolDimension0(Index), HashCombine(Seed, 1u)));
+				OutV = FixedToFloat(NestedUniformScramble(SobolDimension1(Index), HashCombine(Seed, 2u)));
+				return;
+			}
+			case SamplerType::BlueNoise:
+			{
+				//Same points in every pixel, only the toroidal shift differs. Each pair reads the mask at its own offset so the pairs stay uncorrelated
+				const uint32_t Seed = HashCombine(State.GlobalSeed, Pair);
+				const uint32_t Index = NestedUniformScramble(State.SampleIndex, Seed);
+				const BlueNoiseMask& Mask = GetBlueNoiseMask();
+				const uint32_t Offset = HashCombine(Seed, 3u);
+				const float ShiftU = Mask.Get(State.PixelX + (Offset & 63u), State.PixelY + ((Offset >> 6u) & 63u));
+				const float ShiftV = Mask.Get(State.PixelX + ((Offset >> 12u) & 63u), State.PixelY + ((Offset >> 18u) & 63u));
+				OutU = std::min(Wrap(FixedToFloat(SobolDimension0(Index)) + ShiftU), g_OneMinusEpsilon);
+				OutV = std::min(Wrap(FixedToFloat(SobolDimension1(Index)) + ShiftV), g_OneMinusEpsilon);
+				return;
+			}
+			default:
+			{
+				break;
+			}
+		}
+		OutU = Utility::RandomFloat();
+		OutV = Utility::RandomFloat();
+	}
+}
+
+void VSampler::BeginSample(SamplerType Type, uint32_t PixelIndex, uint32_t ImageWidth, uint32_t SampleIndex, uint64_t Seed)
+{
+	SamplerState& State = t_State;
+	State.Type = Type;
+	State.SampleIndex = SampleIndex;
+	State.DimensionBase = 0;
+	if (Type == SamplerType::Independent)
+	{
+		return;
+	}
+	State.PixelX = ImageWidth > 0 ? PixelIndex % ImageWidth : PixelIndex;
+	State.PixelY = ImageWidth > 0 ? PixelIndex / ImageWidth : 0;
+	State.GlobalSeed = (uint32_t)VRandom::MixSeed(Seed);
+	State.PixelSeed = HashCombine(State.GlobalSeed, PixelIndex);
+}
+
+void VSampler::SetBounce(uint32_t Bounce)
+{
+	t_State.DimensionBase = SampleDimension::CameraCount + Bounce * SampleDimension::PerBounce;
+}
+
+float VSampler::Get1D(uint32_t Offset)
+{
+	const SamplerState& State = t_State;
+	if (State.Type == SamplerType::Independent)
+	{
+		return Utility::RandomFloat();
+	}
+	//A 1D draw is one half of its pair, odd offsets take the second coordinate
+	const uint32_t Dimension = State.DimensionBase + Offset;
+	float U = 0.f;
+	float V = 0.f;
+	SamplePair(State, Dimension / 2u, U, V);
+	return (Dimension & 1u) ? V : U;
+}
+
+void VSampler::Get2D(uint32_t Offset, float& OutU, float& OutV)
+{
+	const SamplerState& State = t_State;
+	//Pairs start on even dimensions, which every 2D offset in SampleDimension is
+	SamplePair(State, (State.DimensionBase + Offset) / 2u, OutU, OutV);
+}
+
+Vector3D VSampler::UniformSphere(float U, float V)
+{
+	const float Z = 1.f - 2.f * U;
+	const float Radius = std::sqrt(std::max(0.f, 1.f - Z * Z));
+	const float Phi = 2.f * Constants::g_PI * V;
+	return Vector3D(Radius * std::cos(Phi), Radius * std::sin(Phi), Z);
+}
+
+Vector3D VSampler::ConcentricDisk(float U, float V)
+{
+	const float OffsetU = 2.f * U - 1.f;
+	const float OffsetV = 2.f * V - 1.f;
+	if (OffsetU == 0.f && OffsetV == 0.f)
+	{
+		return Vector3D(0.f, 0.f, 0.f);
+	}
+	float Radius = 0.f;
+	float Theta = 0.f;
+	if (std::abs(OffsetU) > std::abs(OffsetV))
+	{
+		Radius = OffsetU;
+		Theta = Constants::g_PI / 4.f * (OffsetV / OffsetU);
+	}
+	else
+	{
+		Radius = OffsetV;
+		Theta = Constants::g_PI / 2.f - Constants::g_PI / 4.f * (OffsetU / OffsetV);
+	}
+	return Vector3D(Radius * std::cos(Theta), Radius * std::sin(Theta), 0.f);
+}
+
+const char* VSampler::GetSamplerName(SamplerType Type)
+{
+	switch (Type)
+	{
+	case SamplerType::Halton:
+		return "halton";
+	case SamplerType::Sobol:
+		return "sobol";
+	case SamplerType::BlueNoise:
+		return "bluenoise";
+	default:
+		return "independent";
+	}
+}
+
+bool VSampler::ParseSamplerName(const char* Name, SamplerType& OutType)
+{
+	for (SamplerType Type : { SamplerType::Independent, SamplerType::Halton, SamplerType::Sobol, SamplerType::BlueNoise })
+	{
+		if (std::strcmp(Name, GetSamplerName(Type)) == 0)
+		{
+			OutType = Type;
+			return true;
+		}
+	}
+	if (std::strcmp(Name, "random") == 0)
+	{
+		OutType = SamplerType::Independent;
+		return true;
+	}
+	return false;
+}
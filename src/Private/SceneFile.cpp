@@ -0,0 +1,199 @@
+#include "Public/SceneFile.h"
+#include "Public/MappedFile.h"
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <vector>
+
+//The sections are the in-memory arrays byte for byte, so their element layout is part of the format
+static_assert(std::endian::native == std::endian::little, "The scene file format is little-endian");
+static_assert(sizeof(SphereTransformData) == 16 && std::is_trivially_copyable_v<SphereTransformData>);
+static_assert(sizeof(MaterialScatterData) == 16 && std::is_trivially_copyable_v<MaterialScatterData>);
+static_assert(sizeof(MaterialType) == 1);
+static_assert(sizeof(BVHNode) == 32 && std::is_trivially_copyable_v<BVHNode>);
+static_assert(std::is_trivially_copyable_v<SceneFileHeader>);
+//Version 1 headers end where the camera starts
+static constexpr uint32_t g_SceneFileHeaderSizeV1 = offsetof(SceneFileHeader, Camera);
+
+namespace
+{
+	constexpr uint64_t g_SectionAlignment = 64;
+
+	uint64_t AlignSection(uint64_t Offset)
+	{
+		return (Offset + g_SectionAlignment - 1) / g_SectionAlignment * g_SectionAlignment;
+	}
+
+	//True if Count elements of ElementSize bytes starting at Offset lie inside the file and the section is aligned like the writer aligns it
+	bool IsSectionInFile(uint64_t Offset, uint64_t Count, size_t ElementSize, size_t FileSize)
+	{
+		return Offset % g_SectionAlignment == 0 && Offset <= FileSize && Count <= (FileSize - Offset) / ElementSize;
+	}
+
+	void SetError(std::string* OutError, const std::string& Message)
+	{
+		if (OutError)
+		{
+			*OutError = Message;
+		}
+	}
+
+	//Pad the stream to the next section boundary and write one array there, returns the offset it went to
+	uint64_t WriteSection(std::ofstream& OutFile, uint64_t& InOutOffset, const void* Data, size_t ByteCount)
+	{
+		static const char Padding[g_SectionAlignment] = {};
+		const uint64_t SectionOffset = AlignSection(InOutOffset);
+		OutFile.write(Padding, (std::streamsize)(SectionOffset - InOutOffset));
+		OutFile.write(static_cast<const char*>(Data), (std::streamsize)ByteCount);
+		InOutOffset = SectionOffset + ByteCount;
+		return SectionOffset;
+	}
+}
+
+bool SceneFile::Save(const std::string& FilePath, const HittableList& World, const CameraView* Camera, std::string* OutError)
+{
+	std::ofstream OutFile(FilePath, std::ios::binary);
+	if (!OutFile)
+	{
+		SetError(OutError, "can not open " + FilePath + " for writing");
+		return false;
+	}
+
+	const std::vector<SphereTransformData>& Transforms = World.GetSphereTransforms();
+	const VSphereMatComponent& Materials = World.GetSphereMaterialData();
+	const AlignedVector<BVHNode>& Nodes = World.GetBVH().GetNodes();
+	const uint64_t SphereCount = Transforms.size();
+
+	//The header goes first with the offsets left at zero and is rewritten once the sections are placed
+	SceneFileHeader Header;
+	std::memcpy(Header.Magic, g_SceneFileMagic, sizeof(Header.Magic));
+	Header.Version = g_SceneFileVersion;
+	Header.HeaderSize = sizeof(SceneFileHeader);
+	if (Camera)
+	{
+		Header.Camera.HasCamera = 1;
+		Header.Camera.CameraCenter[0] = Camera->CameraCenter.X;
+		Header.Camera.CameraCenter[1] = Camera->CameraCenter.Y;
+		Header.Camera.CameraCenter[2] = Camera->CameraCenter.Z;
+		Header.Camera.LookAt[0] = Camera->LookAt.X;
+		Header.Camera.LookAt[1] = Camera->LookAt.Y;
+		Header.Camera.LookAt[2] = Camera->LookAt.Z;
+		Header.Camera.VerticalFOV = Camera->VerticalFOV;
+		Header.Camera.FocusDistance = Camera->FocusDistance;
+		Header.Camera.DefocusAngle = Camera->DefocusAngle;
+	}
+	OutFile.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	uint64_t Offset = sizeof(Header);
+	Header.Transforms = SceneFileSection{ WriteSection(OutFile, Offset, Transforms.data(), SphereCount * sizeof(SphereTransformData)), SphereCount };
+	Header.MaterialData = SceneFileSection{ WriteSection(OutFile, Offset, Materials.MaterialData.data(), SphereCount * sizeof(MaterialScatterData)), SphereCount };
+	Header.MaterialTypes = SceneFileSection{ WriteSection(OutFile, Offset, Materials.MaterialTypes.data(), SphereCount * sizeof(MaterialType)), SphereCount };
+	Header.SphereIDOffset = WriteSection(OutFile, Offset, Materials.SphereIDs.data(), SphereCount * sizeof(uint32_t));
+	Header.BVHNodes = SceneFileSection{ WriteSection(OutFile, Offset, Nodes.data(), Nodes.size() * sizeof(BVHNode)), Nodes.size() };
+	OutFile.seekp(0);
+	OutFile.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	if (!OutFile)
+	{
+		SetError(OutError, "failed to write " + FilePath);
+		return false;
+	}
+	return true;
+}
+
+bool SceneFile::IsBinaryScene(const std::string& FilePath)
+{
+	std::ifstream InFile(FilePath, std::ios::binary);
+	char Magic[sizeof(g_SceneFileMagic)] = {};
+	return InFile.read(Magic, sizeof(Magic)) && std::memcmp(Magic, g_SceneFileMagic, sizeof(Magic)) == 0;
+}
+
+bool SceneFile::Load(const std::string& FilePath, std::unique_ptr<HittableList>& OutWorld, std::unique_ptr<CameraView>& OutCamera, bool ShouldUseBVH, std::string* OutError)
+{
+	VMappedFile File;
+	if (!File.Open(FilePath))
+	{
+		SetError(OutError, "can not map " + FilePath);
+		return false;
+	}
+
+	/*
+	* Validate before touching any section:
+	* 1. Magic, version and header size. A version 1 header is the current one without the camera, newer versions are refused
+	* 2. Every section inside the file and on its boundary, the three sphere sections the same length
+	* 3. Sphere counts that fit the 32 bit indices the rest of the renderer uses
+	*/
+	SceneFileHeader Header;
+	if (File.GetSize() < g_SceneFileHeaderSizeV1)
+	{
+		SetError(OutError, FilePath + " is too small to be a scene file");
+		return false;
+	}
+	//Only the version 1 prefix is known to be there yet, so it goes through a zeroed buffer and the header is always copied whole
+	unsigned char HeaderBytes[sizeof(SceneFileHeader)] = {};
+	std::memcpy(HeaderBytes, File.GetData(), g_SceneFileHeaderSizeV1);
+	std::memcpy(&Header, HeaderBytes, sizeof(Header));
+	if (std::memcmp(Header.Magic, g_SceneFileMagic, sizeof(Header.Magic)) != 0)
+	{
+		SetError(OutError, FilePath + " is not a scene file");
+		return false;
+	}
+	const bool IsVersion1 = Header.Version == 1 && Header.HeaderSize == g_SceneFileHeaderSizeV1;
+	const bool IsCurrentVersion = Header.Version == g_SceneFileVersion && Header.HeaderSize == sizeof(Header) && File.GetSize() >= sizeof(Header);
+	if (IsCurrentVersion)
+	{
+		std::memcpy(&Header, File.GetData(), sizeof(Header));
+	}
+	else if (!IsVersion1)
+	{
+		SetError(OutError, FilePath + " is scene file version " + std::to_string(Header.Version) + ", this build reads versions 1 to " + std::to_string(g_SceneFileVersion));
+		return false;
+	}
+	const uint64_t SphereCount = Header.Transforms.Count;
+	const size_t FileSize = File.GetSize();
+	if (SphereCount >= UINT32_MAX || Header.MaterialData.Count != SphereCount || Header.MaterialTypes.Count != SphereCount || Header.BVHNodes.Count >= UINT32_MAX
+		|| !IsSectionInFile(Header.Transforms.Offset, SphereCount, sizeof(SphereTransformData), FileSize)
+		|| !IsSectionInFile(Header.MaterialData.Offset, SphereCount, sizeof(MaterialScatterData), FileSize)
+		|| !IsSectionInFile(Header.MaterialTypes.Offset, SphereCount, sizeof(MaterialType), FileSize)
+		|| !IsSectionInFile(Header.SphereIDOffset, SphereCount, sizeof(uint32_t), FileSize)
+		|| !IsSectionInFile(Header.BVHNodes.Offset, Header.BVHNodes.Count, sizeof(BVHNode), FileSize))
+	{
+		SetError(OutError, FilePath + " is truncated or its section table is corrupt");
+		return false;
+	}
+
+	const unsigned char* Data = File.GetData();
+	const MaterialType* MaterialTypes = reinterpret_cast<const MaterialType*>(Data + Header.MaterialTypes.Offset);
+	for (uint64_t i = 0; i < SphereCount; i++)
+	{
+		//The scatter dispatch switches over the type, anything past the last one would fall off the end of it
+		if ((uint8_t)MaterialTypes[i] > (uint8_t)MaterialType::Dielectric)
+		{
+			SetError(OutError, FilePath + " has an unknown material type on sphere " + std::to_string(i));
+			return false;
+		}
+	}
+
+	//The mapping is page aligned and the sections are 64 byte aligned within it, so the element pointers are properly aligned for a bulk copy
+	std::unique_ptr<HittableList> World = std::make_unique<HittableList>();
+	World->VAddSpheres(reinterpret_cast<const SphereTransformData*>(Data + Header.Transforms.Offset), reinterpret_cast<const MaterialScatterData*>(Data + Header.MaterialData.Offset),
+		MaterialTypes, (size_t)SphereCount, reinterpret_cast<const uint32_t*>(Data + Header.SphereIDOffset));
+	if (ShouldUseBVH && Header.BVHNodes.Count > 0
+		&& !World->AssignBVH(reinterpret_cast<const BVHNode*>(Data + Header.BVHNodes.Offset), (unsigned int)Header.BVHNodes.Count))
+	{
+		SetError(OutError, FilePath + " has a BVH that does not fit its spheres");
+		return false;
+	}
+	OutWorld = std::move(World);
+	OutCamera.reset();
+	if (Header.Camera.HasCamera)
+	{
+		OutCamera = std::make_unique<CameraView>();
+		OutCamera->CameraCenter = Point3D(Header.Camera.CameraCenter[0], Header.Camera.CameraCenter[1], Header.Camera.CameraCenter[2]);
+		OutCamera->LookAt = Point3D(Header.Camera.LookAt[0], Header.Camera.LookAt[1], Header.Camera.LookAt[2]);
+		OutCamera->VerticalFOV = Header.Camera.VerticalFOV;
+		OutCamera->FocusDistance = Header.Camera.FocusDistance;
+		OutCamera->DefocusAngle = Header.Camera.DefocusAngle;
+	}
+	return true;
+}
@@ -0,0 +1,307 @@
+#include "Public/SceneText.h"
+#include "Public/MappedFile.h"
+#include "Public/ThreadPool.h"
+#include "Public/Timer.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+	//Big enough that the per-chunk setup is noise, small enough that a few MB file still spreads over every worker
+	constexpr size_t g_ChunkBytes = 1 << 20;
+
+	//What one chunk parsed. Line numbers are chunk-local until the chunks are stitched back together
+	struct ParsedChunk
+	{
+		const char* Begin = nullptr;
+		const char* End = nullptr;
+		std::vector<SphereTransformData> Transforms;
+		std::vector<MaterialScatterData> MaterialData;
+		std::vector<MaterialType> MaterialTypes;
+		size_t Lines = 0;
+		bool HasCamera = false;
+		CameraView Camera;
+		//Line of the first error, 0 if the chunk parsed cleanly
+		size_t ErrorLine = 0;
+		std::string Error;
+	};
+
+	//Token reader over a single line. A '#' ends the line like its real end does
+	class VLineReader
+	{
+	public:
+		VLineReader(const char* Begin, const char* End) : m_Pos(Begin), m_End(End) {}
+
+		bool NextToken(std::string_view& OutToken)
+		{
+			while (m_Pos < m_End && (*m_Pos == ' ' || *m_Pos == '\t' || *m_Pos == '\r'))
+			{
+				m_Pos++;
+			}
+			if (m_Pos == m_End || *m_Pos == '#')
+			{
+				m_Pos = m_End;
+				return false;
+			}
+			const char* Start = m_Pos;
+			while (m_Pos < m_End && *m_Pos != ' ' && *m_Pos != '\t' && *m_Pos != '\r' && *m_Pos != '#')
+			{
+				m_Pos++;
+			}
+			OutToken = std::string_view(Start, (size_t)(m_Pos - Start));
+			return true;
+		}
+
+		//The whole token has to be a finite number, "1.5x" or "nan" are errors rather than 1.5 or a sphere no ray can hit
+		bool NextFloat(float& OutValue)
+		{
+			std::string_view Token;
+			if (!NextToken(Token))
+			{
+				return false;
+			}
+			const std::from_chars_result Result = std::from_chars(Token.data(), Token.data() + Token.size(), OutValue);
+			return Result.ec == std::errc() && Result.ptr == Token.data() + Token.size() && std::isfinite(OutValue);
+		}
+
+		bool NextVector(Vector3D& OutValue)
+		{
+			return NextFloat(OutValue.X) && NextFloat(OutValue.Y) && NextFloat(OutValue.Z);
+		}
+
+		bool IsAtEnd()
+		{
+			std::string_view Token;
+			return !NextToken(Token);
+		}
+
+	private:
+		const char* m_Pos;
+		const char* m_End;
+	};
+
+	//Parse one "sphere" line after its keyword. Returns an error message, or nullptr on success
+	const char* ParseSphere(VLineReader& Reader, ParsedChunk& Chunk)
+	{
+		SphereTransformData Transform;
+		if (!Reader.NextVector(Transform.SphereCenter) || !Reader.NextFloat(Transform.SphereRadius))
+		{
+			return "sphere needs a center(x y z) and a radius";
+		}
+		std::string_view Material;
+		if (!Reader.NextToken(Material))
+		{
+			return "sphere needs a material: lambertian, metal or dielectric";
+		}
+		MaterialScatterData ScatterData;
+		MaterialType Type;
+		if (Material == "lambertian")
+		{
+			Type = MaterialType::Lambertian;
+			if (!Reader.NextVector(ScatterData.Albedo))
+			{
+				return "lambertian needs an albedo(r g b)";
+			}
+		}
+		else if (Material == "metal")
+		{
+			Type = MaterialType::Metal;
+			if (!Reader.NextVector(ScatterData.Albedo) || !Reader.NextFloat(ScatterData.FuzzOrRI))
+			{
+				return "metal needs an albedo(r g b) and a fuzz";
+			}
+		}
+		else if (Material == "dielectric")
+		{
+			Type = MaterialType::Dielectric;
+			if (!Reader.NextFloat(ScatterData.FuzzOrRI))
+			{
+				return "dielectric needs a refraction index";
+			}
+		}
+		else
+		{
+			return "unknown material, expected lambertian, metal or dielectric";
+		}
+		if (!Reader.IsAtEnd())
+		{
+			return "unexpected text after the sphere";
+		}
+		Chunk.Transforms.push_back(Transform);
+		Chunk.MaterialData.push_back(ScatterData);
+		Chunk.MaterialTypes.push_back(Type);
+		return nullptr;
+	}
+
+	//Parse one "camera" line after its keyword. Settings it leaves out keep the CameraView defaults
+	const char* ParseCamera(VLineReader& Reader, ParsedChunk& Chunk)
+	{
+		CameraView Camera;
+		std::string_view Setting;
+		while (Reader.NextToken(Setting))
+		{
+			bool IsValid = false;
+			if (Setting == "center")
+			{
+				IsValid = Reader.NextVector(Camera.CameraCenter);
+			}
+			else if (Setting == "lookat")
+			{
+				IsValid = Reader.NextVector(Camera.LookAt);
+			}
+			else if (Setting == "vfov")
+			{
+				IsValid = Reader.NextFloat(Camera.VerticalFOV);
+			}
+			else if (Setting == "focus")
+			{
+				IsValid = Reader.NextFloat(Camera.FocusDistance);
+			}
+			else if (Setting == "defocus")
+			{
+				IsValid = Reader.NextFloat(Camera.DefocusAngle);
+			}
+			else
+			{
+				return "unknown camera setting, expected center, lookat, vfov, focus or defocus";
+			}
+			if (!IsValid)
+			{
+				return "camera setting is missing its number(s)";
+			}
+		}
+		Chunk.HasCamera = true;
+		Chunk.Camera = Camera;
+		return nullptr;
+	}
+
+	void ParseChunk(ParsedChunk& Chunk)
+	{
+		//A sphere line is 40 to 80 bytes, reserving for the short end keeps the arrays from growing more than once or twice
+		const size_t ExpectedSpheres = (size_t)(Chunk.End - Chunk.Begin) / 40;
+		Chunk.Transforms.reserve(ExpectedSpheres);
+		Chunk.MaterialData.reserve(ExpectedSpheres);
+		Chunk.MaterialTypes.reserve(ExpectedSpheres);
+		const char* LineBegin = Chunk.Begin;
+		while (LineBegin < Chunk.End)
+		{
+			const char* LineEnd = static_cast<const char*>(std::memchr(LineBegin, '\n', (size_t)(Chunk.End - LineBegin)));
+			LineEnd = LineEnd ? LineEnd : Chunk.End;
+			Chunk.Lines++;
+			VLineReader Reader(LineBegin, LineEnd);
+			std::string_view Keyword;
+			const char* Error = nullptr;
+			if (Reader.NextToken(Keyword))
+			{
+				if (Keyword == "sphere")
+				{
+					Error = ParseSphere(Reader, Chunk);
+				}
+				else if (Keyword == "camera")
+				{
+					Error = ParseCamera(Reader, Chunk);
+				}
+				else
+				{
+					Error = "unknown statement, expected camera or sphere";
+				}
+			}
+			if (Error)
+			{
+				Chunk.ErrorLine = Chunk.Lines;
+				Chunk.Error = Error;
+				return;
+			}
+			LineBegin = LineEnd + 1;
+		}
+	}
+
+	void SetError(std::string* OutError, const std::string& Message)
+	{
+		if (OutError)
+		{
+			*OutError = Message;
+		}
+	}
+}
+
+bool SceneText::Load(const std::string& FilePath, VThreadPool& Pool, std::unique_ptr<HittableList>& OutWorld, std::unique_ptr<CameraView>& OutCamera,
+	SceneTextStats* OutStats, std::string* OutError)
+{
+	VTimer ParseTimer;
+	ParseTimer.Start();
+	VMappedFile File;
+	if (!File.Open(FilePath))
+	{
+		SetError(OutError, "can not map " + FilePath + " (missing or empty)");
+		return false;
+	}
+
+	//Cut the file at the first line break past every chunk size step, so no line straddles two chunks
+	const char* Data = reinterpret_cast<const char*>(File.GetData());
+	const char* DataEnd = Data + File.GetSize();
+	std::vector<ParsedChunk> Chunks;
+	for (const char* ChunkBegin = Data; ChunkBegin < DataEnd;)
+	{
+		const char* ChunkEnd = ChunkBegin + std::min(g_ChunkBytes, (size_t)(DataEnd - ChunkBegin));
+		const char* LineBreak = ChunkEnd < DataEnd ? static_cast<const char*>(std::memchr(ChunkEnd, '\n', (size_t)(DataEnd - ChunkEnd))) : nullptr;
+		ChunkEnd = LineBreak ? LineBreak + 1 : (ChunkEnd < DataEnd ? DataEnd : ChunkEnd);
+		ParsedChunk& Chunk = Chunks.emplace_back();
+		Chunk.Begin = ChunkBegin;
+		Chunk.End = ChunkEnd;
+		ChunkBegin = ChunkEnd;
+	}
+
+	Pool.ParallelFor(0, Chunks.size(), 1, [&Chunks](size_t ChunkBegin, size_t ChunkEnd)
+	{
+		for (size_t i = ChunkBegin; i < ChunkEnd; i++)
+		{
+			ParseChunk(Chunks[i]);
+		}
+	});
+
+	//Stitch the chunks back together in file order: line numbers for the first error, the last camera, the sphere total
+	size_t LinesBefore = 0;
+	size_t SphereCount = 0;
+	const CameraView* Camera = nullptr;
+	for (const ParsedChunk& Chunk : Chunks)
+	{
+		if (Chunk.ErrorLine > 0)
+		{
+			SetError(OutError, FilePath + ":" + std::to_string(LinesBefore + Chunk.ErrorLine) + ": " + Chunk.Error);
+			return false;
+		}
+		LinesBefore += Chunk.Lines;
+		SphereCount += Chunk.Transforms.size();
+		Camera = Chunk.HasCamera ? &Chunk.Camera : Camera;
+	}
+	if (SphereCount >= UINT32_MAX)
+	{
+		SetError(OutError, FilePath + " has more spheres than the renderer can index");
+		return false;
+	}
+
+	std::unique_ptr<HittableList> World = std::make_unique<HittableList>();
+	World->Reserve(SphereCount);
+	for (const ParsedChunk& Chunk : Chunks)
+	{
+		World->VAddSpheres(Chunk.Transforms.data(), Chunk.MaterialData.data(), Chunk.MaterialTypes.data(), Chunk.Transforms.size());
+	}
+	OutWorld = std::move(World);
+	OutCamera = Camera ? std::make_unique<CameraView>(*Camera) : nullptr;
+	ParseTimer.Stop();
+
+	if (OutStats)
+	{
+		OutStats->Bytes = File.GetSize();
+		OutStats->Lines = LinesBefore;
+		OutStats->Spheres = SphereCount;
+		OutStats->Chunks = (unsigned int)Chunks.size();
+		OutStats->ParseMs = (double)ParseTimer.GetLastDurationNs() / 1e6;
+	}
+	return true;
+}
@@ -1,44 +1,30 @@
 #include "Public/SoftwareRenderer.h"
 #include "Public/D2D1Class.h"
-#include "Public/Timer.h"
-#include "Public/VMaterial.h"
-#include "Public/SubMaterials.h"
 #include <format>
 
 SoftwareRenderer::SoftwareRenderer(unsigned int Width, unsigned int Height, float AspectRatio) : m_Width(Width), m_Height(Height), m_AspectRatio(AspectRatio),
-m_World(nullptr), m_hWnd(NULL), m_FrameBuffer(nullptr), m_D2D1(nullptr), m_ThreadPool(nullptr)
+m_RenderCore(nullptr), m_hWnd(NULL), m_D2D1(nullptr)
 {
 
 }
 
-//Some of the viewport, fov, and aspect ratio logics can be moved into the camera class
-//But for this project such set up is fine. Or maybe we should move these logic into the constructor for RAII
-bool SoftwareRenderer::Initialize(HWND hWnd, unsigned int SampleCount, unsigned int MaxDepth)
+bool SoftwareRenderer::Initialize(HWND hWnd, unsigned int SampleCount, unsigned int MaxDepth, unsigned int RouletteMinDepth)
 {
 	bool Result = false;
 	
 	m_hWnd = hWnd;
 
-	//Remember that our camera center is also the center of our coordinate system
-	m_Camera = Camera();
-	m_Camera.SetSampleCount(SampleCount);
-	m_Camera.SetMaxDepth(MaxDepth);
-
-	float VFovAngle = Utility::DegreeToRadian(m_Camera.VerticalFOV);
-	float h = std::tan(VFovAngle / 2.f);
-	m_ViewportHeight = 2.f * h * m_Camera.FocusDistance;
-	m_ViewportWidth = m_ViewportHeight * ((float)m_Width / (float)m_Height);
-	
-	
-	m_ViewportU = m_ViewportWidth * m_Camera.CameraU;
-	m_ViewportV = m_ViewportHeight *  (-m_Camera.CameraV);//This is negative because the viewport Y is inverted compared to right hand coordinate system
-	m_DeltaU = m_ViewportU / (float)(m_Width);
-	m_DeltaV = m_ViewportV / (float)(m_Height);
-
-	//Intialize the frame buffer and the D2D1 class used for software rendering
-	m_FrameBuffer = new unsigned char[m_Width * m_Height * 4];//Each pixel needs four bytes for B8G8R8A8
-	memset(m_FrameBuffer, 0, m_Width * m_Height * 4);
-	if (!m_FrameBuffer)
+	RenderSettings Settings;
+	Settings.Width = m_Width;
+	Settings.Height = m_Height;
+	Settings.SampleCount = SampleCount;
+	Settings.MaxDepth = MaxDepth;
+	Settings.RouletteMinDepth = RouletteMinDepth;
+	Settings.ThreadCount = 0;
+
+	//Intialize the render core(which owns the frame buffer) and the D2D1 class used for presenting it
+	m_RenderCore = std::make_unique<RenderCore>(Settings);
+	if (!m_RenderCore->Initialize())
 	{
 		MessageBox(NULL, L"Failed to allocate frame buffer!", L"Error", MB_OK);
 		return false;
@@ -48,27 +34,21 @@ bool SoftwareRenderer::Initialize(HWND hWnd, unsigned int SampleCount, unsigned
 	if (!m_D2D1)
 	{
 		MessageBox(NULL, L"Failed to allocate D2D1 Class!", L"Error", MB_OK);
-		delete[] m_FrameBuffer;
 		return false;
 	}
 	Result = m_D2D1->InitFactory();
 	if (!Result)
 	{
 		MessageBox(NULL, L"Failed to init D2D1 Class!", L"Error", MB_OK);
-		delete[] m_FrameBuffer;
 		return false;
 	}
 	if (FAILED(m_D2D1->CreateGraphicResources(hWnd)))
 	{
 		MessageBox(NULL, L"Failed to init D2D1 Class!", L"Error", MB_OK);
-		delete[] m_FrameBuffer;
 		m_D2D1->Shutdown();
 		return false;
 	}
 
-	//Only start the thread pool if everything goes well
-	m_ThreadPool = std::make_unique<VThreadPool>(16, true);
-
 	return true;
 }
 
@@ -79,55 +59,9 @@ void SoftwareRenderer::ClearWindow()
 
 void SoftwareRenderer::RenderFrameBuffer()
 {
-	/*
-	* Few things to note about getting the viewport upper left and the first pixel position:
-	* 1. The camera is pointing straight down the negative Z axis(Right-hand system btw), and pointing at the center of the viewport, hence subtracting focal length in Z
-	* 2. The viewport contains all the pixels(from 0th to Width - 1), however, we add half-pixel length spacings in both left-right and top-bottom, so the viewport can be divided nicely into Width x Height areas
-	* 3. Step 2 means we need to add half of the delta U and V to get to the first pixel location
-	*/
-	Point3D CameraCenter = m_Camera.CameraCenter;
-	Vector3D ViewportUpperLeft = CameraCenter - m_Camera.CameraW * m_Camera.FocusDistance - (m_ViewportU / 2.f) - (m_ViewportV / 2.f);
-	Point3D FirstPixelPos = ViewportUpperLeft + 0.5f * (m_DeltaU + m_DeltaV);
-	double RenderTime = 0.0;
-	VTimer RenderTimer;
-	
-	
-
-	CreateWorld();
-	std::vector<std::future<unsigned int>> Futures;
-	Futures.reserve(1080);
-	RenderTimer.Start();
-	for (unsigned int i = 0; i < m_Height; i++)
+	bool Completed = m_RenderCore->RenderFrameBuffer([this](const RenderTile& Tile)
 	{
-		Futures.push_back(m_ThreadPool->SubmitTask([this, CameraCenter, FirstPixelPos, i]()
-		{
-			for (unsigned int j = 0; j < m_Width; j++)
-			{
-				Point3D PixelPos = FirstPixelPos + ((float)j * m_DeltaU) + ((float)i * m_DeltaV);
-
-				Color PixelColor = Color(0.f, 0.f, 0.f);
-				PixelColor = m_Camera.CalculateHitColor(*m_World, PixelPos, m_DeltaU, m_DeltaV);
-				//The D2D1 class is expecting B8G8R8, so we convert the float color value to byte and fill every pixel in the buffer accordingly
-				size_t PixelIndex = (i * m_Width + j) * 4;
-					
-				//Apply gamma correction and scale to 0-255 in one step
-				unsigned char AdjustedRed = (unsigned char)(255.999f * LinearToGamma(PixelColor.R()));
-				unsigned char AdjustedGreen = (unsigned char)(255.999f * LinearToGamma(PixelColor.G()));
-				unsigned char AdjustedBlue = (unsigned char)(255.999f * LinearToGamma(PixelColor.B()));
-
-				m_FrameBuffer[PixelIndex] = AdjustedBlue;
-				m_FrameBuffer[PixelIndex + 1] = AdjustedGreen;
-				m_FrameBuffer[PixelIndex + 2] = AdjustedRed;
-			}
-			return i;
-		}));
-	}
-
-	for (auto& Future : Futures)
-	{
-		//Get() will block until we have a valid result to retrieve
-		int Scanline = Future.get();
-		RECT UpdateRegion{ 0, Scanline, (long)m_Width, Scanline + 1};
+		RECT UpdateRegion{ (long)Tile.X0, (long)Tile.Y0, (long)Tile.X1, (long)Tile.Y1 };
 		InvalidateRect(m_hWnd, &UpdateRegion, false);
 		UpdateWindow(m_hWnd);
 
@@ -142,22 +76,26 @@ void SoftwareRenderer::RenderFrameBuffer()
 			if (Msg.message == WM_QUIT)
 			{
 				PostQuitMessage((int)Msg.wParam);
-				return;
+				return false;
 			}
 			TranslateMessage(&Msg);
 			DispatchMessage(&Msg);
 		}
-	}
+		return true;
+	});
 
-	RenderTimer.Stop();
-	RenderTime = (double)RenderTimer.GetLastDuration() / 1000.0;
+	if (!Completed)
+	{
+		return;
+	}
 
+	double RenderTime = (double)m_RenderCore->GetLastRenderTime() / 1000.0;
 	m_RenderTimeString = std::format(L"Render Complete! Time used: {:.3f} seconds", RenderTime);
 }
 
 void SoftwareRenderer::RenderToWindow()
 {
-	m_D2D1->RenderBitmap(m_FrameBuffer);
+	m_D2D1->RenderBitmap(m_RenderCore->GetFrameBuffer());
 }
 
 
@@ -169,75 +107,4 @@ SoftwareRenderer::~SoftwareRenderer()
 		delete m_D2D1;
 		m_D2D1 = nullptr;
 	}
-	delete[] m_FrameBuffer;
-}
-
-void SoftwareRenderer::CreateWorld()
-{
-	//Create the materials and spheres in the world, I am keeping both my and the book's implementations so I can do some benchmark
-	/*
-	* Note on the calculation of RI for the glass sphere and the bubble. The glass is straightforward, it's just 1.5
-	* For the bubble, we need to remember that the RI of a surface can be interpreted as the RI of itself divided by the enclosing object
-	* Therefore, we have 1.f(air bubble) / 1.5f(glass layer)
-	*/
-	m_World = std::make_unique<HittableList>();
-	MaterialScatterData MatScatterData(0.f, Color(0.5f, 0.5f, 0.5f)) ;
-	m_World->VAddSphere(SphereObjectData(Point3D(0.f, -1000.f, 0.f), 1000.f), MatScatterData, MaterialType::Lambertian);
-	for (int a = -11; a < 11; a++)
-	{
-		for (int b = -11; b < 11; b++)
-		{
-			SphereObjectData SphereData;
-			float ChooseMat = Utility::RandomFloat();
-			Point3D SphereCenter(a + 0.9f * Utility::RandomFloat(), 0.2f, b + 0.9f * Utility::RandomFloat());
-
-			if ((SphereCenter - Point3D(4.f, 0.2f, 0.f)).Length() > 0.9f)
-			{
-				std::shared_ptr<Material> SphereMat;
-
-				if (ChooseMat < 0.8f)
-				{
-					// diffuse
-					Color Albedo = Color::RandomVector() * Color::RandomVector();
-					MaterialScatterData MatScatterData;
-					MatScatterData.Albedo = Albedo;
-					SphereData.Center = SphereCenter;
-					SphereData.Radius = 0.2f;
-					m_World->VAddSphere(SphereData, MatScatterData, MaterialType::Lambertian);
-				}
-				else if (ChooseMat < 0.95f)
-				{
-					// metal
-					Color Albedo = Color::RandomVector();
-					float Fuzz = Utility::RandomFloat(0.f, 0.5f);
-					MaterialScatterData MatScatterData;
-					MatScatterData.Albedo = Albedo;
-					MatScatterData.FuzzOrRI = Fuzz;
-					SphereData.Center = SphereCenter;
-					SphereData.Radius = 0.2f;
-					m_World->VAddSphere(SphereData, MatScatterData, MaterialType::Metal);
-				}
-				else
-				{
-					// glass
-					MaterialScatterData MatScatterData;
-					MatScatterData.FuzzOrRI = 1.5f;
-					SphereData.Center = SphereCenter;
-					SphereData.Radius = 0.2f;
-					m_World->VAddSphere(SphereData, MatScatterData, MaterialType::Dielectric);
-				}
-			}
-		}
-	}
-	MaterialScatterData ScatterData;
-	ScatterData.FuzzOrRI = 1.5f;
-	m_World->VAddSphere(SphereObjectData(Point3D(0.f, 1.f, 0.f), 1.f), ScatterData, MaterialType::Dielectric);
-
-	ScatterData.Albedo = Color(0.4f, 0.2f, 0.1f);
-	m_World->VAddSphere(SphereObjectData(Point3D(-4, 1, 0), 1.f), ScatterData, MaterialType::Lambertian);
-
-	ScatterData.Albedo = Color(0.7f, 0.6f, 0.5f);
-	ScatterData.FuzzOrRI = 0.f;
-	m_World->VAddSphere(SphereObjectData(Point3D(4, 1, 0), 1.f), ScatterData, MaterialType::Metal);
 }
-
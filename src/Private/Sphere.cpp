@@ -32,7 +32,7 @@ bool Sphere::Hit(const Ray& R, Interval HitInterval, HitRecord& OutHitRecord)
 		return false;
 	}
 
-	float SqrtDis = std::sqrtf(Discriminant);
+	float SqrtDis = std::sqrt(Discriminant);
 	
 	float Root = (h - SqrtDis) / a;
 
@@ -0,0 +1,316 @@
+#include "Public/SphereKernels.h"
+#include "Public/HittableList.h"
+
+#if RAYTRACER_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+/*
+* All the kernels follow the same math as HittableList::VSphereHit, the only difference is that they do it for a batch of spheres at once
+* 1. oc = center - origin, h = dir . oc, c = oc . oc - r^2, discriminant = h^2 - a * c
+* 2. The nearer root is taken if it's inside (TMin, closest), otherwise the further one
+* 3. Each lane keeps its own closest t and sphere index, the lanes are reduced once after the loop
+* The SIMD versions are compiled for their own ISA through target attributes, CPUDispatch decides which one NearestHit forwards to
+*/
+namespace
+{
+	int NearestHitScalar(const SphereSoAComponent& Spheres, const Ray& R, float TMin, float& ClosestSoFar, unsigned int First, unsigned int Count)
+	{
+		const Vector3D& Origin = R.Origin();
+		const Vector3D& Direction = R.Direction();
+		const float a = Direction.LengthSquared();
+		const float InvA = 1.f / a;
+		int ClosestIndex = -1;
+		for (unsigned int i = First; i < First + Count; i++)
+		{
+			const float OCX = Spheres.CenterX[i] - Origin.X;
+			const float OCY = Spheres.CenterY[i] - Origin.Y;
+			const float OCZ = Spheres.CenterZ[i] - Origin.Z;
+			const float h = Direction.X * OCX + Direction.Y * OCY + Direction.Z * OCZ;
+			const float c = OCX * OCX + OCY * OCY + OCZ * OCZ - Spheres.Radius[i] * Spheres.Radius[i];
+			const float Discriminant = h * h - a * c;
+			if (Discriminant < 0.f)
+			{
+				continue;
+			}
+			const float SqrtDis = std::sqrt(Discriminant);
+			float Root = (h - SqrtDis) * InvA;
+			if (Root <= TMin || Root >= ClosestSoFar)
+			{
+				Root = (h + SqrtDis) * InvA;
+				if (Root <= TMin || Root >= ClosestSoFar)
+				{
+					continue;
+				}
+			}
+			ClosestSoFar = Root;
+			ClosestIndex = (int)i;
+		}
+		return ClosestIndex;
+	}
+
+#if RAYTRACER_X86_DISPATCH
+	RAYTRACER_TARGET_SSE42 int NearestHitSSE42(const SphereSoAComponent& Spheres, const Ray& R, float TMin, float& ClosestSoFar, unsigned int First, unsigned int Count)
+	{
+		const Vector3D& Origin = R.Origin();
+		const Vector3D& Direction = R.Direction();
+		const float a = Direction.LengthSquared();
+
+		const __m128 OriginX = _mm_set1_ps(Origin.X);
+		const __m128 OriginY = _mm_set1_ps(Origin.Y);
+		const __m128 OriginZ = _mm_set1_ps(Origin.Z);
+		const __m128 DirX = _mm_set1_ps(Direction.X);
+		const __m128 DirY = _mm_set1_ps(Direction.Y);
+		const __m128 DirZ = _mm_set1_ps(Direction.Z);
+		const __m128 A = _mm_set1_ps(a);
+		const __m128 InvA = _mm_set1_ps(1.f / a);
+		const __m128 Min = _mm_set1_ps(TMin);
+		const __m128 Zero = _mm_setzero_ps();
+		const __m128i LaneOffsets = _mm_setr_epi32(0, 1, 2, 3);
+
+		__m128 BestT = _mm_set1_ps(ClosestSoFar);
+		__m128 BestIndex = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		const unsigned int End = First + Count;
+		const __m128i EndIndex = _mm_set1_epi32((int)End);
+		for (unsigned int i = First; i < End; i += 4)
+		{
+			const __m128i LaneIndex = _mm_add_epi32(_mm_set1_epi32((int)i), LaneOffsets);
+			const __m128 LaneMask = _mm_castsi128_ps(_mm_cmpgt_epi32(EndIndex, LaneIndex));
+
+			const __m128 OCX = _mm_sub_ps(_mm_loadu_ps(&Spheres.CenterX[i]), OriginX);
+			const __m128 OCY = _mm_sub_ps(_mm_loadu_ps(&Spheres.CenterY[i]), OriginY);
+			const __m128 OCZ = _mm_sub_ps(_mm_loadu_ps(&Spheres.CenterZ[i]), OriginZ);
+			const __m128 Radius = _mm_loadu_ps(&Spheres.Radius[i]);
+
+			const __m128 h = _mm_add_ps(_mm_add_ps(_mm_mul_ps(DirX, OCX), _mm_mul_ps(DirY, OCY)), _mm_mul_ps(DirZ, OCZ));
+			const __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(OCX, OCX), _mm_mul_ps(OCY, OCY)), _mm_mul_ps(OCZ, OCZ)), _mm_mul_ps(Radius, Radius));
+			const __m128 Discriminant = _mm_sub_ps(_mm_mul_ps(h, h), _mm_mul_ps(A, c));
+			const __m128 HasRoots = _mm_and_ps(LaneMask, _mm_cmpge_ps(Discriminant, Zero));
+			if (_mm_movemask_ps(HasRoots) == 0)
+			{
+				continue;
+			}
+
+			const __m128 SqrtDis = _mm_sqrt_ps(_mm_max_ps(Discriminant, Zero));
+			const __m128 Near = _mm_mul_ps(_mm_sub_ps(h, SqrtDis), InvA);
+			const __m128 Far = _mm_mul_ps(_mm_add_ps(h, SqrtDis), InvA);
+			const __m128 NearValid = _mm_and_ps(_mm_cmpgt_ps(Near, Min), _mm_cmplt_ps(Near, BestT));
+			const __m128 FarValid = _mm_and_ps(_mm_cmpgt_ps(Far, Min), _mm_cmplt_ps(Far, BestT));
+			const __m128 Root = _mm_blendv_ps(Far, Near, NearValid);
+			const __m128 Hit = _mm_and_ps(HasRoots, _mm_or_ps(NearValid, FarValid));
+
+			BestT = _mm_blendv_ps(BestT, Root, Hit);
+			BestIndex = _mm_blendv_ps(BestIndex, _mm_castsi128_ps(LaneIndex), Hit);
+		}
+
+		alignas(16) float LaneT[4];
+		alignas(16) int LaneIndex[4];
+		_mm_store_ps(LaneT, BestT);
+		_mm_store_si128(reinterpret_cast<__m128i*>(LaneIndex), _mm_castps_si128(BestIndex));
+		int ClosestIndex = -1;
+		for (int Lane = 0; Lane < 4; Lane++)
+		{
+			if (LaneIndex[Lane] >= 0 && LaneT[Lane] < ClosestSoFar)
+			{
+				ClosestSoFar = LaneT[Lane];
+				ClosestIndex = LaneIndex[Lane];
+			}
+		}
+		return ClosestIndex;
+	}
+
+	RAYTRACER_TARGET_AVX512 int NearestHitAVX512(const SphereSoAComponent& Spheres, const Ray& R, float TMin, float& ClosestSoFar, unsigned int First, unsigned int Count)
+	{
+		const Vector3D& Origin = R.Origin();
+		const Vector3D& Direction = R.Direction();
+		const float a = Direction.LengthSquared();
+
+		const __m512 OriginX = _mm512_set1_ps(Origin.X);
+		const __m512 OriginY = _mm512_set1_ps(Origin.Y);
+		const __m512 OriginZ = _mm512_set1_ps(Origin.Z);
+		const __m512 DirX = _mm512_set1_ps(Direction.X);
+		const __m512 DirY = _mm512_set1_ps(Direction.Y);
+		const __m512 DirZ = _mm512_set1_ps(Direction.Z);
+		const __m512 A = _mm512_set1_ps(a);
+		const __m512 InvA = _mm512_set1_ps(1.f / a);
+		const __m512 Min = _mm512_set1_ps(TMin);
+		const __m512 Zero = _mm512_setzero_ps();
+		const __m512i LaneOffsets = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+		__m512 BestT = _mm512_set1_ps(ClosestSoFar);
+		__m512i BestIndex = _mm512_set1_epi32(-1);
+		const unsigned int End = First + Count;
+		for (unsigned int i = First; i < End; i += 16)
+		{
+			const unsigned int Remaining = End - i;
+			const __mmask16 LaneMask = Remaining >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << Remaining) - 1u);
+
+			const __m512 OCX = _mm512_sub_ps(_mm512_loadu_ps(&Spheres.CenterX[i]), OriginX);
+			const __m512 OCY = _mm512_sub_ps(_mm512_loadu_ps(&Spheres.CenterY[i]), OriginY);
+			const __m512 OCZ = _mm512_sub_ps(_mm512_loadu_ps(&Spheres.CenterZ[i]), OriginZ);
+			const __m512 Radius = _mm512_loadu_ps(&Spheres.Radius[i]);
+
+			const __m512 h = _mm512_fmadd_ps(DirZ, OCZ, _mm512_fmadd_ps(DirY, OCY, _mm512_mul_ps(DirX, OCX)));
+			const __m512 c = _mm512_fnmadd_ps(Radius, Radius, _mm512_fmadd_ps(OCZ, OCZ, _mm512_fmadd_ps(OCY, OCY, _mm512_mul_ps(OCX, OCX))));
+			const __m512 Discriminant = _mm512_fnmadd_ps(A, c, _mm512_mul_ps(h, h));
+			const __mmask16 HasRoots = _mm512_mask_cmp_ps_mask(LaneMask, Discriminant, Zero, _CMP_GE_OQ);
+			if (HasRoots == 0)
+			{
+				continue;
+			}
+
+			const __m512 SqrtDis = _mm512_sqrt_ps(_mm512_max_ps(Discriminant, Zero));
+			const __m512 Near = _mm512_mul_ps(_mm512_sub_ps(h, SqrtDis), InvA);
+			const __m512 Far = _mm512_mul_ps(_mm512_add_ps(h, SqrtDis), InvA);
+			const __mmask16 NearValid = _mm512_mask_cmp_ps_mask(_mm512_mask_cmp_ps_mask(HasRoots, Near, Min, _CMP_GT_OQ), Near, BestT, _CMP_LT_OQ);
+			const __mmask16 FarValid = _mm512_mask_cmp_ps_mask(_mm512_mask_cmp_ps_mask(HasRoots, Far, Min, _CMP_GT_OQ), Far, BestT, _CMP_LT_OQ);
+			const __m512 Root = _mm512_mask_blend_ps(NearValid, Far, Near);
+			const __mmask16 Hit = NearValid | FarValid;
+
+			BestT = _mm512_mask_blend_ps(Hit, BestT, Root);
+			BestIndex = _mm512_mask_blend_epi32(Hit, BestIndex, _mm512_add_epi32(_mm512_set1_epi32((int)i), LaneOffsets));
+		}
+
+		alignas(64) float LaneT[16];
+		alignas(64) int LaneIndex[16];
+		_mm512_store_ps(LaneT, BestT);
+		_mm512_store_si512(LaneIndex, BestIndex);
+		int ClosestIndex = -1;
+		for (int Lane = 0; Lane < 16; Lane++)
+		{
+			if (LaneIndex[Lane] >= 0 && LaneT[Lane] < ClosestSoFar)
+			{
+				ClosestSoFar = LaneT[Lane];
+				ClosestIndex = LaneIndex[Lane];
+			}
+		}
+		return ClosestIndex;
+	}
+
+	RAYTRACER_TARGET_AVX2 int NearestHitAVX2(const SphereSoAComponent& Spheres, const Ray& R, float TMin, float& ClosestSoFar, unsigned int First, unsigned int Count)
+	{
+		const Vector3D& Origin = R.Origin();
+		const Vector3D& Direction = R.Direction();
+		const float a = Direction.LengthSquared();
+
+		const __m256 OriginX = _mm256_set1_ps(Origin.X);
+		const __m256 OriginY = _mm256_set1_ps(Origin.Y);
+		const __m256 OriginZ = _mm256_set1_ps(Origin.Z);
+		const __m256 DirX = _mm256_set1_ps(Direction.X);
+		const __m256 DirY = _mm256_set1_ps(Direction.Y);
+		const __m256 DirZ = _mm256_set1_ps(Direction.Z);
+		const __m256 A = _mm256_set1_ps(a);
+		const __m256 InvA = _mm256_set1_ps(1.f / a);
+		const __m256 Min = _mm256_set1_ps(TMin);
+		const __m256 Zero = _mm256_setzero_ps();
+		const __m256i LaneOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+		__m256 BestT = _mm256_set1_ps(ClosestSoFar);
+		__m256 BestIndex = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		const unsigned int End = First + Count;
+		const __m256i EndIndex = _mm256_set1_epi32((int)End);
+		for (unsigned int i = First; i < End; i += 8)
+		{
+			const __m256i LaneIndex = _mm256_add_epi32(_mm256_set1_epi32((int)i), LaneOffsets);
+			const __m256 LaneMask = _mm256_castsi256_ps(_mm256_cmpgt_epi32(EndIndex, LaneIndex));
+
+			const __m256 OCX = _mm256_sub_ps(_mm256_loadu_ps(&Spheres.CenterX[i]), OriginX);
+			const __m256 OCY = _mm256_sub_ps(_mm256_loadu_ps(&Spheres.CenterY[i]), OriginY);
+			const __m256 OCZ = _mm256_sub_ps(_mm256_loadu_ps(&Spheres.CenterZ[i]), OriginZ);
+			const __m256 Radius = _mm256_loadu_ps(&Spheres.Radius[i]);
+
+			const __m256 h = _mm256_fmadd_ps(DirZ, OCZ, _mm256_fmadd_ps(DirY, OCY, _mm256_mul_ps(DirX, OCX)));
+			const __m256 c = _mm256_fnmadd_ps(Radius, Radius, _mm256_fmadd_ps(OCZ, OCZ, _mm256_fmadd_ps(OCY, OCY, _mm256_mul_ps(OCX, OCX))));
+			const __m256 Discriminant = _mm256_fnmadd_ps(A, c, _mm256_mul_ps(h, h));
+			const __m256 HasRoots = _mm256_and_ps(LaneMask, _mm256_cmp_ps(Discriminant, Zero, _CMP_GE_OQ));
+			if (_mm256_movemask_ps(HasRoots) == 0)
+			{
+				continue;
+			}
+
+			const __m256 SqrtDis = _mm256_sqrt_ps(_mm256_max_ps(Discriminant, Zero));
+			const __m256 Near = _mm256_mul_ps(_mm256_sub_ps(h, SqrtDis), InvA);
+			const __m256 Far = _mm256_mul_ps(_mm256_add_ps(h, SqrtDis), InvA);
+			const __m256 NearValid = _mm256_and_ps(_mm256_cmp_ps(Near, Min, _CMP_GT_OQ), _mm256_cmp_ps(Near, BestT, _CMP_LT_OQ));
+			const __m256 FarValid = _mm256_and_ps(_mm256_cmp_ps(Far, Min, _CMP_GT_OQ), _mm256_cmp_ps(Far, BestT, _CMP_LT_OQ));
+			const __m256 Root = _mm256_blendv_ps(Far, Near, NearValid);
+			const __m256 Hit = _mm256_and_ps(HasRoots, _mm256_or_ps(NearValid, FarValid));
+
+			BestT = _mm256_blendv_ps(BestT, Root, Hit);
+			BestIndex = _mm256_blendv_ps(BestIndex, _mm256_castsi256_ps(LaneIndex), Hit);
+		}
+
+		alignas(32) float LaneT[8];
+		alignas(32) int LaneIndex[8];
+		_mm256_store_ps(LaneT, BestT);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(LaneIndex), _mm256_castps_si256(BestIndex));
+		int ClosestIndex = -1;
+		for (int Lane = 0; Lane < 8; Lane++)
+		{
+			if (LaneIndex[Lane] >= 0 && LaneT[Lane] < ClosestSoFar)
+			{
+				ClosestSoFar = LaneT[Lane];
+				ClosestIndex = LaneIndex[Lane];
+			}
+		}
+		return ClosestIndex;
+	}
+#endif
+
+	using NearestHitFunc = int(*)(const SphereSoAComponent&, const Ray&, float, float&, unsigned int, unsigned int);
+
+	struct SphereKernelVariant
+	{
+		NearestHitFunc NearestHit;
+		unsigned int LaneWidth;
+		const char* Name;
+	};
+
+	SphereKernelVariant GetVariant(ISALevel Level)
+	{
+		switch (Level)
+		{
+#if RAYTRACER_X86_DISPATCH
+			case ISALevel::AVX512:
+			{
+				return SphereKernelVariant{ &NearestHitAVX512, 16, "AVX-512" };
+			}
+			case ISALevel::AVX2:
+			{
+				return SphereKernelVariant{ &NearestHitAVX2, 8, "AVX2" };
+			}
+			case ISALevel::SSE42:
+			{
+				return SphereKernelVariant{ &NearestHitSSE42, 4, "SSE4.2" };
+			}
+#endif
+			default:
+			{
+				return SphereKernelVariant{ &NearestHitScalar, 1, "Scalar" };
+			}
+		}
+	}
+
+	//Selected at static init time from the CPU, SetActiveISA can swap it before rendering starts
+	SphereKernelVariant g_ActiveVariant = GetVariant(CPUDispatch::GetActiveISA());
+}
+
+void SphereKernels::SelectISA(ISALevel Level)
+{
+	g_ActiveVariant = GetVariant(Level);
+}
+
+unsigned int SphereKernels::GetLaneWidth()
+{
+	return g_ActiveVariant.LaneWidth;
+}
+
+const char* SphereKernels::GetKernelName()
+{
+	return g_ActiveVariant.Name;
+}
+
+int SphereKernels::NearestHit(const SphereSoAComponent& Spheres, const Ray& R, float TMin, float& ClosestSoFar, unsigned int First, unsigned int Count)
+{
+	return g_ActiveVariant.NearestHit(Spheres, R, TMin, ClosestSoFar, First, Count);
+}
@@ -1,49 +1,301 @@
 #include "Public/ThreadPool.h"
+#include "Public/CPUBudget.h"
+#include "Public/TraceRecorder.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 
-VThreadPool::VThreadPool(size_t NumThreads, bool IsUsingCustomThreadCount)
+namespace
 {
-	size_t ThreadCount = std::thread::hardware_concurrency();
-	if (!IsUsingCustomThreadCount)
+	//Set on the pool's own threads, so ParallelFor can tell it is being called from inside a task
+	thread_local const VThreadPool* t_OwningPool = nullptr;
+	thread_local int t_WorkerIndex = -1;
+}
+
+VThreadPool::VThreadPool(size_t NumThreads, bool IsUsingCustomThreadCount, ThreadPoolQueueType QueueType, size_t LockFreeCapacity, const ThreadPoolPlacement& Placement) : m_QueueType(QueueType)
+{
+	//A node limit also limits the automatic thread count, otherwise a one-node run would still size itself for the whole machine
+	unsigned int CPULimit = 0;
+	if (Placement.Mode != ThreadPlacement::None && Placement.NodeLimit > 0)
 	{
-		NumThreads = ThreadCount / 2;
+		std::vector<NUMANodeInfo> Nodes = CPUBudget::DetectNUMANodes();
+		for (size_t i = 0; i < Nodes.size() && i < Placement.NodeLimit; i++)
+		{
+			CPULimit += (unsigned int)Nodes[i].CPUs.size();
+		}
 	}
-	//Cap the thread count at maxium 3/4 of the hardware concurrency
-	if (NumThreads > ThreadCount * 0.75f)
+	NumThreads = ResolveThreadCount(NumThreads, IsUsingCustomThreadCount, CPULimit, m_ThreadCountReason);
+	AssignWorkerCPUs(NumThreads, Placement);
+
+	if (m_QueueType == ThreadPoolQueueType::LockFree)
 	{
-		NumThreads = ThreadCount * 0.75f;
+		m_LockFreeTasks = std::make_unique<VMPMCQueue<std::function<void()>>>(LockFreeCapacity);
 	}
 
 	for (size_t i = 0; i < NumThreads; i++)
 	{
 		m_Workers.emplace_back(
-			[this]()
+			[this, i]()
 			{
-				while (true)
+				t_OwningPool = this;
+				t_WorkerIndex = (int)i;
+				VTraceRecorder::SetThreadName("Pool worker " + std::to_string(i));
+				if (m_WorkerCPUs[i] >= 0)
 				{
-					std::function<void()> Task;
-					{
-						std::unique_lock<std::mutex> Lock(this->m_QueueMutex);
-						//A condition variable is something that will essentially block the thread's execution until it is notified by others using notify_one or notify_all
-						//Conditionals can also take in a predicate, forcing the thread to only continue if the predicate returns true when they receive the notification
-						//So in this case, we want the thread to just "sleep" until either the thread pool is stopped, or there are tasks to be executed
-						this->m_Condition.wait(Lock, [this]
-						{
-							return this->m_HasStopped || !this->m_Tasks.empty();
-						});
-						if(this->m_HasStopped && this->m_Tasks.empty())
-						{
-							return;
-						}
-						Task = std::move(this->m_Tasks.front());
-						this->m_Tasks.pop();
-					}
-					Task();
+					//Pinning from inside the thread means the stack and everything else it touches from now on is allocated on the right node
+					CPUBudget::PinCurrentThread((unsigned int)m_WorkerCPUs[i]);
 				}
+				WorkerLoop();
 			}
 		);
 	}
 }
 
+void VThreadPool::AssignWorkerCPUs(size_t NumThreads, const ThreadPoolPlacement& Placement)
+{
+	m_WorkerNodes.assign(NumThreads, 0);
+	m_WorkerCPUs.assign(NumThreads, -1);
+	m_NodeCount = 1;
+	if (Placement.Mode == ThreadPlacement::None)
+	{
+		return;
+	}
+
+	//CPUs in node order, remembering which node slot each one belongs to. Pinning to cores only uses a single slot
+	std::vector<NUMANodeInfo> Nodes = CPUBudget::DetectNUMANodes();
+	if (Placement.NodeLimit > 0 && Placement.NodeLimit < Nodes.size())
+	{
+		Nodes.resize(Placement.NodeLimit);
+	}
+	std::vector<unsigned int> CPUs;
+	std::vector<unsigned int> CPUNodes;
+	for (size_t Slot = 0; Slot < Nodes.size(); Slot++)
+	{
+		for (unsigned int CPU : Nodes[Slot].CPUs)
+		{
+			CPUs.push_back(CPU);
+			CPUNodes.push_back(Placement.Mode == ThreadPlacement::NUMANodes ? (unsigned int)Slot : 0);
+		}
+	}
+
+	//Spread the workers evenly over the CPU list, so fewer workers than CPUs still land on every node in proportion to its size
+	for (size_t i = 0; i < NumThreads; i++)
+	{
+		const size_t CPUIndex = NumThreads <= CPUs.size() ? i * CPUs.size() / NumThreads : i % CPUs.size();
+		m_WorkerCPUs[i] = (int)CPUs[CPUIndex];
+		m_WorkerNodes[i] = CPUNodes[CPUIndex];
+		m_NodeCount = std::max(m_NodeCount, CPUNodes[CPUIndex] + 1);
+	}
+
+	m_ThreadCountReason += Placement.Mode == ThreadPlacement::NUMANodes ? ", pinned over " + std::to_string(m_NodeCount) + " NUMA node(s)" : std::string(", pinned to cores");
+}
+
+int VThreadPool::GetCurrentWorkerIndex() const
+{
+	return t_OwningPool == this ? t_WorkerIndex : -1;
+}
+
+size_t VThreadPool::ResolveThreadCount(size_t NumThreads, bool IsUsingCustomThreadCount, unsigned int CPULimit, std::string& OutReason)
+{
+	CPUBudgetInfo Budget = CPUBudget::Detect();
+	if (CPULimit > 0 && CPULimit < Budget.AffinityThreads)
+	{
+		Budget.AffinityThreads = CPULimit;
+		Budget.AvailableThreads = std::min(Budget.AvailableThreads, CPULimit);
+	}
+	size_t ThreadCount = 0;
+	const char* EnvThreads = std::getenv("RAYTRACER_THREADS");
+	char* End = nullptr;
+	const unsigned long EnvValue = EnvThreads ? std::strtoul(EnvThreads, &End, 10) : 0;
+	if (EnvValue > 0 && *End == '\0')
+	{
+		ThreadCount = EnvValue;
+		OutReason = std::string("RAYTRACER_THREADS=") + EnvThreads;
+	}
+	else if (IsUsingCustomThreadCount && NumThreads > 0)
+	{
+		ThreadCount = NumThreads;
+		OutReason = "explicit thread count";
+	}
+	else if (Budget.QuotaCPUs > 0.0 && Budget.AvailableThreads < Budget.AffinityThreads)
+	{
+		char Buffer[64];
+		std::snprintf(Buffer, sizeof(Buffer), " quota of %.2f CPUs", Budget.QuotaCPUs);
+		ThreadCount = Budget.AvailableThreads;
+		OutReason = std::string(Budget.QuotaSource) + Buffer;
+	}
+	else
+	{
+		//Leave some room for the UI thread and the rest of the desktop, the same split the pool always used
+		const bool IsAffinityLimited = Budget.AffinityThreads < Budget.HardwareThreads;
+		ThreadCount = IsUsingCustomThreadCount ? Budget.AvailableThreads * 3 / 4 : Budget.AvailableThreads / 2;
+		OutReason = std::string(IsUsingCustomThreadCount ? "3/4" : "1/2") + " of " + std::to_string(Budget.AvailableThreads)
+			+ (IsAffinityLimited ? " CPUs in the affinity mask" : " hardware threads");
+	}
+
+	//Small boxes would otherwise leave us with no workers at all and every future would block forever
+	if (ThreadCount == 0)
+	{
+		ThreadCount = 1;
+	}
+	if (ThreadCount > Budget.AvailableThreads)
+	{
+		OutReason += ", above the budget of " + std::to_string(Budget.AvailableThreads) + " CPUs";
+	}
+	return ThreadCount;
+}
+
+void VThreadPool::WorkerLoop()
+{
+	if (m_QueueType == ThreadPoolQueueType::Mutex)
+	{
+		while (true)
+		{
+			std::function<void()> Task;
+			{
+				//Covers taking the queue lock as well as sleeping, so queue contention shows up as Wait time
+				VTraceScope WaitScope("Wait", "pool");
+				std::unique_lock<std::mutex> Lock(this->m_QueueMutex);
+				//A condition variable is something that will essentially block the thread's execution until it is notified by others using notify_one or notify_all
+				//Conditionals can also take in a predicate, forcing the thread to only continue if the predicate returns true when they receive the notification
+				//So in this case, we want the thread to just "sleep" until either the thread pool is stopped, or there are tasks to be executed
+				this->m_Condition.wait(Lock, [this]
+				{
+					return this->m_HasStopped || !this->m_Tasks.empty();
+				});
+				if (this->m_HasStopped && this->m_Tasks.empty())
+				{
+					return;
+				}
+				Task = std::move(this->m_Tasks.front());
+				this->m_Tasks.pop();
+			}
+			VTraceScope TaskScope("Task", "pool");
+			Task();
+		}
+	}
+
+	/*
+	* Lock-free backend. Pop without a lock while there is work, spin a little when the queue runs dry, and only then go to sleep on the condition variable
+	* The sleeper count and the task count are both seq_cst, so either the sleeping worker sees the new task in its predicate or Enqueue sees the sleeper and notifies it
+	*/
+	constexpr int SpinCount = 256;
+	while (true)
+	{
+		std::function<void()> Task;
+		if (m_LockFreeTasks->TryPop(Task))
+		{
+			m_LockFreeTaskCount.fetch_sub(1);
+			VTraceScope TaskScope("Task", "pool");
+			Task();
+			continue;
+		}
+
+		for (int Spin = 0; Spin < SpinCount && m_LockFreeTaskCount.load(std::memory_order_relaxed) <= 0 && !m_HasStopped.load(std::memory_order_relaxed); Spin++)
+		{
+			std::this_thread::yield();
+		}
+		if (m_LockFreeTaskCount.load() > 0)
+		{
+			continue;
+		}
+
+		VTraceScope WaitScope("Wait", "pool");
+		std::unique_lock<std::mutex> Lock(m_QueueMutex);
+		m_SleepingWorkers.fetch_add(1);
+		m_Condition.wait(Lock, [this]
+		{
+			return m_HasStopped || m_LockFreeTaskCount.load() > 0;
+		});
+		m_SleepingWorkers.fetch_sub(1);
+		if (m_HasStopped && m_LockFreeTaskCount.load() <= 0)
+		{
+			return;
+		}
+	}
+}
+
+void VThreadPool::Enqueue(std::function<void()>&& Task)
+{
+	if (m_QueueType == ThreadPoolQueueType::Mutex)
+	{
+		{
+			std::unique_lock<std::mutex> Lock(m_QueueMutex);
+			if (m_HasStopped)
+			{
+				throw std::runtime_error("Exception: Submitting to a stopped Thread Pool!");
+			}
+			m_Tasks.emplace(std::move(Task));
+		}
+		m_Condition.notify_one();
+		return;
+	}
+
+	if (m_HasStopped)
+	{
+		throw std::runtime_error("Exception: Submitting to a stopped Thread Pool!");
+	}
+	//The queue is bounded. When it is full the workers are clearly busy, so back off until one of them frees a cell
+	while (!m_LockFreeTasks->TryPush(std::move(Task)))
+	{
+		std::this_thread::yield();
+	}
+	m_LockFreeTaskCount.fetch_add(1);
+	if (m_SleepingWorkers.load() > 0)
+	{
+		//Taking the lock makes sure a worker that is between its predicate check and the actual wait does not miss this notification
+		std::lock_guard<std::mutex> Lock(m_QueueMutex);
+		m_Condition.notify_one();
+	}
+}
+
+void VThreadPool::ParallelForImpl(ParallelForJob& Job, size_t Begin)
+{
+	const size_t ChunkCount = (Job.End - Begin + Job.Grain - 1) / Job.Grain;
+	Job.Next.store(Begin, std::memory_order_relaxed);
+	//The calling thread works too, so one chunk needs no helper at all
+	const size_t HelperCount = t_OwningPool == this ? 0 : std::min(m_Workers.size(), ChunkCount - 1);
+	Job.PendingHelpers = HelperCount;
+
+	ParallelForJob* JobPointer = &Job;
+	for (size_t i = 0; i < HelperCount; i++)
+	{
+		Enqueue([this, JobPointer]()
+		{
+			RunChunks(*JobPointer);
+			//Decrement and notify under the lock, so the caller can not return(and pop the job off its stack) before we are done touching it
+			std::lock_guard<std::mutex> Lock(m_ParallelForMutex);
+			if (--JobPointer->PendingHelpers == 0)
+			{
+				m_ParallelForCondition.notify_all();
+			}
+		});
+	}
+
+	RunChunks(Job);
+	if (HelperCount > 0)
+	{
+		std::unique_lock<std::mutex> Lock(m_ParallelForMutex);
+		m_ParallelForCondition.wait(Lock, [&Job]()
+		{
+			return Job.PendingHelpers == 0;
+		});
+	}
+}
+
+void VThreadPool::RunChunks(ParallelForJob& Job)
+{
+	while (true)
+	{
+		const size_t ChunkBegin = Job.Next.fetch_add(Job.Grain, std::memory_order_relaxed);
+		if (ChunkBegin >= Job.End)
+		{
+			return;
+		}
+		Job.Invoke(Job.Context, ChunkBegin, std::min(ChunkBegin + Job.Grain, Job.End));
+	}
+}
+
 VThreadPool::~VThreadPool()
 {
 	{
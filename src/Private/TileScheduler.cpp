@@ -0,0 +1,276 @@
+#include "Public/TileScheduler.h"
+#include "Public/Timer.h"
+#include <algorithm>
+#include <chrono>
+
+VTileScheduler::VTileScheduler(VThreadPool& ThreadPool) : m_ThreadPool(ThreadPool)
+{
+	const size_t WorkerCount = m_ThreadPool.GetThreadCount();
+	m_Queues.reserve(WorkerCount);
+	for (size_t i = 0; i < WorkerCount; i++)
+	{
+		m_Queues.push_back(std::make_unique<TileQueue>());
+	}
+	m_WorkerStats.resize(WorkerCount);
+
+	//Group the workers by node. Without a NUMA split this is one group holding every worker
+	m_NodeWorkers.resize(m_ThreadPool.GetNodeCount());
+	for (size_t i = 0; i < WorkerCount; i++)
+	{
+		m_NodeWorkers[m_ThreadPool.GetWorkerNode(i)].push_back((unsigned int)i);
+	}
+}
+
+bool VTileScheduler::Run(unsigned int Width, unsigned int Height, unsigned int TileSize, const TileFunc& OnTile, const TileDoneFunc& OnTileDone)
+{
+	return RunInternal(Width, Height, TileSize, OnTile, OnTileDone, true);
+}
+
+void VTileScheduler::RunNodeLocal(unsigned int Width, unsigned int Height, unsigned int TileSize, const TileFunc& OnTile)
+{
+	RunInternal(Width, Height, TileSize, OnTile, nullptr, false);
+	//A node whose workers were all busy elsewhere leaves its tiles behind, they still have to be done
+	unsigned int Tile = 0;
+	for (unsigned int i = 0; i < GetWorkerCount(); i++)
+	{
+		while (PopOwn(i, Tile))
+		{
+			OnTile(MakeTile(Tile), i);
+		}
+	}
+}
+
+bool VTileScheduler::RunInternal(unsigned int Width, unsigned int Height, unsigned int TileSize, const TileFunc& OnTile, const TileDoneFunc& OnTileDone, bool ShouldStealAcrossNodes)
+{
+	if (Width == 0 || Height == 0 || m_Queues.empty())
+	{
+		return true;
+	}
+	const auto FrameStart = std::chrono::steady_clock::now();
+	m_Width = Width;
+	m_Height = Height;
+	m_TileSize = TileSize > 0 ? TileSize : 1;
+	m_TilesX = (Width + m_TileSize - 1) / m_TileSize;
+	const unsigned int TilesY = (Height + m_TileSize - 1) / m_TileSize;
+	const unsigned int TileCount = m_TilesX * TilesY;
+	const unsigned int WorkerCount = GetWorkerCount();
+	m_OnTile = &OnTile;
+	m_ShouldCancel = false;
+	m_WorkersFinished = 0;
+	m_DoneTiles.clear();
+
+	m_ShouldStealAcrossNodes = ShouldStealAcrossNodes;
+	DealTiles(TileCount, TilesY);
+	for (TileWorkerStats& Stats : m_WorkerStats)
+	{
+		Stats = TileWorkerStats();
+	}
+
+	std::vector<std::future<void>> Futures;
+	Futures.reserve(WorkerCount);
+	for (unsigned int i = 0; i < WorkerCount; i++)
+	{
+		Futures.push_back(m_ThreadPool.SubmitTask([this]()
+		{
+			WorkerLoop();
+		}));
+	}
+
+	//Report finished tiles on this thread until every worker has left its loop
+	std::vector<unsigned int> TilesToReport;
+	{
+		std::unique_lock<std::mutex> Lock(m_DoneMutex);
+		while (true)
+		{
+			m_DoneCondition.wait(Lock, [this, WorkerCount]()
+			{
+				return !m_DoneTiles.empty() || m_WorkersFinished == WorkerCount;
+			});
+			if (m_DoneTiles.empty())
+			{
+				break;
+			}
+			TilesToReport.swap(m_DoneTiles);
+			m_DoneTiles.clear();
+			Lock.unlock();
+			for (unsigned int Tile : TilesToReport)
+			{
+				if (OnTileDone && !m_ShouldCancel && !OnTileDone(MakeTile(Tile)))
+				{
+					m_ShouldCancel = true;
+				}
+			}
+			Lock.lock();
+		}
+	}
+	for (auto& Future : Futures)
+	{
+		//Rethrows anything the tile function threw
+		Future.get();
+	}
+
+	m_LastFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - FrameStart).count();
+	for (TileWorkerStats& Stats : m_WorkerStats)
+	{
+		Stats.IdleMs = m_LastFrameMs > Stats.BusyMs ? m_LastFrameMs - Stats.BusyMs : 0.0;
+	}
+	m_OnTile = nullptr;
+	return !m_ShouldCancel;
+}
+
+void VTileScheduler::DealTiles(unsigned int TileCount, unsigned int TilesY)
+{
+	const unsigned int WorkerCount = GetWorkerCount();
+	for (unsigned int i = 0; i < WorkerCount; i++)
+	{
+		TileQueue& Queue = *m_Queues[i];
+		Queue.Tiles.clear();
+		Queue.Head = 0;
+		Queue.Tail = 0;
+	}
+
+	//Each node gets a band of tile rows sized by its share of the workers, and deals the band round-robin to its own workers
+	unsigned int FirstRow = 0;
+	unsigned int WorkersSoFar = 0;
+	for (const std::vector<unsigned int>& Workers : m_NodeWorkers)
+	{
+		WorkersSoFar += (unsigned int)Workers.size();
+		const unsigned int LastRow = (unsigned int)((unsigned long long)TilesY * WorkersSoFar / WorkerCount);
+		if (Workers.empty())
+		{
+			continue;
+		}
+		unsigned int Next = 0;
+		for (unsigned int Tile = FirstRow * m_TilesX; Tile < LastRow * m_TilesX && Tile < TileCount; Tile++)
+		{
+			m_Queues[Workers[Next]]->Tiles.push_back(Tile);
+			Next = (Next + 1) % (unsigned int)Workers.size();
+		}
+		FirstRow = LastRow;
+	}
+
+	for (unsigned int i = 0; i < WorkerCount; i++)
+	{
+		m_Queues[i]->Tail = m_Queues[i]->Tiles.size();
+	}
+}
+
+void VTileScheduler::WorkerLoop()
+{
+	//The queue belongs to the pool thread, not to the task. A thread that runs two of our tasks back to back simply finds its queue empty the second time
+	const unsigned int WorkerIndex = (unsigned int)m_ThreadPool.GetCurrentWorkerIndex();
+	TileWorkerStats& Stats = m_WorkerStats[WorkerIndex];
+	//Counts this worker as finished however the loop is left, so RunInternal stops waiting and gets to the future that rethrows a tile's exception
+	struct FinishGuard
+	{
+		VTileScheduler& Scheduler;
+		~FinishGuard()
+		{
+			{
+				std::lock_guard<std::mutex> Lock(Scheduler.m_DoneMutex);
+				Scheduler.m_WorkersFinished++;
+			}
+			Scheduler.m_DoneCondition.notify_one();
+		}
+	} Guard{ *this };
+	while (!m_ShouldCancel.load(std::memory_order_relaxed))
+	{
+		unsigned int Tile = 0;
+		bool IsStolen = false;
+		if (!PopOwn(WorkerIndex, Tile))
+		{
+			//No tile is ever added during a frame, so finding every queue empty means we are done
+			if (!Steal(WorkerIndex, Tile))
+			{
+				break;
+			}
+			IsStolen = true;
+		}
+
+		const auto TileStart = std::chrono::steady_clock::now();
+		{
+			VProfileZone TileZone(IsStolen ? "Stolen tile" : "Tile", "tile", Tile);
+			try
+			{
+				(*m_OnTile)(MakeTile(Tile), WorkerIndex);
+			}
+			catch (...)
+			{
+				//The frame is lost, stop the other workers from starting new tiles
+				m_ShouldCancel = true;
+				throw;
+			}
+		}
+		Stats.BusyMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - TileStart).count();
+		Stats.TilesRendered++;
+		Stats.TilesStolen += IsStolen ? 1 : 0;
+		{
+			std::lock_guard<std::mutex> Lock(m_DoneMutex);
+			m_DoneTiles.push_back(Tile);
+		}
+		m_DoneCondition.notify_one();
+	}
+}
+
+bool VTileScheduler::PopOwn(unsigned int WorkerIndex, unsigned int& OutTile)
+{
+	TileQueue& Queue = *m_Queues[WorkerIndex];
+	std::lock_guard<std::mutex> Lock(Queue.Mutex);
+	if (Queue.Head == Queue.Tail)
+	{
+		return false;
+	}
+	OutTile = Queue.Tiles[Queue.Head++];
+	return true;
+}
+
+bool VTileScheduler::Steal(unsigned int WorkerIndex, unsigned int& OutTile)
+{
+	//Walk the other queues starting from our neighbour, so the thieves do not all pile onto worker 0. Our own node comes first
+	const unsigned int WorkerCount = GetWorkerCount();
+	const unsigned int OwnNode = m_ThreadPool.GetWorkerNode(WorkerIndex);
+	for (unsigned int Offset = 1; Offset < WorkerCount; Offset++)
+	{
+		const unsigned int Victim = (WorkerIndex + Offset) % WorkerCount;
+		if (m_ThreadPool.GetWorkerNode(Victim) == OwnNode && StealFrom(Victim, OutTile))
+		{
+			return true;
+		}
+	}
+	if (!m_ShouldStealAcrossNodes || m_ThreadPool.GetNodeCount() == 1)
+	{
+		return false;
+	}
+	for (unsigned int Offset = 1; Offset < WorkerCount; Offset++)
+	{
+		const unsigned int Victim = (WorkerIndex + Offset) % WorkerCount;
+		if (m_ThreadPool.GetWorkerNode(Victim) != OwnNode && StealFrom(Victim, OutTile))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool VTileScheduler::StealFrom(unsigned int VictimIndex, unsigned int& OutTile)
+{
+	TileQueue& Victim = *m_Queues[VictimIndex];
+	std::lock_guard<std::mutex> Lock(Victim.Mutex);
+	if (Victim.Head != Victim.Tail)
+	{
+		OutTile = Victim.Tiles[--Victim.Tail];
+		return true;
+	}
+	return false;
+}
+
+RenderTile VTileScheduler::MakeTile(unsigned int TileIndex) const
+{
+	RenderTile Tile;
+	Tile.Index = TileIndex;
+	Tile.X0 = (TileIndex % m_TilesX) * m_TileSize;
+	Tile.Y0 = (TileIndex / m_TilesX) * m_TileSize;
+	Tile.X1 = std::min(Tile.X0 + m_TileSize, m_Width);
+	Tile.Y1 = std::min(Tile.Y0 + m_TileSize, m_Height);
+	return Tile;
+}
@@ -1,12 +1,19 @@
 #include "Public/Timer.h"
+#include "Public/TraceRecorder.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
 
 using namespace std::chrono;
 
 void VTimer::Start()
 {
-	m_StartTime = high_resolution_clock::now();
+	m_StartTime = steady_clock::now();
 	m_EndTime = STDTimePoint{};
-	m_LastDuration = 0;
+	m_LastDurationNs = 0;
 	m_HasStarted = true;
 }
 
@@ -19,16 +26,303 @@ long long int VTimer::GetTimeElapsed() const
 	}
 	else
 	{
-		high_resolution_clock::duration TimeElapsed = high_resolution_clock::now() - m_StartTime;
+		steady_clock::duration TimeElapsed = steady_clock::now() - m_StartTime;
 		return duration_cast<milliseconds>(TimeElapsed).count();
 	}
 }
 
 void VTimer::Stop()
 {
-	m_HasStarted = false; 
-	//By default the duration is in nanoseconds, so we have to do this. Come on WTF
-	high_resolution_clock::duration TimeElapsed = high_resolution_clock::now() - m_StartTime;
-	m_LastDuration = duration_cast<milliseconds>(TimeElapsed).count();
-	m_EndTime = high_resolution_clock::now();
+	m_HasStarted = false;
+	m_EndTime = steady_clock::now();
+	m_LastDurationNs = duration_cast<nanoseconds>(m_EndTime - m_StartTime).count();
+}
+
+namespace
+{
+	/*
+	* Zone durations go into a log-linear histogram instead of a list, so a zone costs the same few KB whether it ran once or once per tile for a thousand frames
+	* 1. Below 16 ns every nanosecond is its own bucket, above that every power of two is split into 16 buckets
+	* 2. A percentile is read back as the middle of its bucket, which is within about 3% of the exact value. Count, total and min stay exact
+	*/
+	constexpr unsigned int g_ProfileSubBucketBits = 4;
+	constexpr unsigned int g_ProfileSubBuckets = 1u << g_ProfileSubBucketBits;
+	constexpr unsigned int g_ProfileBucketCount = (64 - g_ProfileSubBucketBits + 1) * g_ProfileSubBuckets;
+
+	unsigned int GetProfileBucket(uint64_t DurationNs)
+	{
+		if (DurationNs < g_ProfileSubBuckets)
+		{
+			return (unsigned int)DurationNs;
+		}
+		const unsigned int Exponent = (unsigned int)std::bit_width(DurationNs) - 1;
+		const unsigned int SubBucket = (unsigned int)(DurationNs >> (Exponent - g_ProfileSubBucketBits)) & (g_ProfileSubBuckets - 1);
+		return (Exponent - g_ProfileSubBucketBits + 1) * g_ProfileSubBuckets + SubBucket;
+	}
+
+	uint64_t GetProfileBucketMiddle(unsigned int Bucket)
+	{
+		if (Bucket < g_ProfileSubBuckets)
+		{
+			return Bucket;
+		}
+		const unsigned int Exponent = Bucket / g_ProfileSubBuckets + g_ProfileSubBucketBits - 1;
+		const uint64_t Width = 1ull << (Exponent - g_ProfileSubBucketBits);
+		return (g_ProfileSubBuckets + Bucket % g_ProfileSubBuckets) * Width + Width / 2;
+	}
+
+	struct ProfileNode
+	{
+		const char* Name;
+		int Parent;
+		uint64_t Count = 0;
+		uint64_t TotalNs = 0;
+		uint64_t MinNs = UINT64_MAX;
+		uint64_t MaxNs = 0;
+		//Allocated on the first sample, a merged node that only groups children never needs one
+		std::vector<uint64_t> Histogram;
+
+		void Add(uint64_t DurationNs)
+		{
+			if (Histogram.empty())
+			{
+				Histogram.resize(g_ProfileBucketCount);
+			}
+			Count++;
+			TotalNs += DurationNs;
+			MinNs = std::min(MinNs, DurationNs);
+			MaxNs = std::max(MaxNs, DurationNs);
+			Histogram[GetProfileBucket(DurationNs)]++;
+		}
+
+		void Merge(const ProfileNode& Other)
+		{
+			if (Other.Count == 0)
+			{
+				return;
+			}
+			if (Histogram.empty())
+			{
+				Histogram.resize(g_ProfileBucketCount);
+			}
+			Count += Other.Count;
+			TotalNs += Other.TotalNs;
+			MinNs = std::min(MinNs, Other.MinNs);
+			MaxNs = std::max(MaxNs, Other.MaxNs);
+			for (unsigned int i = 0; i < g_ProfileBucketCount; i++)
+			{
+				Histogram[i] += Other.Histogram[i];
+			}
+		}
+
+		//Same ranking as indexing a sorted list of every sample at (Count - 1) * Fraction, kept inside the exact min and max
+		uint64_t GetPercentile(double Fraction) const
+		{
+			const uint64_t Rank = (uint64_t)((double)(Count - 1) * Fraction);
+			uint64_t SamplesSoFar = 0;
+			for (unsigned int i = 0; i < g_ProfileBucketCount; i++)
+			{
+				SamplesSoFar += Histogram[i];
+				if (SamplesSoFar > Rank)
+				{
+					return std::clamp(GetProfileBucketMiddle(i), MinNs, MaxNs);
+				}
+			}
+			return MaxNs;
+		}
+
+		void Clear()
+		{
+			Count = 0;
+			TotalNs = 0;
+			MinNs = UINT64_MAX;
+			MaxNs = 0;
+			std::fill(Histogram.begin(), Histogram.end(), 0);
+		}
+	};
+
+	//Nodes are only ever appended, so a parent always comes before its children
+	struct ProfileThreadTree
+	{
+		std::vector<ProfileNode> Nodes;
+		int Current = -1;
+	};
+
+	//Trees outlive their threads, a pool that is gone by the time we print still counts
+	struct ProfileRegistry
+	{
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<ProfileThreadTree>> Trees;
+	};
+
+	ProfileRegistry& GetRegistry()
+	{
+		static ProfileRegistry Registry;
+		return Registry;
+	}
+
+	ProfileThreadTree& GetThreadTree()
+	{
+		thread_local ProfileThreadTree* t_Tree = nullptr;
+		if (!t_Tree)
+		{
+			ProfileRegistry& Registry = GetRegistry();
+			std::lock_guard<std::mutex> Lock(Registry.Mutex);
+			Registry.Trees.push_back(std::make_unique<ProfileThreadTree>());
+			t_Tree = Registry.Trees.back().get();
+		}
+		return *t_Tree;
+	}
+
+	//Child of Parent called Name, created on first use. Zones per parent are few, a linear scan beats a map here
+	int FindOrAddChild(std::vector<ProfileNode>& Nodes, int Parent, const char* Name)
+	{
+		for (size_t i = 0; i < Nodes.size(); i++)
+		{
+			if (Nodes[i].Parent == Parent && (Nodes[i].Name == Name || std::strcmp(Nodes[i].Name, Name) == 0))
+			{
+				return (int)i;
+			}
+		}
+		ProfileNode& Node = Nodes.emplace_back();
+		Node.Name = Name;
+		Node.Parent = Parent;
+		return (int)Nodes.size() - 1;
+	}
+
+	void AppendSummary(const std::vector<ProfileNode>& Nodes, int Parent, unsigned int Depth, std::vector<ProfileZoneStats>& OutSummary)
+	{
+		for (size_t i = 0; i < Nodes.size(); i++)
+		{
+			if (Nodes[i].Parent != Parent)
+			{
+				continue;
+			}
+			const ProfileNode& Node = Nodes[i];
+			ProfileZoneStats Stats;
+			Stats.Name = Node.Name;
+			Stats.Depth = Depth;
+			Stats.Count = Node.Count;
+			if (Node.Count > 0)
+			{
+				Stats.TotalNs = Node.TotalNs;
+				Stats.MinNs = Node.MinNs;
+				Stats.MeanNs = Node.TotalNs / Node.Count;
+				Stats.P50Ns = Node.GetPercentile(0.5);
+				Stats.P99Ns = Node.GetPercentile(0.99);
+			}
+			OutSummary.push_back(Stats);
+			AppendSummary(Nodes, (int)i, Depth + 1, OutSummary);
+		}
+	}
+}
+
+void VProfiler::Reset()
+{
+	ProfileRegistry& Registry = GetRegistry();
+	std::lock_guard<std::mutex> Lock(Registry.Mutex);
+	for (std::unique_ptr<ProfileThreadTree>& Tree : Registry.Trees)
+	{
+		//Keep the nodes, an open zone on this thread still points at its node
+		for (ProfileNode& Node : Tree->Nodes)
+		{
+			Node.Clear();
+		}
+	}
+}
+
+std::vector<ProfileZoneStats> VProfiler::GetSummary()
+{
+	//Merge every thread's tree into one by path, then walk it
+	std::vector<ProfileNode> Merged;
+	{
+		ProfileRegistry& Registry = GetRegistry();
+		std::lock_guard<std::mutex> Lock(Registry.Mutex);
+		for (const std::unique_ptr<ProfileThreadTree>& Tree : Registry.Trees)
+		{
+			std::vector<int> MergedIndex(Tree->Nodes.size(), -1);
+			for (size_t i = 0; i < Tree->Nodes.size(); i++)
+			{
+				const ProfileNode& Node = Tree->Nodes[i];
+				const int Parent = Node.Parent >= 0 ? MergedIndex[Node.Parent] : -1;
+				MergedIndex[i] = FindOrAddChild(Merged, Parent, Node.Name);
+				Merged[MergedIndex[i]].Merge(Node);
+			}
+		}
+	}
+
+	std::vector<ProfileZoneStats> Summary;
+	AppendSummary(Merged, -1, 0, Summary);
+	//Zones reset away to nothing would only be noise
+	Summary.erase(std::remove_if(Summary.begin(), Summary.end(), [](const ProfileZoneStats& Stats) { return Stats.Count == 0; }), Summary.end());
+	return Summary;
+}
+
+void VProfiler::PrintSummary(std::ostream& Out)
+{
+	if (!IsCompiledIn())
+	{
+		Out << "Profiler: compiled out, rebuild with -DRAYTRACER_PROFILER=ON\n";
+		return;
+	}
+	char Line[256];
+	std::snprintf(Line, sizeof(Line), "%-32s %8s %12s %10s %10s %10s %10s\n", "Zone", "Count", "Total ms", "Min ms", "Mean ms", "P50 ms", "P99 ms");
+	Out << Line;
+	for (const ProfileZoneStats& Stats : GetSummary())
+	{
+		const std::string Name = std::string(Stats.Depth * 2, ' ') + Stats.Name;
+		std::snprintf(Line, sizeof(Line), "%-32s %8llu %12.3f %10.3f %10.3f %10.3f %10.3f\n", Name.c_str(), (unsigned long long)Stats.Count, Stats.TotalNs / 1e6,
+			Stats.MinNs / 1e6, Stats.MeanNs / 1e6, Stats.P50Ns / 1e6, Stats.P99Ns / 1e6);
+		Out << Line;
+	}
+}
+
+VProfileZone::VProfileZone(const char* Name, const char* ArgName, int64_t Arg) : m_Name(Name), m_ArgName(ArgName), m_Arg(Arg)
+{
+#if RAYTRACER_PROFILER
+	ProfileThreadTree& Tree = GetThreadTree();
+	m_Node = FindOrAddChild(Tree.Nodes, Tree.Current, Name);
+	Tree.Current = m_Node;
+#else
+	m_Node = -1;
+#endif
+	if (VTraceRecorder::IsEnabled())
+	{
+		m_IsTraced = true;
+		m_TraceStartNs = VTraceRecorder::Now();
+	}
+	m_StartTime = steady_clock::now();
+}
+
+uint64_t VProfileZone::GetElapsedNs() const
+{
+	return m_IsOpen ? (uint64_t)duration_cast<nanoseconds>(steady_clock::now() - m_StartTime).count() : m_DurationNs;
+}
+
+uint64_t VProfileZone::Stop()
+{
+	if (!m_IsOpen)
+	{
+		return m_DurationNs;
+	}
+	m_DurationNs = (uint64_t)duration_cast<nanoseconds>(steady_clock::now() - m_StartTime).count();
+	m_IsOpen = false;
+
+#if RAYTRACER_PROFILER
+	ProfileThreadTree& Tree = GetThreadTree();
+	Tree.Nodes[m_Node].Add(m_DurationNs);
+	Tree.Current = Tree.Nodes[m_Node].Parent;
+#endif
+	if (m_IsTraced)
+	{
+		TraceEvent Event;
+		Event.Name = m_Name;
+		Event.Category = "zone";
+		Event.StartNs = m_TraceStartNs;
+		Event.DurationNs = m_DurationNs;
+		Event.ArgName = m_ArgName;
+		Event.Arg = m_Arg;
+		VTraceRecorder::Record(Event);
+	}
+	return m_DurationNs;
 }
@@ -0,0 +1,192 @@
+#include "Public/TraceRecorder.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	//Write Text as a quoted JSON string, escaping the quotes, backslashes and control characters a free text name may hold
+	void WriteJSONString(FILE* File, const char* Text)
+	{
+		std::fputc('"', File);
+		for (const char* Char = Text; *Char; Char++)
+		{
+			const unsigned char Value = (unsigned char)*Char;
+			if (Value == '"' || Value == '\\')
+			{
+				std::fputc('\\', File);
+				std::fputc(Value, File);
+			}
+			else if (Value < 0x20)
+			{
+				std::fprintf(File, "\\u%04x", Value);
+			}
+			else
+			{
+				std::fputc(Value, File);
+			}
+		}
+		std::fputc('"', File);
+	}
+
+	struct TraceThreadBuffer
+	{
+		std::unique_ptr<TraceEvent[]> Events;
+		size_t Mask = 0;
+		//Events ever written, the ring holds the last Mask + 1 of them
+		uint64_t Written = 0;
+		unsigned int ThreadId = 0;
+		std::string Name;
+	};
+
+	//Buffers outlive their threads, a pool worker that is gone by the time we dump still shows up
+	struct TraceRegistry
+	{
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<TraceThreadBuffer>> Buffers;
+		size_t EventsPerThread = 1 << 16;
+		std::atomic<long long int> EpochNs = 0;
+		//Bumped by Enable, a thread whose buffer belongs to an older generation takes a fresh one
+		std::atomic<unsigned int> Generation = 0;
+	};
+
+	TraceRegistry& GetRegistry()
+	{
+		static TraceRegistry Registry;
+		return Registry;
+	}
+
+	thread_local TraceThreadBuffer* t_Buffer = nullptr;
+	thread_local unsigned int t_Generation = 0;
+	thread_local std::string t_ThreadName;
+
+	long long int SteadyNowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	TraceThreadBuffer* CreateThreadBuffer()
+	{
+		TraceRegistry& Registry = GetRegistry();
+		std::lock_guard<std::mutex> Lock(Registry.Mutex);
+		std::unique_ptr<TraceThreadBuffer> Buffer = std::make_unique<TraceThreadBuffer>();
+		Buffer->Events = std::make_unique<TraceEvent[]>(Registry.EventsPerThread);
+		Buffer->Mask = Registry.EventsPerThread - 1;
+		Buffer->ThreadId = (unsigned int)Registry.Buffers.size() + 1;
+		Buffer->Name = t_ThreadName.empty() ? "Thread " + std::to_string(Buffer->ThreadId) : t_ThreadName;
+		Registry.Buffers.push_back(std::move(Buffer));
+		return Registry.Buffers.back().get();
+	}
+}
+
+void VTraceRecorder::Enable(size_t EventsPerThread)
+{
+	TraceRegistry& Registry = GetRegistry();
+	{
+		std::lock_guard<std::mutex> Lock(Registry.Mutex);
+		size_t Capacity = 1;
+		while (Capacity < EventsPerThread)
+		{
+			Capacity <<= 1;
+		}
+		Registry.EventsPerThread = Capacity;
+		Registry.Buffers.clear();
+		Registry.EpochNs = SteadyNowNs();
+		Registry.Generation++;
+	}
+	s_IsEnabled.store(true, std::memory_order_release);
+}
+
+void VTraceRecorder::Disable()
+{
+	s_IsEnabled.store(false, std::memory_order_release);
+}
+
+void VTraceRecorder::SetThreadName(const std::string& Name)
+{
+	t_ThreadName = Name;
+	if (t_Buffer && t_Generation == GetRegistry().Generation.load(std::memory_order_relaxed))
+	{
+		std::lock_guard<std::mutex> Lock(GetRegistry().Mutex);
+		t_Buffer->Name = Name;
+	}
+}
+
+uint64_t VTraceRecorder::Now()
+{
+	return (uint64_t)(SteadyNowNs() - GetRegistry().EpochNs.load(std::memory_order_relaxed));
+}
+
+void VTraceRecorder::Record(const TraceEvent& Event)
+{
+	const unsigned int Generation = GetRegistry().Generation.load(std::memory_order_relaxed);
+	if (!t_Buffer || t_Generation != Generation)
+	{
+		t_Buffer = CreateThreadBuffer();
+		t_Generation = Generation;
+	}
+	TraceThreadBuffer& Buffer = *t_Buffer;
+	Buffer.Events[Buffer.Written & Buffer.Mask] = Event;
+	Buffer.Written++;
+}
+
+bool VTraceRecorder::WriteChromeTrace(const std::string& Path, size_t* OutEventCount, size_t* OutDroppedCount)
+{
+	FILE* File = std::fopen(Path.c_str(), "wb");
+	if (!File)
+	{
+		return false;
+	}
+
+	TraceRegistry& Registry = GetRegistry();
+	std::lock_guard<std::mutex> Lock(Registry.Mutex);
+	size_t EventCount = 0;
+	size_t DroppedCount = 0;
+	bool IsFirst = true;
+	std::fprintf(File, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+	for (const std::unique_ptr<TraceThreadBuffer>& Buffer : Registry.Buffers)
+	{
+		std::fprintf(File, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": ", IsFirst ? "" : ",\n", Buffer->ThreadId);
+		WriteJSONString(File, Buffer->Name.c_str());
+		std::fprintf(File, "}}");
+		IsFirst = false;
+
+		//Oldest surviving event first
+		const uint64_t Capacity = Buffer->Mask + 1;
+		const uint64_t First = Buffer->Written > Capacity ? Buffer->Written - Capacity : 0;
+		DroppedCount += (size_t)First;
+		for (uint64_t i = First; i < Buffer->Written; i++)
+		{
+			const TraceEvent& Event = Buffer->Events[i & Buffer->Mask];
+			//Chrome wants microseconds, the fraction keeps the nanoseconds
+			std::fprintf(File, ",\n{\"name\": ");
+			WriteJSONString(File, Event.Name);
+			std::fprintf(File, ", \"cat\": ");
+			WriteJSONString(File, Event.Category);
+			std::fprintf(File, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f", Buffer->ThreadId, (double)Event.StartNs / 1000.0, (double)Event.DurationNs / 1000.0);
+			if (Event.ArgName)
+			{
+				std::fprintf(File, ", \"args\": {");
+				WriteJSONString(File, Event.ArgName);
+				std::fprintf(File, ": %lld}", (long long int)Event.Arg);
+			}
+			std::fprintf(File, "}");
+			EventCount++;
+		}
+	}
+	std::fprintf(File, "\n]}\n");
+	const bool HasSucceeded = std::ferror(File) == 0;
+	std::fclose(File);
+
+	if (OutEventCount)
+	{
+		*OutEventCount = EventCount;
+	}
+	if (OutDroppedCount)
+	{
+		*OutDroppedCount = DroppedCount;
+	}
+	return HasSucceeded;
+}
@@ -1,7 +1,29 @@
 #include "Public/VMaterial.h"
 #include "Public/HittableList.h"
+#include "Public/RenderStats.h"
+#include "Public/Sampler.h"
+
+namespace
+{
+	using DispatchScatterFunc = bool(*)(const Ray&, const HitRecord&, Color&, Ray&, const MaterialScatterData&, MaterialType);
+	DispatchScatterFunc SelectDispatchScatter(ISALevel Level);
+
+	//Selected at static init time from the CPU, SetActiveISA can swap it before rendering starts
+	DispatchScatterFunc g_DispatchScatter = SelectDispatchScatter(CPUDispatch::GetActiveISA());
+}
 
 bool VMaterial::DispatchScatter(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData& Data, MaterialType Type)
+{
+	RAYTRACER_STAT(RenderStats::Local().HitsPerMaterial[Type < g_StatsMaterialCount ? Type : 0]++);
+	return g_DispatchScatter(R, InHitRecord, OutAttenuation, OutScattered, Data, Type);
+}
+
+void VMaterial::SelectISA(ISALevel Level)
+{
+	g_DispatchScatter = SelectDispatchScatter(Level);
+}
+
+RAYTRACER_FORCEINLINE bool VMaterial::DispatchScatterImpl(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData& Data, MaterialType Type)
 {
 	bool Result = false;
 	switch (Type)
@@ -29,10 +51,13 @@ bool VMaterial::DispatchScatter(const Ray& R, const HitRecord& InHitRecord, Colo
 	return Result;
 }
 
-bool VMaterial::Lambertian(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData& Data)
+RAYTRACER_FORCEINLINE bool VMaterial::Lambertian(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData& Data)
 {
 	//There's a chance that the random unit vector is pointing opposite to the normal, so we need to check for 0
-	Vector3D ScatterDirection = Vector3D::RandomUnitVector() + InHitRecord.HitNormal;
+	float U = 0.f;
+	float V = 0.f;
+	VSampler::Get2D(SampleDimension::ScatterDirection, U, V);
+	Vector3D ScatterDirection = VSampler::UniformSphere(U, V) + InHitRecord.HitNormal;
 	if (ScatterDirection.NearZero())
 	{
 		ScatterDirection = InHitRecord.HitNormal;
@@ -43,16 +68,19 @@ bool VMaterial::Lambertian(const Ray& R, const HitRecord& InHitRecord, Color& Ou
 	return true;
 }
 
-bool VMaterial::Metalic(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData& Data)
+RAYTRACER_FORCEINLINE bool VMaterial::Metalic(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData& Data)
 {
 	Vector3D ScatterDirection = Vector3D::Reflect(R.Direction(), InHitRecord.HitNormal);
-	ScatterDirection = ScatterDirection.Normalize() + Data.FuzzOrRI * Vector3D::RandomUnitVector();
+	float U = 0.f;
+	float V = 0.f;
+	VSampler::Get2D(SampleDimension::ScatterDirection, U, V);
+	ScatterDirection = ScatterDirection.Normalize() + Data.FuzzOrRI * VSampler::UniformSphere(U, V);
 	OutScattered = Ray(InHitRecord.HitPoint, ScatterDirection);
 	OutAttenuation = Data.Albedo;
 	return OutScattered.Direction().Dot(InHitRecord.HitNormal) > 0.f;
 }
 
-bool VMaterial::Dielectric(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData& Data)
+RAYTRACER_FORCEINLINE bool VMaterial::Dielectric(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData& Data)
 {
 	//We do not attenuate(absorb) refracted lights
 	OutAttenuation = Color(1.f, 1.f, 1.f);
@@ -68,7 +96,7 @@ bool VMaterial::Dielectric(const Ray& R, const HitRecord& InHitRecord, Color& Ou
 	float SinTheta = std::sqrt(1 - CosTheta * CosTheta);
 	bool CanRefract = RelativeRI * SinTheta <= 1.f;
 	Vector3D ScatteredDirection;
-	if (CanRefract && Reflectance(CosTheta, RelativeRI) <= Utility::RandomFloat())
+	if (CanRefract && Reflectance(CosTheta, RelativeRI) <= VSampler::Get1D(SampleDimension::ScatterChoice))
 	{
 		ScatteredDirection = Vector3D::Refract(UnitDirection, InHitRecord.HitNormal, RelativeRI);
 	}
@@ -82,7 +110,7 @@ bool VMaterial::Dielectric(const Ray& R, const HitRecord& InHitRecord, Color& Ou
 	return true;
 }
 
-float VMaterial::Reflectance(float Cosine, float RelativeRI)
+RAYTRACER_FORCEINLINE float VMaterial::Reflectance(float Cosine, float RelativeRI)
 {
 	float R0 = (1.f - RelativeRI) / (1.f + RelativeRI);
 	R0 = R0 * R0;
@@ -91,3 +119,54 @@ float VMaterial::Reflectance(float Cosine, float RelativeRI)
 	float t2 = t * t;
 	return R0 + (1.f - R0) * t2 * t2 * t;
 }
+
+//The same scatter code compiled once per ISA. Everything DispatchScatterImpl inlines gets the wider instruction set(FMA, AVX registers)
+struct VMaterialVariants
+{
+	static bool Scalar(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData& Data, MaterialType Type)
+	{
+		return VMaterial::DispatchScatterImpl(R, InHitRecord, OutAttenuation, OutScattered, Data, Type);
+	}
+#if RAYTRACER_X86_DISPATCH
+	RAYTRACER_TARGET_SSE42 static bool SSE42(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData& Data, MaterialType Type)
+	{
+		return VMaterial::DispatchScatterImpl(R, InHitRecord, OutAttenuation, OutScattered, Data, Type);
+	}
+	RAYTRACER_TARGET_AVX2 static bool AVX2(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData& Data, MaterialType Type)
+	{
+		return VMaterial::DispatchScatterImpl(R, InHitRecord, OutAttenuation, OutScattered, Data, Type);
+	}
+	RAYTRACER_TARGET_AVX512 static bool AVX512(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData& Data, MaterialType Type)
+	{
+		return VMaterial::DispatchScatterImpl(R, InHitRecord, OutAttenuation, OutScattered, Data, Type);
+	}
+#endif
+};
+
+namespace
+{
+	DispatchScatterFunc SelectDispatchScatter(ISALevel Level)
+	{
+		switch (Level)
+		{
+#if RAYTRACER_X86_DISPATCH
+			case ISALevel::AVX512:
+			{
+				return &VMaterialVariants::AVX512;
+			}
+			case ISALevel::AVX2:
+			{
+				return &VMaterialVariants::AVX2;
+			}
+			case ISALevel::SSE42:
+			{
+				return &VMaterialVariants::SSE42;
+			}
+#endif
+			default:
+			{
+				return &VMaterialVariants::Scalar;
+			}
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "AlignedAllocator.h"
+#include <cstdint>
+
+/*
+* Arbitrary output variables: extra per-pixel planes filled from the camera ray's first hit while the image renders, so compositing and debug views
+* come out of the same traversal as the beauty pass
+* 1. Planar: every channel is its own array starting on a cache line, so a writer or a compositor walks one plane at a time and never strides over the others
+* 2. Normal and albedo are averaged over the pixel's samples like the color. Distance, object id and material are taken from the pixel's first sample,
+*    blending them across an edge would make values that belong to neither side
+* 3. A camera ray that escapes leaves distance at +infinity, object id at -1, material at AOVMissMaterial, the normal at 0 and the sky color as albedo
+*/
+
+namespace AOVPlane
+{
+	//Distance along the camera ray to the first hit, in world units
+	inline constexpr uint32_t Distance = 1u << 0;
+	//First-hit normal, facing the camera
+	inline constexpr uint32_t Normal = 1u << 1;
+	//What the first hit lets through: the material albedo, 1 for glass
+	inline constexpr uint32_t Albedo = 1u << 2;
+	//Add order of the first-hit sphere(see HittableList::GetSphereID)
+	inline constexpr uint32_t ObjectID = 1u << 3;
+	//MaterialType of the first hit
+	inline constexpr uint32_t Material = 1u << 4;
+	inline constexpr uint32_t All = Distance | Normal | Albedo | ObjectID | Material;
+}
+
+inline constexpr uint8_t AOVMissMaterial = 255;
+
+class VAOVBuffer
+{
+public:
+	//Allocate the planes in Planes(AOVPlane bits) for a Width x Height frame and drop the rest
+	void Allocate(unsigned int Width, unsigned int Height, uint32_t Planes);
+	uint32_t GetPlanes() const { return m_Planes; }
+	bool Has(uint32_t Plane) const { return (m_Planes & Plane) != 0; }
+	unsigned int GetWidth() const { return m_Width; }
+	unsigned int GetHeight() const { return m_Height; }
+
+	//nullptr for planes that were not allocated. Axis and Channel are 0 to 2
+	float* GetDistance() { return Has(AOVPlane::Distance) ? m_Distance.data() : nullptr; }
+	const float* GetDistance() const { return Has(AOVPlane::Distance) ? m_Distance.data() : nullptr; }
+	float* GetNormal(unsigned int Axis) { return Has(AOVPlane::Normal) ? m_Normal[Axis].data() : nullptr; }
+	const float* GetNormal(unsigned int Axis) const { return Has(AOVPlane::Normal) ? m_Normal[Axis].data() : nullptr; }
+	float* GetAlbedo(unsigned int Channel) { return Has(AOVPlane::Albedo) ? m_Albedo[Channel].data() : nullptr; }
+	const float* GetAlbedo(unsigned int Channel) const { return Has(AOVPlane::Albedo) ? m_Albedo[Channel].data() : nullptr; }
+	int32_t* GetObjectID() { return Has(AOVPlane::ObjectID) ? m_ObjectID.data() : nullptr; }
+	const int32_t* GetObjectID() const { return Has(AOVPlane::ObjectID) ? m_ObjectID.data() : nullptr; }
+	uint8_t* GetMaterial() { return Has(AOVPlane::Material) ? m_Material.data() : nullptr; }
+	const uint8_t* GetMaterial() const { return Has(AOVPlane::Material) ? m_Material.data() : nullptr; }
+
+	static const char* GetPlaneName(uint32_t Plane);
+	//Comma separated plane names(e.g. "distance,normal") or "all". Returns false on an unknown name
+	static bool ParsePlaneList(const char* List, uint32_t& OutPlanes);
+
+private:
+	unsigned int m_Width = 0;
+	unsigned int m_Height = 0;
+	uint32_t m_Planes = 0;
+	AlignedVector<float> m_Distance;
+	AlignedVector<float> m_Normal[3];
+	AlignedVector<float> m_Albedo[3];
+	AlignedVector<int32_t> m_ObjectID;
+	AlignedVector<uint8_t> m_Material;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+/*
+* Minimal allocator that hands out memory aligned to Alignment bytes
+* Used for the SoA sphere arrays so the SIMD kernels can use aligned loads, and so one array never straddles more cache lines than it has to
+*/
+template<typename T, size_t Alignment = 64>
+class AlignedAllocator
+{
+public:
+	using value_type = T;
+
+	template<typename U>
+	struct rebind
+	{
+		using other = AlignedAllocator<U, Alignment>;
+	};
+
+	AlignedAllocator() = default;
+	template<typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(size_t Count)
+	{
+		return static_cast<T*>(::operator new(Count * sizeof(T), std::align_val_t(Alignment)));
+	}
+	void deallocate(T* Pointer, size_t)
+	{
+		::operator delete(Pointer, std::align_val_t(Alignment));
+	}
+
+	template<typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+	template<typename U>
+	bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+template<typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
@@ -53,6 +53,8 @@ private:
 	unsigned int m_Height = 0;
 	unsigned int m_SampleCount = 0;
 	unsigned int m_MaxDepth = 0;
+	//0 keeps the plain max bounce cutoff
+	unsigned int m_RouletteMinDepth = 0;
 	//Dialog box stuffs
 	std::wstring m_CPUName;
 	std::wstring m_GPUName;
@@ -61,5 +63,6 @@ private:
 	std::vector<std::pair<int, int>> m_Resolutions;
 	std::vector<unsigned int> m_SampleCounts;
 	std::vector<unsigned int> m_MaxDepths;
+	std::vector<unsigned int> m_RouletteMinDepths;
 	
 };
\ No newline at end of file
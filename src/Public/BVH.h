@@ -0,0 +1,190 @@
+#pragma once
+
+#include "Ray.h"
+#include "AlignedAllocator.h"
+#include "Interval.h"
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+
+struct SphereTransformData;
+
+/*
+* A bounding volume hierarchy over the sphere transform array, built with the surface area heuristic(SAH)
+* 1. The nodes live in one flat array. Children are always allocated in pairs, so both child boxes of a node share a cache line
+* 2. Node 0 is the root and node 1 is left unused. The array is 64-byte aligned and nodes are 32 bytes, so every sibling pair fills exactly one cache line
+* 3. The build sorts primitive indices so every leaf covers a contiguous range. HittableList then reorders its component arrays with that order
+*    which means a leaf is just [FirstPrimitive, FirstPrimitive + PrimitiveCount) in the sphere arrays, no indirection during traversal
+*/
+
+struct alignas(32) BVHNode
+{
+	Vector3D BoundsMin;
+	//Index of the left child for interior nodes(the right child is LeftFirst + 1), index of the first sphere for leaves
+	unsigned int LeftFirst = 0;
+	Vector3D BoundsMax;
+	//0 for interior nodes
+	unsigned int PrimitiveCount = 0;
+
+	bool IsLeaf() const { return PrimitiveCount > 0; }
+};
+static_assert(sizeof(BVHNode) == 32, "A sibling pair has to fill exactly one cache line");
+
+struct BVHBuildStats
+{
+	double BuildTimeMs = 0.0;
+	unsigned int NodeCount = 0;
+	unsigned int LeafCount = 0;
+	unsigned int MaxDepth = 0;
+	unsigned int MaxLeafSize = 0;
+	//Expected cost of a random ray relative to testing a single sphere, the linear loop would score the sphere count here
+	float SAHCost = 0.f;
+};
+
+class SphereBVH
+{
+public:
+	SphereBVH() = default;
+	/*
+	* Build the hierarchy over the given spheres
+	* OutPrimitiveOrder receives the order the spheres must be stored in for the leaf ranges to be valid
+	* LeafBatchSize is how many spheres the leaf kernel tests at once. The SAH charges a leaf per batch, so SIMD kernels get wider leaves
+	*/
+	void Build(const std::vector<SphereTransformData>& Spheres, std::vector<unsigned int>& OutPrimitiveOrder, unsigned int LeafBatchSize = 1);
+	/*
+	* Take over nodes built earlier(e.g. stored in a scene file) instead of building. The spheres must already be in the order they were built with
+	* The nodes are checked before anything is kept: children after their parent, leaf ranges inside PrimitiveCount, depth within the traversal stack
+	* Returns false and leaves the hierarchy empty if they do not hold up
+	*/
+	bool Assign(const BVHNode* Nodes, unsigned int NodeCount, unsigned int PrimitiveCount);
+	void Clear();
+	bool IsBuilt() const { return !m_Nodes.empty(); }
+	const BVHBuildStats& GetBuildStats() const { return m_BuildStats; }
+	const AlignedVector<BVHNode>& GetNodes() const { return m_Nodes; }
+
+	/*
+	* Front to back traversal. The nearer child is visited first so the closest hit shrinks ClosestSoFar early and the far child gets culled more often
+	* LeafFunc is called as LeafFunc(FirstPrimitive, PrimitiveCount, ClosestSoFar) and must lower ClosestSoFar when it finds a closer hit
+	* OutNodesVisited is the traversal step count, used for the statistics
+	*/
+	template<typename LeafFunc>
+	void Traverse(const Ray& R, Interval HitInterval, float& ClosestSoFar, LeafFunc&& OnLeaf, unsigned int& OutNodesVisited) const;
+
+private:
+	struct BuildPrimitive
+	{
+		Vector3D BoundsMin;
+		Vector3D BoundsMax;
+		Vector3D Centroid;
+	};
+
+	void Subdivide(unsigned int NodeIndex, unsigned int Depth, std::vector<BuildPrimitive>& Primitives, std::vector<unsigned int>& PrimitiveOrder);
+	//Node, leaf and SAH cost figures of m_Nodes. MaxDepth is left to the caller, the build tracks it while subdividing
+	void GatherBuildStats();
+	void UpdateNodeBounds(unsigned int NodeIndex, const std::vector<BuildPrimitive>& Primitives, const std::vector<unsigned int>& PrimitiveOrder);
+	float FindBestSplit(const BVHNode& Node, const std::vector<BuildPrimitive>& Primitives, const std::vector<unsigned int>& PrimitiveOrder, int& OutAxis, float& OutSplitPos) const;
+
+	static float IntersectBounds(const Ray& R, const Vector3D& InvDirection, const BVHNode& Node, float TMin, float TMax);
+	static float SurfaceArea(const Vector3D& BoundsMin, const Vector3D& BoundsMax);
+	float LeafCost(unsigned int PrimitiveCount) const;
+
+private:
+	AlignedVector<BVHNode> m_Nodes;
+	unsigned int m_NodesUsed = 0;
+	unsigned int m_LeafBatchSize = 1;
+	BVHBuildStats m_BuildStats;
+};
+
+//Slab test. Returns the entry distance, or infinity when the ray misses the box or the box is beyond the current closest hit
+inline float SphereBVH::IntersectBounds(const Ray& R, const Vector3D& InvDirection, const BVHNode& Node, float TMin, float TMax)
+{
+	const Point3D& Origin = R.Origin();
+	float TX1 = (Node.BoundsMin.X - Origin.X) * InvDirection.X;
+	float TX2 = (Node.BoundsMax.X - Origin.X) * InvDirection.X;
+	float TNear = std::min(TX1, TX2);
+	float TFar = std::max(TX1, TX2);
+	float TY1 = (Node.BoundsMin.Y - Origin.Y) * InvDirection.Y;
+	float TY2 = (Node.BoundsMax.Y - Origin.Y) * InvDirection.Y;
+	TNear = std::max(TNear, std::min(TY1, TY2));
+	TFar = std::min(TFar, std::max(TY1, TY2));
+	float TZ1 = (Node.BoundsMin.Z - Origin.Z) * InvDirection.Z;
+	float TZ2 = (Node.BoundsMax.Z - Origin.Z) * InvDirection.Z;
+	TNear = std::max(TNear, std::min(TZ1, TZ2));
+	TFar = std::min(TFar, std::max(TZ1, TZ2));
+
+	if (TFar >= TNear && TFar > TMin && TNear < TMax)
+	{
+		return TNear;
+	}
+	return Constants::g_Infinity;
+}
+
+template<typename LeafFunc>
+inline void SphereBVH::Traverse(const Ray& R, Interval HitInterval, float& ClosestSoFar, LeafFunc&& OnLeaf, unsigned int& OutNodesVisited) const
+{
+	const Vector3D& Direction = R.Direction();
+	const Vector3D InvDirection(1.f / Direction.X, 1.f / Direction.Y, 1.f / Direction.Z);
+
+	//The far child is pushed with its entry distance, so once a closer hit was found it can be skipped without touching the node again
+	struct StackEntry
+	{
+		unsigned int NodeIndex;
+		float Distance;
+	};
+	//64 entries is plenty, the build caps the depth well below that
+	StackEntry Stack[64];
+	unsigned int StackSize = 0;
+	OutNodesVisited = 1;
+	if (IntersectBounds(R, InvDirection, m_Nodes[0], HitInterval.Min, ClosestSoFar) == Constants::g_Infinity)
+	{
+		return;
+	}
+
+	unsigned int NodeIndex = 0;
+	while (true)
+	{
+		const BVHNode& Node = m_Nodes[NodeIndex];
+		bool ShouldPop = true;
+		if (Node.IsLeaf())
+		{
+			OnLeaf(Node.LeftFirst, Node.PrimitiveCount, ClosestSoFar);
+		}
+		else
+		{
+			//Test both children and walk into the nearer one first, pushing the further one
+			unsigned int First = Node.LeftFirst;
+			unsigned int Second = Node.LeftFirst + 1;
+			float NearDistance = IntersectBounds(R, InvDirection, m_Nodes[First], HitInterval.Min, ClosestSoFar);
+			float FarDistance = IntersectBounds(R, InvDirection, m_Nodes[Second], HitInterval.Min, ClosestSoFar);
+			OutNodesVisited += 2;
+			if (FarDistance < NearDistance)
+			{
+				std::swap(NearDistance, FarDistance);
+				std::swap(First, Second);
+			}
+			if (NearDistance != Constants::g_Infinity)
+			{
+				NodeIndex = First;
+				ShouldPop = false;
+				if (FarDistance != Constants::g_Infinity)
+				{
+					Stack[StackSize++] = StackEntry{ Second, FarDistance };
+				}
+			}
+		}
+
+		if (ShouldPop)
+		{
+			//Drop every pushed node that now lies behind the closest hit
+			while (StackSize > 0 && Stack[StackSize - 1].Distance >= ClosestSoFar)
+			{
+				StackSize--;
+			}
+			if (StackSize == 0)
+			{
+				return;
+			}
+			NodeIndex = Stack[--StackSize].NodeIndex;
+		}
+	}
+}
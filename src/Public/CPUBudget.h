@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+/*
+* How many CPUs this process may actually use, which inside a container is usually much less than std::thread::hardware_concurrency reports
+* 1. The affinity mask(sched_getaffinity) covers cpusets, taskset and Docker's --cpuset-cpus
+* 2. The CFS bandwidth quota covers Kubernetes CPU limits and Docker's --cpus. Both cgroup v2(cpu.max) and v1(cpu.cfs_quota_us / cpu.cfs_period_us) are read,
+*    walking from our own cgroup up to the mount root since any ancestor can carry the tightest limit
+* 3. The NUMA layout comes from /sys/devices/system/node, restricted to the CPUs in the affinity mask
+* On platforms without these mechanisms the numbers fall back to hardware_concurrency and a single node
+*/
+
+struct CPUBudgetInfo
+{
+	//std::thread::hardware_concurrency
+	unsigned int HardwareThreads = 0;
+	//CPUs in our affinity mask, equals HardwareThreads where there is no affinity API
+	unsigned int AffinityThreads = 0;
+	//CFS quota divided by the period, in CPUs. 0 means no quota
+	double QuotaCPUs = 0.0;
+	//"cgroup v2" or "cgroup v1" when QuotaCPUs is set
+	const char* QuotaSource = "";
+	//Threads we can keep busy without being throttled: min(affinity, floor(quota)), at least 1
+	unsigned int AvailableThreads = 1;
+};
+
+struct NUMANodeInfo
+{
+	//The kernel's node number, which can have gaps
+	unsigned int Node = 0;
+	//CPUs of this node that we are allowed to run on, ascending
+	std::vector<unsigned int> CPUs;
+};
+
+namespace CPUBudget
+{
+	//Reads the affinity mask and the cgroup files every call, the result is cheap enough to not bother caching
+	CPUBudgetInfo Detect();
+	//CPUs in our affinity mask, ascending
+	std::vector<unsigned int> GetAffinityCPUs();
+	//Nodes that contain at least one CPU of the affinity mask, ascending by node number. Always returns at least one node
+	std::vector<NUMANodeInfo> DetectNUMANodes();
+	//Pin the calling thread to a single CPU. Returns false if the platform or the CPU number does not allow it
+	bool PinCurrentThread(unsigned int CPU);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+* Runtime instruction set selection for the hot kernels(sphere intersection, material scatter, frame buffer conversion, 8-wide random numbers)
+* 1. Every kernel is compiled once per ISA inside the same binary using per-function target attributes, the rest of the program stays baseline x86-64
+* 2. The best ISA the CPU(and the OS, for the AVX register state) supports is picked on first use from CPUID
+* 3. RAYTRACER_ISA=scalar|sse4.2|avx2|avx512 in the environment, or SetActiveISA(e.g. from a --isa flag), forces a specific path for A/B benchmarking
+*/
+
+//Compiler glue for the per-ISA kernel variants
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define RAYTRACER_X86_DISPATCH 1
+#define RAYTRACER_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define RAYTRACER_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define RAYTRACER_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#define RAYTRACER_FORCEINLINE inline __attribute__((always_inline))
+#elif defined(_M_X64)
+//MSVC lets us use every intrinsic without /arch, but it can not retarget the compiler's own code generation per function
+#define RAYTRACER_X86_DISPATCH 1
+#define RAYTRACER_TARGET_SSE42
+#define RAYTRACER_TARGET_AVX2
+#define RAYTRACER_TARGET_AVX512
+#define RAYTRACER_FORCEINLINE __forceinline
+#else
+#define RAYTRACER_X86_DISPATCH 0
+#define RAYTRACER_FORCEINLINE inline
+#endif
+
+enum class ISALevel : uint8_t
+{
+	Scalar,
+	SSE42,
+	AVX2,
+	AVX512
+};
+
+namespace CPUDispatch
+{
+	//Highest ISA level the CPU and OS support. Detected once and cached
+	ISALevel GetSupportedISA();
+	//ISA level the kernels are currently using
+	ISALevel GetActiveISA();
+	//Force the kernels onto a specific ISA level. Returns false(and changes nothing) if the CPU does not support it
+	//Call it before building the world, the BVH leaf size depends on the sphere kernel's lane width
+	bool SetActiveISA(ISALevel Level);
+	const char* GetISAName(ISALevel Level);
+	//Accepts scalar, sse4.2, avx2 and avx512(case sensitive)
+	bool ParseISAName(const char* Name, ISALevel& OutLevel);
+}
@@ -1,12 +1,47 @@
 #pragma once
 
 #include "HittableList.h"
+#include "Sampler.h"
+#include "AOVBuffer.h"
+
+/*
+* What a sample's camera ray hit first: the guide the denoiser needs and the source of the AOV planes(see VAOVBuffer)
+* A ray that escapes gets the sky color as albedo, a zero normal, an infinite distance, object id -1 and material AOVMissMaterial
+*/
+struct FirstHitFeatures
+{
+	Color Albedo = Color(0.f, 0.f, 0.f);
+	Vector3D Normal = Vector3D(0.f, 0.f, 0.f);
+	//World space distance from the ray origin to the hit
+	float Distance = Constants::g_Infinity;
+	int32_t ObjectID = -1;
+	uint8_t Material = AOVMissMaterial;
+};
+
+//Where the camera sits and what it looks at, the part of the camera a scene file describes
+struct CameraView
+{
+	Point3D CameraCenter = Point3D(13.f, 2.f, 3.f);
+	Point3D LookAt = Point3D(0.f, 0.f, 0.f);
+	float VerticalFOV = 20.f;
+	float FocusDistance = 10.f;
+	float DefocusAngle = 0.6f;
+};
 
 class Camera
 {
 public:
 	Camera(Point3D InCameraCenter = Point3D(13.f, 2.f, 3.f), float InFocalLength = 1.f, int InSamplePerPixel = 10, float InVerticalFOV = 20.f);
-	Color CalculateHitColor(HittableList& World, Point3D PixelLocation, Vector3D PixelDeltaU, Vector3D PixelDeltaV) const;
+	//PixelIndex(y * width + x) picks the random streams of the pixel's samples
+	Color CalculateHitColor(HittableList& World, Point3D PixelLocation, Vector3D PixelDeltaU, Vector3D PixelDeltaV, uint32_t PixelIndex) const;
+	/*
+	* Trace SampleCount samples through a pixel and return their unclamped sum, for callers that keep their own running average(progressive rendering)
+	* Sample i draws its random numbers from the stream of(seed, PixelIndex, FirstSampleIndex + i), so it does not matter which thread traces it or in which pass
+	* OutLuminanceSquaredSum is optional and receives the sum of every sample's squared luminance, which is what the adaptive sampler needs for the variance
+	* OutFeatureSum is optional and receives the sum of every sample's first-hit albedo and normal, and the distance, object id and material of the first sample
+	*/
+	Color AccumulateSamples(HittableList& World, Point3D PixelLocation, Vector3D PixelDeltaU, Vector3D PixelDeltaV, uint32_t PixelIndex, uint32_t FirstSampleIndex, int SampleCount,
+		float* OutLuminanceSquaredSum = nullptr, FirstHitFeatures* OutFeatureSum = nullptr) const;
 	void SetSampleCount(int InSampleCount)
 	{
 		m_SamplesPerPixel = InSampleCount;
@@ -15,8 +50,32 @@ public:
 	{
 		m_MaxDepth = InMaxDepth;
 	}
+	/*
+	* Russian roulette: from bounce MinDepth on, a path survives each bounce with a probability equal to its brightest throughput channel(clamped to [0.05, 1])
+	* and the survivors are divided by that probability, so dim paths end early without biasing the average. 0 turns it off
+	* The max depth still caps the path, with roulette on it can be set high at little cost
+	*/
+	void SetRouletteMinDepth(int InMinDepth)
+	{
+		m_RouletteMinDepth = InMinDepth;
+	}
+	//Where the pixel jitter, lens and scatter numbers come from. ImageWidth lets the blue-noise sampler find a pixel's x and y from its index
+	void SetSampler(SamplerType InSampler, uint32_t InImageWidth)
+	{
+		m_Sampler = InSampler;
+		m_ImageWidth = InImageWidth;
+	}
+	//Seed of the per-sample random streams, renders with the same seed produce the same pixels
+	void SetSeed(uint64_t InSeed)
+	{
+		m_Seed = InSeed;
+	}
+	//Place the camera and derive its basis and defocus disk. The caller still has to redo anything built from them(e.g. a viewport)
+	void SetView(const CameraView& View);
+	CameraView GetView() const;
 	int GetSampleCount() const { return m_SamplesPerPixel; }
 	int GetMaxDepth() const { return m_MaxDepth; }
+	int GetRouletteMinDepth() const { return m_RouletteMinDepth; }
 
 public:
 	//These variables can be set in the constructor, I just don't want to crowd the constructor with tons of parameters
@@ -39,15 +98,21 @@ public:
 	Vector3D CameraW;
 
 private:
+	//Recompute CameraU/V/W, FocalLength and the defocus disk from the placement fields
+	void UpdateBasis();
 	//Construct a ray going from origin to a random sample point around a particular pixel
 	Ray SendRayToSample(Point3D PixelLocation, Vector3D PixelDeltaU, Vector3D PixelDeltaV) const;
 	//Generate the vector to a random sample inside a unit square(-0.5 to 0.5), the return result is meant to be used as an offset
 	Vector3D SampleSquare() const;
-	//Perform recursive path tracing for all the rays
-	Color PerformPathTrace(const Ray& R, HittableList& World) const;
+	//Perform recursive path tracing for all the rays. OutFeatures is optional and receives what the first ray hit
+	Color PerformPathTrace(const Ray& R, HittableList& World, FirstHitFeatures* OutFeatures = nullptr) const;
 	//Sample a random point in the camera defocus disk
 	Point3D SampleDefocusDisk() const;
 private:;
 	int m_SamplesPerPixel = 10;
 	int m_MaxDepth = 10;
+	int m_RouletteMinDepth = 0;
+	uint64_t m_Seed = 0;
+	SamplerType m_Sampler = SamplerType::Independent;
+	uint32_t m_ImageWidth = 0;
 };
\ No newline at end of file
@@ -1,11 +1,24 @@
 #pragma once
 
 #include "Vector3D.h"
+#include "CPUDispatch.h"
 
 using Color = Vector3D;
 
 //A header that defines color aliasing for Vector3D and its related utilities
 
-void WriteColor(std::ostream& OutFileStream, const Color& PixelColor);
 Color NormalizeColor(const Color& PixelColor);
-float LinearToGamma(const float Componennt);
\ No newline at end of file
+float LinearToGamma(const float Componennt);
+//Rec. 709 luminance of a linear color
+inline float Luminance(const Color& LinearColor)
+{
+	return 0.2126f * LinearColor.R() + 0.7152f * LinearColor.G() + 0.0722f * LinearColor.B();
+}
+
+/*
+* Convert a row of linear colors to B8G8R8A8 frame buffer pixels: clamp to [0, 0.999], gamma correct, scale to 0-255 and set alpha to 255
+* Runs on the ISA picked by CPUDispatch, the SIMD variants do the clamp/sqrt/scale/truncate for several pixels at once
+*/
+void ConvertScanlineToBGRA8(const Color* Linear, unsigned char* OutBGRA, unsigned int Count);
+//Called by CPUDispatch::SetActiveISA
+void SelectColorConversionISA(ISALevel Level);
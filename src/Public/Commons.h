@@ -10,9 +10,9 @@
 #include <iostream>
 #include <memory>
 #include <limits>
-#include <random>
 
 //Custom headers
+#include "Random.h"
 
 
 namespace Constants
@@ -29,11 +29,9 @@ namespace Utility
 	}
 	inline static float RandomFloat()
 	{
-		//thread_local makes the variable "static" to the thread that creates it. So other threads do not interfere.
-		//If we had just marked this as static, we basically get a chaotic race. Not only is the random generator not safe now, we are also slowing things down
-		thread_local std::uniform_real_distribution<float> UniformDist;
-		thread_local std::mt19937 RandomGenerator;
-		return UniformDist(RandomGenerator);
+		//The generator is thread_local, so the workers never share state. It used to be an mt19937, PCG32 is much smaller and faster
+		//Renders reseed it per pixel sample(see VRandom::SeedPixelSample), everything else just keeps drawing from the thread's stream
+		return VRandom::GetThreadGenerator().NextFloat();
 	}
 	//Return a random float in the range [Min, Max), by default uses [0, 1)
 	inline static float RandomFloat(float Min, float Max)
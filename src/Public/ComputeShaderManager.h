@@ -23,6 +23,8 @@ struct GlobalBufferType
 	XMUINT2 ScreenSize;
 	unsigned int Depth;
 	unsigned int SampleCount;
+	unsigned int RouletteMinDepth = 0;
+	unsigned int Padding5[3] = {};
 };
 
 struct SampleOffsetBufferType
@@ -47,7 +49,7 @@ class ComputeShaderManager
 public:
 	ComputeShaderManager(ID3D11Device* Device, ID3D11DeviceContext* DeviceContext, unsigned int ScreenWidth = 1920, unsigned int ScreenHeight = 1080);
 	~ComputeShaderManager();
-	bool InitializeShaders(unsigned int ObjectCount, unsigned int Depth, unsigned int SampleCount);
+	bool InitializeShaders(unsigned int ObjectCount, unsigned int Depth, unsigned int SampleCount, unsigned int RouletteMinDepth = 0);
 	bool SetShaderParams(const XMFLOAT3& CameraPos, const XMFLOAT3& ViewportUpperLeft, const XMFLOAT3& FirstPixelPos, const XMFLOAT3& DeltaU, const XMFLOAT3& DeltaV,
 		const SphereTransformBufferType* SphereTransforms, const SphereMaterialBufferType* SphereMaterials);
 	void DispatchShader();
@@ -79,4 +81,5 @@ private:
 	unsigned int m_Height;
 	unsigned int m_MaxDepth;
 	unsigned int m_SampleCount;
+	unsigned int m_RouletteMinDepth = 0;
 };
\ No newline at end of file
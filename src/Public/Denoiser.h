@@ -0,0 +1,58 @@
+#pragma once
+
+#include "TileScheduler.h"
+#include <cstdint>
+#include <memory>
+
+/*
+* Edge-avoiding a-trous wavelet denoiser(Dammertz et al. 2010) for the linear image, guided by the first-hit albedo and normal
+* 1. The color is divided by the albedo first, so the filter smooths lighting and not texture, and multiplied back at the end
+* 2. Every iteration is a 5x5 B3-spline kernel whose taps are 2^i pixels apart, 5 iterations cover a 61 pixel wide footprint for 125 taps per pixel
+* 3. A tap's weight falls off with its color, normal and albedo distance to the center pixel, so edges between objects and materials stay sharp
+*    The color sigma halves every iteration, the later wide iterations only smooth what the early ones left nearly flat
+* 4. Every step is one VTileScheduler::Run over the frame, a tile only reads the previous step's buffer so the tiles need no locking
+* All planes are three floats per pixel, averages and not sums
+*/
+
+struct DenoiseSettings
+{
+	unsigned int Iterations = 5;
+	/*
+	* Falloffs of the edge stopping weights, exp(-distance^2 / sigma^2)
+	* The color one is in demodulated units(irradiance) at 1 spp, RenderCore divides it by the square root of the sample count and every iteration halves it
+	*/
+	float ColorSigma = 1.f;
+	float NormalSigma = 0.3f;
+	float AlbedoSigma = 0.2f;
+};
+
+class VDenoiser
+{
+public:
+	VDenoiser(unsigned int Width, unsigned int Height);
+
+	//Input planes the caller fills before Denoise
+	float* GetColor() { return m_Color.get(); }
+	float* GetAlbedo() { return m_Albedo.get(); }
+	float* GetNormal() { return m_Normal.get(); }
+	//The denoised linear image, valid after Denoise
+	const float* GetOutput() const { return m_Output.get(); }
+
+	void Denoise(VTileScheduler& Scheduler, unsigned int TileSize, const DenoiseSettings& Settings);
+
+private:
+	void Demodulate(const RenderTile& Tile);
+	void FilterTile(const RenderTile& Tile, const float* Source, float* Destination, unsigned int Step, const DenoiseSettings& Settings, float ColorSigma) const;
+	void Remodulate(const RenderTile& Tile, const float* Source);
+
+private:
+	unsigned int m_Width = 0;
+	unsigned int m_Height = 0;
+	std::unique_ptr<float[]> m_Color;
+	std::unique_ptr<float[]> m_Albedo;
+	std::unique_ptr<float[]> m_Normal;
+	//Demodulated color, the iterations ping-pong between the two
+	std::unique_ptr<float[]> m_Ping;
+	std::unique_ptr<float[]> m_Pong;
+	std::unique_ptr<float[]> m_Output;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Color.h"
+#include "TileScheduler.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+enum class HDRFormat : uint8_t
+{
+	//Little-endian PFM, 32 bit float RGB, rows bottom to top
+	PFM,
+	//Single part tiled OpenEXR, uncompressed half float B, G, R channels, one EXR tile per render tile
+	TiledEXR
+};
+
+/*
+* Streams the linear image to disk tile by tile while the frame renders, so no full float copy of the image has to be kept around for the output
+* 1. Open lays the whole file out up front: header, the EXR tile offset table and chunk headers, and the pixel area sized to the final length
+*    Every pixel therefore has a fixed place in the file, and a freshly opened file already reads as a black image
+* 2. WriteTile converts one finished tile and writes it to its place with positional writes. It is safe to call from every worker at once
+*    with no lock, the only memory it needs is one tile's worth of encoded pixels per thread
+* 3. Writing a tile again(the next progressive pass, the denoised result) just overwrites it, the file always holds the latest image
+* Values go out as they are, linear and unclamped
+*/
+class VHDRTileWriter
+{
+public:
+	VHDRTileWriter() = default;
+	VHDRTileWriter(const VHDRTileWriter&) = delete;
+	VHDRTileWriter& operator=(const VHDRTileWriter&) = delete;
+	~VHDRTileWriter();
+
+	//Create FilePath for a Width x Height image cut into TileSize x TileSize tiles. Returns false and fills OutError if the file can not be created
+	bool Open(const std::string& FilePath, HDRFormat Format, unsigned int Width, unsigned int Height, unsigned int TileSize, std::string* OutError = nullptr);
+	//Write one tile of the Open grid. Pixels points at the tile's top left pixel, RowStride is the distance between its rows in pixels
+	void WriteTile(const RenderTile& Tile, const Color* Pixels, size_t RowStride);
+	//Close the file. Returns false and fills OutError if Open or any tile write failed
+	bool Close(std::string* OutError = nullptr);
+
+	bool IsOpen() const { return m_File >= 0; }
+	uint64_t GetFileSize() const { return m_FileSize; }
+	//.pfm or .exr, case sensitive. Returns false for anything else
+	static bool GetFormatFromPath(const std::string& FilePath, HDRFormat& OutFormat);
+
+private:
+	bool WriteAt(uint64_t Offset, const void* Data, size_t ByteCount);
+	bool LayOutPFM();
+	bool LayOutEXR();
+
+private:
+	std::string m_FilePath;
+	HDRFormat m_Format = HDRFormat::PFM;
+	unsigned int m_Width = 0;
+	unsigned int m_Height = 0;
+	unsigned int m_TileSize = 0;
+	unsigned int m_TilesX = 0;
+	//Where the pixels start: right after the PFM header, or at the first EXR tile chunk
+	uint64_t m_PixelOffset = 0;
+	uint64_t m_FileSize = 0;
+	//File descriptor, or a HANDLE squeezed into it on Windows. -1 when closed
+	intptr_t m_File = -1;
+	std::atomic<bool> m_HasFailed = false;
+};
@@ -16,7 +16,7 @@ class HardwareRenderer
 public:
 	HardwareRenderer(unsigned int Width, unsigned int Height, float AspectRatio);
 	~HardwareRenderer();
-	bool Intialize(HWND hWnd, unsigned int SampleCount, unsigned int MaxDepth);
+	bool Intialize(HWND hWnd, unsigned int SampleCount, unsigned int MaxDepth, unsigned int RouletteMinDepth);
 	void GetShaderBuffers();
 	bool RenderScene();
 	void FillBackBuffer();
@@ -24,7 +24,7 @@ public:
 	const std::wstring& GetRenderTimeString() const { return m_RenderTimeString; }
 
 private:
-	void CreateWorld();
+	void CreateWorld(uint64_t Seed);
 
 private:
 	unsigned int m_Width;
@@ -24,6 +24,8 @@ struct HitRecord
 	bool IsFrontFace;
 	std::shared_ptr<Material> HitMaterial;
 	MaterialType VHitMaterial;
+	//Slot of the hit sphere in the HittableList arrays(BVH order), see HittableList::GetSphereID for the stable id
+	unsigned int SphereIndex;
 };
 
 //Abstract class representing a hittable object in the scene. I do not like the idea of this abstract class, maybe switch to something else later
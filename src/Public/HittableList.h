@@ -2,7 +2,11 @@
 
 #include "Hittable.h"
 #include "Color.h"
+#include "BVH.h"
+#include "AlignedAllocator.h"
 #include <vector>
+#include <memory>
+#include <atomic>
 
 class Material;
 class VMaterial;
@@ -32,12 +36,9 @@ struct MaterialScatterData
 	Color Albedo = Color(0.f, 0.f, 0.f);
 };
 
+//The sphere arrays start empty, callers that know the sphere count up front use HittableList::Reserve instead of growing them one sphere at a time
 struct SphereTransformComponent
 {
-	SphereTransformComponent()
-	{
-		TransformData.reserve(10);
-	}
 	std::vector<SphereTransformData> TransformData;
 };
 
@@ -52,13 +53,31 @@ struct SphereMaterialComponent
 
 struct VSphereMatComponent
 {
-	VSphereMatComponent()
-	{
-		MaterialData.reserve(10);
-		MaterialTypes.reserve(10);
-	}
 	std::vector<MaterialType> MaterialTypes;
 	std::vector<MaterialScatterData> MaterialData;
+	//Order the sphere was added in. BuildBVH reorders the arrays, this keeps the object ids AOVs report stable
+	std::vector<uint32_t> SphereIDs;
+};
+
+//The SoA arrays always keep at least this many padding entries past the last sphere. 16 covers one AVX-512 load starting at any sphere
+inline constexpr unsigned int g_SphereSoAPadding = 16;
+
+/*
+* Structure of arrays copy of SphereTransformData for the SIMD intersection kernels
+* One load fills a register with the same component of 8(AVX2) or 16(AVX-512) spheres, no shuffling needed
+* The padding entries are NaN so they can never report a hit even if a kernel forgets to mask them
+*/
+struct SphereSoAComponent
+{
+	AlignedVector<float> CenterX;
+	AlignedVector<float> CenterY;
+	AlignedVector<float> CenterZ;
+	AlignedVector<float> Radius;
+	unsigned int Count = 0;
+
+	void Append(const Vector3D& Center, float SphereRadius);
+	void Reserve(size_t SphereCount);
+	void Rebuild(const std::vector<SphereTransformData>& Transforms);
 };
 
 struct SphereObjectData
@@ -67,6 +86,14 @@ struct SphereObjectData
 	float Radius;
 };
 
+//Per-ray traversal counters, only collected when asked for so the atomics stay out of normal renders
+struct TraversalStats
+{
+	unsigned long long Rays = 0;
+	unsigned long long NodesVisited = 0;
+	unsigned long long SphereTests = 0;
+};
+
 class HittableList : public Hittable
 {
 public:
@@ -80,17 +107,54 @@ public:
 	void Clear();
 	void Add(std::shared_ptr<Hittable> Object);
 	void VAddSphere(const SphereObjectData& Data, const MaterialScatterData& MatData, MaterialType MatType);
+	/*
+	* Append Count spheres in one go, one bulk copy per component array. SphereIDs is optional, without it the spheres are numbered in add order
+	* Like VAddSphere this drops a built BVH
+	*/
+	void VAddSpheres(const SphereTransformData* Transforms, const MaterialScatterData* MatData, const MaterialType* MatTypes, size_t Count, const uint32_t* SphereIDs = nullptr);
+	//Make room for SphereCount spheres in total so adding them never reallocates
+	void Reserve(size_t SphereCount);
+	//Build the SAH BVH over the sphere arrays. This reorders the sphere arrays so each BVH leaf is a contiguous range
+	//Adding a sphere afterwards drops the BVH and VBulkHit falls back to the linear loop
+	void BuildBVH();
+	/*
+	* Deep copy of the sphere arrays, the BVH and the materials, meant for a per-NUMA-node replica of the scene
+	* Call it from a thread running on the target node so first touch places the copy's pages there
+	* The traversal counters start at zero, the compute shader buffers are not copied
+	*/
+	std::unique_ptr<HittableList> CloneSceneData() const;
+	/*
+	* Use a hierarchy built earlier over spheres that are already in its order(see SphereBVH::Assign) instead of BuildBVH
+	* Returns false and keeps the linear loop if the nodes do not fit the spheres
+	*/
+	bool AssignBVH(const BVHNode* Nodes, unsigned int NodeCount);
+	const SphereBVH& GetBVH() const { return m_BVH; }
+	//The component arrays in their current(BVH if built) order, e.g. for saving the scene
+	const std::vector<SphereTransformData>& GetSphereTransforms() const { return m_SphereTransforms.TransformData; }
+	const VSphereMatComponent& GetSphereMaterialData() const { return m_VSphereMatComponent; }
+	const SphereSoAComponent& GetSphereSoA() const { return m_SphereSoA; }
+	void SetCollectTraversalStats(bool ShouldCollect) { m_ShouldCollectStats = ShouldCollect; }
+	TraversalStats GetTraversalStats() const;
+	void ResetTraversalStats();
 	SphereTransformBufferType* GetCSTransformBuffer();
 	SphereMaterialBufferType* GetCSMaterialBuffer();
 	unsigned int GetNumObjects() const { return m_NumObjects; }
+	//Add order of the sphere in slot SphereIndex(HitRecord::SphereIndex)
+	uint32_t GetSphereID(unsigned int SphereIndex) const { return m_VSphereMatComponent.SphereIDs[SphereIndex]; }
 public:
 	
 private:
 	std::vector<std::shared_ptr<Hittable>> m_Objects;
 	SphereTransformComponent m_SphereTransforms;
+	SphereSoAComponent m_SphereSoA;
 	SphereMaterialComponent m_SphereMaterials;
 	SphereTransformBufferType* m_CSTransformBuffer;
 	SphereMaterialBufferType* m_CSMaterialBuffer;
 	VSphereMatComponent m_VSphereMatComponent;
 	unsigned int m_NumObjects = 0;
+	SphereBVH m_BVH;
+	bool m_ShouldCollectStats = false;
+	std::atomic<unsigned long long> m_StatRays = 0;
+	std::atomic<unsigned long long> m_StatNodesVisited = 0;
+	std::atomic<unsigned long long> m_StatSphereTests = 0;
 };
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+class VAOVBuffer;
+
+/*
+* Helpers to get a rendered frame out to disk when there is no window to present it to
+* The frame buffer layout is the same B8G8R8A8 one the D2D1 bitmap uses
+*/
+namespace ImageWriter
+{
+	//Write a binary(P6) PPM. Returns false if the file can not be opened or written
+	bool WritePPM(const std::string& FilePath, const unsigned char* FrameBuffer, unsigned int Width, unsigned int Height);
+	//Write per-pixel sample counts as a PPM heatmap, black(0) through blue and green to red(MaxCount) so adaptive sampling savings can be checked by eye
+	bool WriteSampleHeatmapPPM(const std::string& FilePath, const uint32_t* SampleCounts, unsigned int Width, unsigned int Height, uint32_t MaxCount);
+	/*
+	* Write a little-endian PFM from ChannelCount(1 or 3) planar float planes, top row first like the frame buffer. PFM stores rows bottom to top, the writer flips them
+	* Values go out as they are, no clamping or gamma, so depth and normals survive
+	*/
+	bool WritePFM(const std::string& FilePath, const float* const* Planes, unsigned int ChannelCount, unsigned int Width, unsigned int Height);
+	/*
+	* Write every plane the AOV buffer holds next to the beauty image: <BasePath stem>.<plane name>.pfm
+	* Object id and material go out as single channel floats, exact up to 2^24. Returns false if any file fails, the others are still written
+	*/
+	bool WriteAOVs(const std::string& BasePath, const VAOVBuffer& AOVs);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+/*
+* Bounded lock-free multi-producer multi-consumer queue. This is Dmitry Vyukov's array queue: https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+* 1. Every cell carries a sequence number that tells producers and consumers whose turn it is, so a push or pop is one CAS on the shared position plus a store to the cell
+* 2. The capacity is rounded up to a power of two so wrapping is a mask
+* 3. TryPush/TryPop never block, the caller decides whether to spin, yield or give up when the queue is full/empty
+*/
+template<typename T>
+class VMPMCQueue
+{
+public:
+	explicit VMPMCQueue(size_t Capacity);
+	VMPMCQueue(const VMPMCQueue&) = delete;
+	VMPMCQueue& operator=(const VMPMCQueue&) = delete;
+
+	//Returns false if the queue is full, Value is left untouched in that case
+	bool TryPush(T&& Value);
+	//Returns false if the queue is empty
+	bool TryPop(T& OutValue);
+	size_t GetCapacity() const { return m_Mask + 1; }
+
+private:
+	//One cell per cache line, so a producer filling a cell does not invalidate the line a consumer is reading next door
+	struct alignas(64) Cell
+	{
+		std::atomic<size_t> Sequence;
+		T Value;
+	};
+
+	std::unique_ptr<Cell[]> m_Cells;
+	size_t m_Mask = 0;
+	//Producers and consumers hammer different counters, keep them on separate cache lines
+	alignas(64) std::atomic<size_t> m_EnqueuePosition = 0;
+	alignas(64) std::atomic<size_t> m_DequeuePosition = 0;
+};
+
+template<typename T>
+inline VMPMCQueue<T>::VMPMCQueue(size_t Capacity)
+{
+	size_t RoundedCapacity = 2;
+	while (RoundedCapacity < Capacity)
+	{
+		RoundedCapacity <<= 1;
+	}
+	m_Cells = std::make_unique<Cell[]>(RoundedCapacity);
+	m_Mask = RoundedCapacity - 1;
+	for (size_t i = 0; i < RoundedCapacity; i++)
+	{
+		m_Cells[i].Sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+template<typename T>
+inline bool VMPMCQueue<T>::TryPush(T&& Value)
+{
+	size_t Position = m_EnqueuePosition.load(std::memory_order_relaxed);
+	while (true)
+	{
+		Cell& Target = m_Cells[Position & m_Mask];
+		const size_t Sequence = Target.Sequence.load(std::memory_order_acquire);
+		const intptr_t Difference = (intptr_t)Sequence - (intptr_t)Position;
+		if (Difference == 0)
+		{
+			//The cell is free for this lap, claim the position. On failure Position is reloaded and we try again
+			if (m_EnqueuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+			{
+				Target.Value = std::move(Value);
+				Target.Sequence.store(Position + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (Difference < 0)
+		{
+			//The consumer of the previous lap has not emptied this cell yet, so the queue is full
+			return false;
+		}
+		else
+		{
+			Position = m_EnqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+template<typename T>
+inline bool VMPMCQueue<T>::TryPop(T& OutValue)
+{
+	size_t Position = m_DequeuePosition.load(std::memory_order_relaxed);
+	while (true)
+	{
+		Cell& Target = m_Cells[Position & m_Mask];
+		const size_t Sequence = Target.Sequence.load(std::memory_order_acquire);
+		const intptr_t Difference = (intptr_t)Sequence - (intptr_t)(Position + 1);
+		if (Difference == 0)
+		{
+			if (m_DequeuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+			{
+				OutValue = std::move(Target.Value);
+				//Hand the cell to the producer of the next lap
+				Target.Sequence.store(Position + m_Mask + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (Difference < 0)
+		{
+			return false;
+		}
+		else
+		{
+			Position = m_DequeuePosition.load(std::memory_order_relaxed);
+		}
+	}
+}
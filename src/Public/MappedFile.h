@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//Read-only memory map of a whole file, unmapped when it goes out of scope. Used by the scene loaders to read large files without a copy into a read buffer
+class VMappedFile
+{
+public:
+	VMappedFile() = default;
+	VMappedFile(const VMappedFile&) = delete;
+	VMappedFile& operator=(const VMappedFile&) = delete;
+	~VMappedFile();
+
+	//Map FilePath, hinting the kernel that it will be read front to back. Returns false if it can not be opened or is empty
+	bool Open(const std::string& FilePath);
+	const unsigned char* GetData() const { return m_Data; }
+	size_t GetSize() const { return m_Size; }
+
+private:
+	const unsigned char* m_Data = nullptr;
+	size_t m_Size = 0;
+};
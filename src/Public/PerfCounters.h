@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*
+* Hardware performance counters of the calling thread, read through perf_event_open on Linux
+* 1. The counters are opened as one group, so cycles, instructions and the miss counts all cover the same window even when the kernel multiplexes them
+* 2. Counters the CPU or the kernel does not offer(backend stalls are missing on many CPUs, VMs often expose none) are skipped, the rest still count
+* 3. Opening fails cleanly when perf_event_paranoid or a container forbids it, the caller gets the reason and renders without counters
+* Elsewhere than Linux Open always fails
+*/
+
+enum class PerfCounter : uint8_t
+{
+	Cycles,
+	Instructions,
+	CacheMisses,
+	BranchMisses,
+	BackendStalls,
+	Count
+};
+
+struct PerfCounterValues
+{
+	uint64_t Values[(size_t)PerfCounter::Count] = {};
+	//One bit per PerfCounter that was actually counted
+	uint32_t ValidMask = 0;
+
+	bool Has(PerfCounter Counter) const
+	{
+		return (ValidMask & (1u << (unsigned int)Counter)) != 0;
+	}
+	uint64_t Get(PerfCounter Counter) const
+	{
+		return Values[(size_t)Counter];
+	}
+	bool IsEmpty() const
+	{
+		return ValidMask == 0;
+	}
+	void Add(const PerfCounterValues& Other)
+	{
+		for (size_t i = 0; i < (size_t)PerfCounter::Count; i++)
+		{
+			Values[i] += Other.Values[i];
+		}
+		ValidMask |= Other.ValidMask;
+	}
+	//Counts between two reads of the same group
+	static PerfCounterValues Delta(const PerfCounterValues& End, const PerfCounterValues& Start)
+	{
+		PerfCounterValues Result;
+		for (size_t i = 0; i < (size_t)PerfCounter::Count; i++)
+		{
+			Result.Values[i] = End.Values[i] > Start.Values[i] ? End.Values[i] - Start.Values[i] : 0;
+		}
+		Result.ValidMask = End.ValidMask & Start.ValidMask;
+		return Result;
+	}
+};
+
+class VPerfCounterGroup
+{
+public:
+	VPerfCounterGroup() = default;
+	~VPerfCounterGroup();
+	VPerfCounterGroup(const VPerfCounterGroup&) = delete;
+	VPerfCounterGroup& operator=(const VPerfCounterGroup&) = delete;
+
+	//Start counting the calling thread(user space only). Returns false if not a single counter could be opened, OutError says why
+	bool Open(std::string* OutError = nullptr);
+	bool IsOpen() const
+	{
+		return m_LeaderFd >= 0;
+	}
+	//Counts since Open, scaled up by enabled/running time if the group was multiplexed. Empty if the group is not open
+	PerfCounterValues Read() const;
+
+	static const char* GetCounterName(PerfCounter Counter);
+
+private:
+	int m_LeaderFd = -1;
+	int m_Fds[(size_t)PerfCounter::Count] = { -1, -1, -1, -1, -1 };
+	//Which counter each value of a group read belongs to, in the order they joined the group
+	PerfCounter m_ReadOrder[(size_t)PerfCounter::Count] = {};
+	unsigned int m_OpenCount = 0;
+};
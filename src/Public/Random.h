@@ -0,0 +1,102 @@
+#pragma once
+
+#include "CPUDispatch.h"
+#include <cstdint>
+
+/*
+* Small-state random numbers for the path tracer
+* 1. VRandom is PCG32(XSH-RR output, 64-bit LCG state, 64-bit stream selector). 16 bytes of state instead of mt19937's 2.5 KB, and a handful of instructions per number
+* 2. The renderer reseeds the calling thread's generator from(pixel index, sample index) before every sample, so a sample draws the same numbers
+*    whichever worker ends up tracing it, and no two workers walk the same sequence
+* 3. VRandom8 runs 8 decorrelated lanes of the PCG-RXS-M-XS generator the compute shader's PCGHash is built on, so a whole AVX2 register of floats comes out per call
+*/
+class VRandom
+{
+public:
+	constexpr VRandom() = default;
+	constexpr VRandom(uint64_t Seed, uint64_t Stream = 0)
+	{
+		Reseed(Seed, Stream);
+	}
+
+	//The PCG reference seeding: pick the stream, then mix the seed into the state with two steps
+	constexpr void Reseed(uint64_t Seed, uint64_t Stream = 0)
+	{
+		m_State = 0;
+		m_Increment = (Stream << 1u) | 1u;
+		NextUInt();
+		m_State += Seed;
+		NextUInt();
+	}
+	constexpr uint32_t NextUInt()
+	{
+		const uint64_t OldState = m_State;
+		m_State = OldState * 6364136223846793005ull + m_Increment;
+		const uint32_t XorShifted = (uint32_t)(((OldState >> 18u) ^ OldState) >> 27u);
+		const uint32_t Rotation = (uint32_t)(OldState >> 59u);
+		return (XorShifted >> Rotation) | (XorShifted << ((0u - Rotation) & 31u));
+	}
+	//[0, 1). Only the top 24 bits are used so every result is exactly representable and 1.0 can never come out
+	constexpr float NextFloat()
+	{
+		return (float)(NextUInt() >> 8u) * (1.f / 16777216.f);
+	}
+
+	//SplitMix64 finalizer, spreads nearby inputs(neighbouring pixels, consecutive samples) over the whole seed space
+	static constexpr uint64_t MixSeed(uint64_t Value)
+	{
+		Value = (Value ^ (Value >> 30u)) * 0xbf58476d1ce4e5b9ull;
+		Value = (Value ^ (Value >> 27u)) * 0x94d049bb133111ebull;
+		return Value ^ (Value >> 31u);
+	}
+
+	//The generator behind Utility::RandomFloat on the calling thread. Trivially constructible, so the thread_local needs no init guard
+	static VRandom& GetThreadGenerator()
+	{
+		thread_local VRandom Generator;
+		return Generator;
+	}
+	/*
+	* Start the calling thread's generator on the stream of one pixel sample. Same(Seed, pixel, sample), same numbers, whatever thread or pass traces it
+	* Pixel samples use the even streams of a seed and scene generation the odd one, so the two never draw the same sequence
+	* The seed is mixed before the stream is derived from it, shifting the raw seed would drop its top bit and make Seed and Seed ^ 2^63 render the same image
+	* The mixed seed also goes into the state, so every seed bit counts. MixSeed(0) is 0, which keeps the default seed's numbers what they always were
+	*/
+	static void SeedPixelSample(uint32_t PixelIndex, uint32_t SampleIndex, uint64_t Seed = 0)
+	{
+		const uint64_t MixedSeed = MixSeed(Seed);
+		GetThreadGenerator().Reseed(MixSeed(((uint64_t)PixelIndex << 32u) | SampleIndex) ^ MixedSeed, MixedSeed << 1u);
+	}
+	//Start the calling thread's generator for building a scene from Seed
+	static void SeedSceneGeneration(uint64_t Seed)
+	{
+		const uint64_t MixedSeed = MixSeed(Seed);
+		GetThreadGenerator().Reseed(MixedSeed, (MixedSeed << 1u) | 1u);
+	}
+
+private:
+	//The PCG reference defaults, so an unseeded generator is still a valid stream
+	uint64_t m_State = 0x853c49e6748fea9bull;
+	uint64_t m_Increment = 0xda3e39cb94b95bdbull;
+};
+
+class alignas(32) VRandom8
+{
+public:
+	/*
+	* Lane i starts from MixSeed(Seed * 8 + i). Every lane walks the same 2^32 long LCG cycle, the hash only scatters the starting points over it
+	* 8 lanes are then on average 2^29 draws apart, so a lane runs into another lane's(or another generator's) numbers after about that many draws
+	* There is no minimum distance, two starting points can land close together. Fine for benchmarks and noise, not for long independent streams
+	*/
+	explicit VRandom8(uint64_t Seed = 0);
+
+	//Write 8 floats in [0, 1) to Out, one per lane
+	void NextFloat8(float* Out);
+
+	//Called by CPUDispatch::SetActiveISA. AVX2 and up get the vector kernel, everything else the scalar loop
+	static void SelectISA(ISALevel Level);
+	static const char* GetKernelName();
+
+private:
+	uint32_t m_Lanes[8];
+};
@@ -0,0 +1,234 @@
+#pragma once
+
+#include "Camera.h"
+#include "TileScheduler.h"
+#include "RenderStats.h"
+#include "PerfCounters.h"
+#include "Denoiser.h"
+#include "AOVBuffer.h"
+#include "SceneText.h"
+#include "HDRTileWriter.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+/*
+* The platform-neutral half of the software renderer. It owns the camera, the world, the thread pool and the B8G8R8A8 frame buffer
+* It knows nothing about windows, so the Win32 SoftwareRenderer and the headless executable can both drive it
+*/
+
+//Handed to the progressive pass callback once a pass has been accumulated and the frame buffer holds its snapshot
+struct ProgressivePass
+{
+	//Zero based
+	unsigned int PassIndex = 0;
+	unsigned int PassCount = 0;
+	//Samples per pixel accumulated so far, including this pass. With adaptive sampling this is the most any pixel got
+	unsigned int SamplesSoFar = 0;
+	//Pixels that still take samples after this pass, only counted with adaptive sampling
+	unsigned long long ActivePixels = 0;
+	//Time since the render started, in milliseconds
+	double ElapsedMs = 0.0;
+	//Tonemapped B8G8R8A8 snapshot, valid until the next pass starts
+	const unsigned char* Snapshot = nullptr;
+};
+
+//Hardware counters of the last render, see RenderSettings::CollectPerfCounters
+struct RenderPerfCounters
+{
+	//On the calling thread
+	PerfCounterValues CreateWorld;
+	PerfCounterValues BuildBVH;
+	//Summed over the tiles every worker traced
+	PerfCounterValues Trace;
+	std::vector<PerfCounterValues> Workers;
+	//Why the counters are missing, empty if the calling thread got its counters. Workers run in the same process and get theirs alike
+	std::string Error;
+};
+
+//Packing the render settings into a struct so we can pass them around instead of growing the Initialize parameter list
+struct RenderSettings
+{
+	unsigned int Width = 1280;
+	unsigned int Height = 720;
+	unsigned int SampleCount = 10;
+	unsigned int MaxDepth = 10;
+	//Russian roulette from this bounce on(see Camera::SetRouletteMinDepth), 0 keeps the plain MaxDepth cutoff
+	unsigned int RouletteMinDepth = 0;
+	//0 lets the thread pool size itself from the CPU budget(affinity mask, cgroup quota), anything else is used as is
+	size_t ThreadCount = 0;
+	//Trace against the SAH BVH instead of testing every sphere. Turn it off to compare against the linear loop
+	bool UseBVH = true;
+	//Count rays, BVH node visits and ray-sphere tests. Costs a few atomics per ray so it is off by default
+	bool CollectTraversalStats = false;
+	//Read cycles, instructions, cache and branch misses and backend stalls around every render phase and tile(Linux perf_event_open). Off by default, it costs two syscalls per tile
+	bool CollectPerfCounters = false;
+	//Edge length of the square tiles the work-stealing scheduler hands out, in pixels
+	unsigned int TileSize = 32;
+	//Worker pinning. ThreadPlacement::NUMANodes also gives every node its own band of the frame buffer(first-touched by that node) and its own copy of the scene
+	ThreadPlacement Placement = ThreadPlacement::None;
+	//Only use the first NUMANodeLimit nodes, 0 for all. Only meaningful with a placement other than None
+	unsigned int NUMANodeLimit = 0;
+	/*
+	* Progressive rendering: trace SampleCount in passes of this many samples into a float accumulation buffer, refreshing the frame buffer after every pass
+	* 0 renders all samples in one go without the accumulation buffer
+	*/
+	unsigned int ProgressivePassSamples = 0;
+	/*
+	* Adaptive sampling, off at 0. A pixel stops taking samples once the standard error of its mean luminance falls below AdaptiveThreshold times that mean
+	* It runs on the progressive passes(4 samples per pass unless ProgressivePassSamples says otherwise). Pixels get at least AdaptiveMinSamples
+	* and at most AdaptiveMaxSamples(0 means SampleCount), so the time saved on converged pixels can go to the noisy ones
+	*/
+	float AdaptiveThreshold = 0.f;
+	unsigned int AdaptiveMinSamples = 8;
+	unsigned int AdaptiveMaxSamples = 0;
+	/*
+	* Seed for both the scene layout and the per-sample random streams. Every sample derives its stream from(Seed, pixel, sample index)
+	* so the same settings give bit-identical pixels whatever the thread count, tile order or NUMA placement. Only a different ISA(see CPUDispatch) may round differently
+	*/
+	uint64_t Seed = 0;
+	//Pixel jitter, lens and scatter numbers, see SamplerType
+	SamplerType Sampler = SamplerType::Sobol;
+	/*
+	* Run the a-trous denoiser(see VDenoiser) over the finished image and put its result in the frame buffer. The first-hit albedo and normal it is guided by
+	* are gathered while tracing, a few adds per sample. Progressive pass snapshots stay noisy, only the final image is denoised
+	*/
+	bool Denoise = false;
+	DenoiseSettings DenoiserSettings;
+	//AOVPlane bits of the extra planes to fill from the camera rays' first hits(see VAOVBuffer), 0 for none. Like Denoise it keeps the linear sums
+	uint32_t AOVs = 0;
+	//Denser variants of the demo scene for benchmarking: every grid cell holds SceneDensity x SceneDensity spheres, roughly 484 * SceneDensity^2 in total
+	unsigned int SceneDensity = 1;
+};
+
+class RenderCore
+{
+public:
+	RenderCore(const RenderSettings& Settings);
+	bool Initialize();
+	//Builds the hard-coded demo scene, its layout only depends on Seed. RenderFrameBuffer calls this with RenderSettings::Seed if no world has been created yet
+	void CreateWorld(uint64_t Seed);
+	/*
+	* Replace the world, and the camera if the file places one, with a binary(see SceneFile) or text(see SceneText) scene, told apart by the binary magic
+	* A binary scene's stored BVH is used when RenderSettings::UseBVH is on, so RenderFrameBuffer skips the build. Text scenes are parsed on the thread pool
+	* OutTextStats is optional and receives the parse figures of a text scene. Returns false and keeps the current world if the file can not be loaded
+	*/
+	bool LoadWorld(const std::string& FilePath, std::string* OutError = nullptr, SceneTextStats* OutTextStats = nullptr);
+	//Write the world and the camera as a binary scene file, creating the world and building its BVH first if that has not happened yet, so the file loads ready to trace
+	bool SaveWorld(const std::string& FilePath, std::string* OutError = nullptr);
+	/*
+	* Render the whole frame into the frame buffer
+	* OnTileDone is optional, it is called on the calling thread every time a tile is finished. Return false from it to cancel the tiles that have not started
+	* In progressive mode OnPassDone is called on the calling thread after every pass, with the frame buffer holding the snapshot. Return false from it to stop
+	* Returns false if the render was stopped early. A pass stopped from OnTileDone leaves the frame buffer with whichever tiles finished
+	*/
+	bool RenderFrameBuffer(const VTileScheduler::TileDoneFunc& OnTileDone = nullptr, const std::function<bool(const ProgressivePass&)>& OnPassDone = nullptr);
+	/*
+	* Stream the linear image of the following renders to FilePath(.pfm or .exr, see VHDRTileWriter) tile by tile, straight from the workers as they finish each tile
+	* Every progressive pass rewrites its tiles and a denoised frame replaces them once more, so the file always matches the frame buffer. Call it after Initialize
+	* Returns false and fills OutError if the extension is unknown or the file can not be created
+	*/
+	bool OpenHDROutput(const std::string& FilePath, std::string* OutError = nullptr);
+	//Finish the HDR file. Returns false and fills OutError if any write failed
+	bool CloseHDROutput(std::string* OutError = nullptr);
+
+	const unsigned char* GetFrameBuffer() const { return m_FrameBuffer; }
+	unsigned char* GetFrameBuffer() { return m_FrameBuffer; }
+	unsigned int GetWidth() const { return m_Settings.Width; }
+	unsigned int GetHeight() const { return m_Settings.Height; }
+	const RenderSettings& GetSettings() const { return m_Settings; }
+	//Move the camera, e.g. to where a scene file put it. Call it between frames, after Initialize
+	void SetCameraView(const CameraView& View);
+	CameraView GetCameraView() const { return m_Camera.GetView(); }
+	const HittableList* GetWorld() const { return m_World.get(); }
+	const VThreadPool* GetThreadPool() const { return m_ThreadPool.get(); }
+	//Traversal counters of the last render, summed over the per-node scene copies
+	TraversalStats GetTraversalStats() const;
+	//Path statistics of the last render, merged over every worker and pass. All zero in a RAYTRACER_RENDER_STATS=OFF build
+	const RenderStats& GetRenderStats() const { return m_RenderStats; }
+	const RenderPerfCounters& GetPerfCounters() const { return m_PerfCounters; }
+	//Duration of the last RenderFrameBuffer call in milliseconds, world creation not included
+	long long int GetLastRenderTime() const { return m_LastRenderTimeNs / 1000000; }
+	long long int GetLastRenderTimeUs() const { return m_LastRenderTimeNs / 1000; }
+	/*
+	* Linear RGB sums, three floats per pixel. Only allocated in progressive mode(and with adaptive sampling, the denoiser or AOVs)
+	* Divide by GetAccumulatedSamples for the average, or with adaptive sampling by the pixel's own GetSampleCounts()[i]
+	*/
+	const float* GetAccumulationBuffer() const { return m_Accumulation.get(); }
+	unsigned int GetAccumulatedSamples() const { return m_AccumulatedSamples; }
+	//Linear denoised image of the last render, three floats per pixel. Only there with RenderSettings::Denoise
+	const float* GetDenoisedBuffer() const { return m_Denoiser ? m_Denoiser->GetOutput() : nullptr; }
+	//Duration of the last render's denoise step in milliseconds, 0 without RenderSettings::Denoise
+	double GetLastDenoiseTime() const { return m_LastDenoiseTimeNs / 1e6; }
+	//First-hit planes of the last render, empty without RenderSettings::AOVs. Complete once RenderFrameBuffer returns true
+	const VAOVBuffer& GetAOVs() const { return m_AOVs; }
+	//Samples every pixel took in the last render, only allocated with adaptive sampling
+	const uint32_t* GetSampleCounts() const { return m_SampleCounts.get(); }
+	//Time from the start of the last render until the first pass snapshot was ready, in milliseconds
+	double GetTimeToFirstImage() const { return m_TimeToFirstImage; }
+	//Busy/idle time and tile counts of every worker during the last render
+	const std::vector<TileWorkerStats>& GetWorkerStats() const { return m_TileScheduler->GetWorkerStats(); }
+
+	~RenderCore();
+
+private:
+	//Viewport vectors and pixel deltas from the camera basis and the frame size
+	void UpdateViewport();
+	//The scene the calling worker should trace against: its node's copy when the pool is split over NUMA nodes, the shared world otherwise
+	HittableList& GetWorkerWorld(unsigned int WorkerIndex);
+	//Trace PassSamples samples for every pixel of the tile and refresh its frame buffer pixels. SamplesBefore is what the accumulation buffer already holds
+	void TraceTile(const RenderTile& Tile, unsigned int WorkerIndex, unsigned int PassSamples, unsigned int SamplesBefore);
+	//Adaptive version of one pixel of TraceTile, returns the pixel's current average
+	Color TraceAdaptivePixel(HittableList& World, const Point3D& PixelPos, size_t PixelIndex, unsigned int PassSamples, bool IsFirstPass, unsigned int& InOutActivePixels);
+	//Add a pixel's first-hit features to the running sums, or start them over on the first pass, which also fills the point-sampled AOV planes
+	void AccumulateFeatures(size_t PixelIndex, const FirstHitFeatures& Features, bool ShouldOverwrite);
+	//Average the albedo and normal sums into their AOV planes
+	void ResolveAOVs();
+	//Average the sums into the denoiser's inputs, denoise, and convert the result into the frame buffer
+	void DenoiseFrame();
+	//Zero a buffer with BytesPerPixel bytes per pixel, band by band on the node that will render it
+	void FirstTouch(void* Buffer, size_t BytesPerPixel);
+
+private:
+	RenderSettings m_Settings;
+	float m_ViewportWidth = 0.f;
+	float m_ViewportHeight = 0.f;
+	Vector3D m_ViewportU;
+	Vector3D m_ViewportV;
+	Vector3D m_DeltaU;
+	Vector3D m_DeltaV;
+	Camera m_Camera;
+	std::unique_ptr<HittableList> m_World;
+	//Per-node copies of m_World, made lazily each frame by the first worker of the node that needs one
+	std::vector<std::unique_ptr<HittableList>> m_NodeWorlds;
+	std::unique_ptr<std::once_flag[]> m_NodeWorldFlags;
+	//One slot per worker, each only written by its own worker after every tile, so the slots need no locking
+	std::vector<RenderStats> m_WorkerRenderStats;
+	RenderStats m_RenderStats;
+	RenderPerfCounters m_PerfCounters;
+	unsigned char* m_FrameBuffer;
+	std::unique_ptr<float[]> m_Accumulation;
+	//Adaptive sampling state: per-pixel sum of squared sample luminance, sample count and whether the pixel has converged
+	std::unique_ptr<float[]> m_LuminanceSquared;
+	std::unique_ptr<uint32_t[]> m_SampleCounts;
+	std::unique_ptr<uint8_t[]> m_Converged;
+	//Denoiser state: first-hit albedo and normal sums, three floats per pixel like m_Accumulation
+	std::unique_ptr<float[]> m_AlbedoSum;
+	std::unique_ptr<float[]> m_NormalSum;
+	std::unique_ptr<VDenoiser> m_Denoiser;
+	VAOVBuffer m_AOVs;
+	//HDR output, with one tile of linear pixels per worker to gather a tile in before it is written
+	std::unique_ptr<VHDRTileWriter> m_HDRWriter;
+	std::vector<std::vector<Color>> m_HDRTiles;
+	//The denoiser or an AOV plane wants FirstHitFeatures from the tracer
+	bool m_ShouldCollectFeatures = false;
+	long long int m_LastDenoiseTimeNs = 0;
+	std::atomic<unsigned long long> m_ActivePixels = 0;
+	unsigned int m_AccumulatedSamples = 0;
+	double m_TimeToFirstImage = 0.0;
+	Point3D m_FirstPixelPos;
+	std::unique_ptr<VThreadPool> m_ThreadPool;
+	std::unique_ptr<VTileScheduler> m_TileScheduler;
+	//Duration of the last render's "Trace" profiler zone
+	long long int m_LastRenderTimeNs = 0;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+* Per-render path statistics: rays per bounce depth, ray-sphere tests, hits per material, how paths end and how long they get
+* 1. The hot paths(Camera::PerformPathTrace, HittableList::VBulkHit, VMaterial::DispatchScatter) bump plain counters in a thread_local RenderStats, no atomics
+* 2. RenderCore folds a worker's thread_local counters into that worker's slot after every tile and sums the slots once the frame is done
+* 3. Build with RAYTRACER_RENDER_STATS=OFF and RAYTRACER_STAT expands to nothing, so the counters do not exist in the hot paths at all
+*/
+
+#ifndef RAYTRACER_RENDER_STATS
+#define RAYTRACER_RENDER_STATS 1
+#endif
+
+#if RAYTRACER_RENDER_STATS
+#define RAYTRACER_STAT(Statement) do { Statement; } while (0)
+#else
+#define RAYTRACER_STAT(Statement) do { } while (0)
+#endif
+
+//Depths past this share the last bucket. Deeper than the dialog's largest max depth option
+inline constexpr unsigned int g_StatsMaxDepth = 64;
+//One counter per MaterialType
+inline constexpr unsigned int g_StatsMaterialCount = 3;
+
+struct RenderStats
+{
+	//Rays cast at each bounce depth, 0 is the camera ray
+	uint64_t RaysPerDepth[g_StatsMaxDepth + 1] = {};
+	uint64_t SphereTests = 0;
+	//Indexed by MaterialType
+	uint64_t HitsPerMaterial[g_StatsMaterialCount] = {};
+	//How the paths ended: still bouncing at the camera's max depth, ended by Russian roulette, absorbed by a material, or escaped to the sky
+	uint64_t PathsKilledByDepth = 0;
+	uint64_t PathsKilledByRoulette = 0;
+	uint64_t PathsAbsorbed = 0;
+	uint64_t PathsEscaped = 0;
+	//Paths by the number of rays they cast
+	uint64_t PathLengths[g_StatsMaxDepth + 1] = {};
+
+	static constexpr bool IsCompiledIn()
+	{
+		return RAYTRACER_RENDER_STATS != 0;
+	}
+	//The calling thread's counters
+	static RenderStats& Local()
+	{
+		thread_local RenderStats Stats;
+		return Stats;
+	}
+	static constexpr unsigned int DepthBucket(unsigned int Depth)
+	{
+		return Depth < g_StatsMaxDepth ? Depth : g_StatsMaxDepth;
+	}
+
+	void Merge(const RenderStats& Other);
+	void Reset()
+	{
+		*this = RenderStats();
+	}
+	uint64_t GetTotalRays() const;
+	uint64_t GetPathCount() const
+	{
+		return PathsKilledByDepth + PathsKilledByRoulette + PathsAbsorbed + PathsEscaped;
+	}
+	//Smallest path length that covers at least Fraction of all paths, the histogram's answer to "how deep do paths actually go"
+	unsigned int GetPathLengthPercentile(double Fraction) const;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Vector3D.h"
+#include <cstdint>
+
+/*
+* Where the path tracer's random numbers come from
+* 1. Every draw names its dimension: the camera owns the first four(pixel jitter, lens), then every bounce gets a fixed block of four
+*    so a bounce always reads the same dimensions whatever the materials before it did
+* 2. Independent is plain PCG32(see VRandom), the other samplers are low-discrepancy points indexed by(pixel, sample, dimension)
+*    a pixel's first N samples cover each 2D dimension pair far more evenly than N independent points, which is what buys the same noise for fewer samples
+* 3. Higher dimensions are padded: every pair of dimensions gets its own randomization of the same 2D sequence, decorrelated by hashing(pixel, pair, seed)
+* 4. The state is thread_local and BeginSample resets it, like VRandom::SeedPixelSample, so results do not depend on which worker traces a sample
+*/
+
+enum class SamplerType : uint8_t
+{
+	//Independent uniform numbers from the thread's PCG32 stream
+	Independent,
+	//Halton bases 2 and 3 per dimension pair, base 2 Owen-scrambled and base 3 digit-scrambled per pixel
+	Halton,
+	//Sobol(0,2)-sequence per dimension pair, with the index shuffled and the points Owen-scrambled per pixel(Burley 2020)
+	Sobol,
+	//The same unscrambled Sobol points in every pixel, shifted per pixel by a blue-noise mask so the leftover error is spread as blue noise
+	BlueNoise
+};
+
+namespace SampleDimension
+{
+	//2D, in the camera block
+	inline constexpr uint32_t PixelJitter = 0;
+	//2D, in the camera block
+	inline constexpr uint32_t Lens = 2;
+	inline constexpr uint32_t CameraCount = 4;
+	//Offsets inside a bounce's block. ScatterDirection is 2D
+	inline constexpr uint32_t ScatterDirection = 0;
+	inline constexpr uint32_t ScatterChoice = 2;
+	inline constexpr uint32_t Roulette = 3;
+	inline constexpr uint32_t PerBounce = 4;
+}
+
+class VSampler
+{
+public:
+	//Start one pixel sample on the calling thread. ImageWidth turns PixelIndex back into x and y for the blue-noise mask
+	static void BeginSample(SamplerType Type, uint32_t PixelIndex, uint32_t ImageWidth, uint32_t SampleIndex, uint64_t Seed);
+	//Following draws use bounce Bounce's block, BeginSample starts on the camera block
+	static void SetBounce(uint32_t Bounce);
+	//[0, 1), Offset is relative to the current block
+	static float Get1D(uint32_t Offset);
+	static void Get2D(uint32_t Offset, float& OutU, float& OutV);
+
+	//Uniform direction on the unit sphere from two uniform numbers, replaces the rejection loop of Vector3D::RandomUnitVector
+	static Vector3D UniformSphere(float U, float V);
+	//Concentric mapping of the unit square onto the unit disk(Shirley and Chiu), replaces the rejection loop of Vector3D::RandomOnUnitDisk
+	static Vector3D ConcentricDisk(float U, float V);
+
+	static const char* GetSamplerName(SamplerType Type);
+	//Accepts the names GetSamplerName returns plus "random". Returns false for anything else
+	static bool ParseSamplerName(const char* Name, SamplerType& OutType);
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "HittableList.h"
+#include "Camera.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/*
+* Versioned little-endian binary scene format, laid out so loading is a memory map plus one bulk copy per array
+* 1. A fixed size header, then one section per HittableList component array: SphereTransformData, MaterialScatterData, MaterialType, sphere id
+*    and the BVH nodes. Every section starts on a 64 byte boundary and holds the elements exactly as they sit in memory
+* 2. Scenes are saved in BVH order with the BVH itself, so a load skips the build too. A file without nodes gets its BVH built like any other world
+* 3. Version 2 added the camera placement to the header, version 1 files still load and keep whatever camera the renderer has
+* 4. The loader checks everything that could make a render read out of bounds(section ranges, material types, BVH links) before the world is used
+* The file is only ever read and written on little-endian hosts, which is every platform this builds for
+*/
+
+inline constexpr char g_SceneFileMagic[8] = { 'M', 'R', 'T', 'S', 'C', 'E', 'N', 'E' };
+inline constexpr uint32_t g_SceneFileVersion = 2;
+
+struct SceneFileSection
+{
+	uint64_t Offset = 0;
+	uint64_t Count = 0;
+};
+
+//CameraView as plain floats, so the header layout does not depend on Vector3D
+struct SceneFileCamera
+{
+	//0 if the scene leaves the camera to the renderer
+	uint32_t HasCamera = 0;
+	float CameraCenter[3] = {};
+	float LookAt[3] = {};
+	float VerticalFOV = 0.f;
+	float FocusDistance = 0.f;
+	float DefocusAngle = 0.f;
+};
+
+struct SceneFileHeader
+{
+	char Magic[8] = {};
+	uint32_t Version = 0;
+	uint32_t HeaderSize = 0;
+	SceneFileSection Transforms;
+	SceneFileSection MaterialData;
+	SceneFileSection MaterialTypes;
+	//Empty in a file whose spheres were never put in BVH order
+	SceneFileSection BVHNodes;
+	//Same count as the other sphere sections
+	uint64_t SphereIDOffset = 0;
+	//Everything above is the whole version 1 header
+	SceneFileCamera Camera;
+};
+
+namespace SceneFile
+{
+	/*
+	* Write the world's spheres, and its BVH if it has one, to FilePath. Camera is optional and stored in the header
+	* Returns false and fills OutError if the file can not be written
+	*/
+	bool Save(const std::string& FilePath, const HittableList& World, const CameraView* Camera = nullptr, std::string* OutError = nullptr);
+	/*
+	* Map FilePath and build a fresh world from it. With ShouldUseBVH false the stored nodes are ignored and the world traces with the linear loop
+	* OutCamera receives the stored camera, or nullptr if the file has none
+	* Returns false and fills OutError on a missing, truncated or inconsistent file, OutWorld and OutCamera are only replaced on success
+	*/
+	bool Load(const std::string& FilePath, std::unique_ptr<HittableList>& OutWorld, std::unique_ptr<CameraView>& OutCamera, bool ShouldUseBVH = true, std::string* OutError = nullptr);
+	//True if FilePath starts with the binary scene magic, how callers tell a binary scene from a text one(see SceneText)
+	bool IsBinaryScene(const std::string& FilePath);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "HittableList.h"
+#include "Camera.h"
+#include <memory>
+#include <string>
+
+class VThreadPool;
+
+/*
+* Human-editable text scenes. One statement per line, tokens separated by spaces or tabs, '#' starts a comment that runs to the end of the line
+*
+*   camera center 13 2 3 lookat 0 0 0 vfov 20 focus 10 defocus 0.6
+*   sphere <x> <y> <z> <radius> lambertian <r> <g> <b>
+*   sphere <x> <y> <z> <radius> metal <r> <g> <b> <fuzz>
+*   sphere <x> <y> <z> <radius> dielectric <refraction index>
+*
+* The camera line is optional, any of its five settings may be left out(they keep the Camera defaults) and the last camera line wins
+* Spheres get their ids(see HittableList::GetSphereID) in file order
+*
+* Loading is built for files with millions of spheres:
+* 1. The file is memory mapped and cut into chunks of about a megabyte at line breaks, the chunks are parsed in parallel on the thread pool
+* 2. Numbers go through std::from_chars, no locale, no allocation, no stream state
+* 3. Every chunk fills its own component arrays, which are appended to the world in chunk order with one bulk copy each
+*/
+
+struct SceneTextStats
+{
+	size_t Bytes = 0;
+	size_t Lines = 0;
+	size_t Spheres = 0;
+	unsigned int Chunks = 0;
+	//Map, parse and insert, wall clock
+	double ParseMs = 0.0;
+
+	double GetMBPerSecond() const { return ParseMs > 0.0 ? (double)Bytes / 1e6 / (ParseMs / 1000.0) : 0.0; }
+};
+
+namespace SceneText
+{
+	/*
+	* Parse FilePath into a fresh world, no BVH yet. OutCamera receives the camera line's placement, or nullptr if the file has none
+	* Returns false and fills OutError(with the line number) on the first malformed line, OutWorld and OutCamera are only replaced on success
+	*/
+	bool Load(const std::string& FilePath, VThreadPool& Pool, std::unique_ptr<HittableList>& OutWorld, std::unique_ptr<CameraView>& OutCamera,
+		SceneTextStats* OutStats = nullptr, std::string* OutError = nullptr);
+}
@@ -4,17 +4,16 @@
 #include <string>
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
-#include "Camera.h"
-#include "ThreadPool.h"
-#include <atomic>
+#include "RenderCore.h"
 
 class D2D1Class;
 
+//The Win32 front end of the CPU path. All the actual tracing lives in RenderCore, this class only presents the frame buffer through D2D1
 class SoftwareRenderer
 {
 public:
 	SoftwareRenderer(unsigned int Width, unsigned int Height, float AspectRatio);
-	bool Initialize(HWND hWnd, unsigned int SampleCount, unsigned int MaxDepth);
+	bool Initialize(HWND hWnd, unsigned int SampleCount, unsigned int MaxDepth, unsigned int RouletteMinDepth);
 	void ClearWindow();
 	void RenderFrameBuffer();
 	void RenderToWindow();
@@ -22,24 +21,13 @@ public:
 
 	~SoftwareRenderer();
 
-private:
-	void CreateWorld();
 private:
 	unsigned int m_Width;
 	unsigned int m_Height;
 	float m_AspectRatio;
-	float m_ViewportWidth = 0.f;
-	float m_ViewportHeight = 0.f;
-	Vector3D m_ViewportU;
-	Vector3D m_ViewportV;
-	Vector3D m_DeltaU;
-	Vector3D m_DeltaV;
-	Camera m_Camera;
-	std::unique_ptr<HittableList> m_World;
+	std::unique_ptr<RenderCore> m_RenderCore;
 	HWND m_hWnd;
-	unsigned char* m_FrameBuffer;
 	D2D1Class* m_D2D1;
-	std::unique_ptr <VThreadPool> m_ThreadPool;
 	std::wstring m_RenderTimeString;
 	
-};
\ No newline at end of file
+};
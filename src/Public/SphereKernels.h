@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Ray.h"
+#include "CPUDispatch.h"
+
+struct SphereSoAComponent;
+
+/*
+* Ray versus many spheres kernels working on the SoA sphere arrays
+* They only track the nearest distance and the sphere index. Building the hit record(hit point, normal, face) is left to the caller, and it's done once
+*/
+namespace SphereKernels
+{
+	//Number of spheres tested per iteration by the active kernel(1 for scalar, 4 for SSE4.2, 8 for AVX2, 16 for AVX-512)
+	unsigned int GetLaneWidth();
+	const char* GetKernelName();
+	//Called by CPUDispatch::SetActiveISA, switches the kernel used by NearestHit
+	void SelectISA(ISALevel Level);
+
+	/*
+	* Test the spheres in [First, First + Count) against R
+	* Returns the index of the nearest sphere hit with TMin < t < ClosestSoFar, or -1 if there is none. ClosestSoFar is lowered to that t
+	*/
+	int NearestHit(const SphereSoAComponent& Spheres, const Ray& R, float TMin, float& ClosestSoFar, unsigned int First, unsigned int Count);
+}
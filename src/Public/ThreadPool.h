@@ -1,5 +1,6 @@
 #pragma once
 
+#include "MPMCQueue.h"
 #include <functional>
 #include <vector>
 #include <thread>
@@ -8,6 +9,35 @@
 #include <mutex>
 #include <future>
 #include <memory>
+#include <atomic>
+#include <string>
+
+//Which container the pending tasks live in
+enum class ThreadPoolQueueType : uint8_t
+{
+	//The original std::queue behind m_QueueMutex
+	Mutex,
+	//Bounded VMPMCQueue. Submitting and popping never take a lock, the mutex is only touched to put idle workers to sleep and wake them up again
+	LockFree
+};
+
+//Where the workers run
+enum class ThreadPlacement : uint8_t
+{
+	//Let the OS schedule the workers wherever it likes
+	None,
+	//Pin every worker to its own CPU, spread evenly over the affinity mask
+	Cores,
+	//Pin like Cores, but CPUs are taken node by node and every worker knows its NUMA node, so callers can keep memory node-local
+	NUMANodes
+};
+
+struct ThreadPoolPlacement
+{
+	ThreadPlacement Mode = ThreadPlacement::None;
+	//Only use the first NodeLimit NUMA nodes(0 for all of them). The automatic thread count shrinks to the CPUs of those nodes
+	unsigned int NodeLimit = 0;
+};
 
 //A basic thread pool. Credit goes to: https://github.com/progschj/ThreadPool/blob/master/ThreadPool.h
 /*
@@ -16,17 +46,58 @@
 * 2. Added logics in the constructor to allow user(which is myself) to choose whether they want to specify a custom thread count.
 * 3. Added logics in the constructor to cap our max worker thread counts at 3/4 the user's concurrency
 * 4. Getter to ask whether the thread pool had stopped
+* 5. A lock-free queue backend, picked at construction
+* 6. ParallelFor, which runs a whole index range without a future or a heap allocation per item
+* 7. The automatic thread count comes from the CPU budget(affinity mask and cgroup quota) instead of hardware_concurrency, see ResolveThreadCount
+* 8. Optional core pinning and a per-NUMA-node split of the workers
 */
 class VThreadPool
 {
 public:
-	VThreadPool(size_t NumThreads = 2, bool IsUsingCustomThreadCount = false);
+	/*
+	* Thread count, first match wins:
+	* 1. RAYTRACER_THREADS in the environment, so a deployment can pin it without touching the application
+	* 2. IsUsingCustomThreadCount with a non-zero NumThreads, used as is even if it exceeds the CPU budget
+	* 3. The CPU budget: all of it when a cgroup quota is the limit(the container was sized for us), otherwise 3/4 of the affinity mask(1/2 without IsUsingCustomThreadCount) so the desktop stays responsive
+	*/
+	VThreadPool(size_t NumThreads = 2, bool IsUsingCustomThreadCount = false, ThreadPoolQueueType QueueType = ThreadPoolQueueType::Mutex, size_t LockFreeCapacity = 4096,
+		const ThreadPoolPlacement& Placement = ThreadPoolPlacement());
 	~VThreadPool();
 
 	bool HasStopped() const
 	{
 		return m_HasStopped;
 	}
+	size_t GetThreadCount() const
+	{
+		return m_Workers.size();
+	}
+	//Why the pool picked GetThreadCount threads, meant for logs(e.g. "cgroup v2 quota of 4.00 CPUs")
+	const std::string& GetThreadCountReason() const
+	{
+		return m_ThreadCountReason;
+	}
+	ThreadPoolQueueType GetQueueType() const
+	{
+		return m_QueueType;
+	}
+	//Number of NUMA nodes the workers are split over, 1 unless the placement is ThreadPlacement::NUMANodes
+	unsigned int GetNodeCount() const
+	{
+		return m_NodeCount;
+	}
+	//Node slot(0 to GetNodeCount() - 1, not the kernel's node number) of a worker
+	unsigned int GetWorkerNode(size_t WorkerIndex) const
+	{
+		return m_WorkerNodes[WorkerIndex];
+	}
+	//CPU a worker is pinned to, -1 if it is not pinned
+	int GetWorkerCPU(size_t WorkerIndex) const
+	{
+		return m_WorkerCPUs[WorkerIndex];
+	}
+	//Index of the calling thread among this pool's workers, -1 if it is not one of them
+	int GetCurrentWorkerIndex() const;
 
 	/*
 	* This part is where the flexibility comes in. Use a template coupled with future so we can query the result of an async task
@@ -34,12 +105,54 @@ public:
 	*/
 	template<typename Func, class... Args>
 	auto SubmitTask(Func&& InFunc, Args&&... InArgs) -> std::future<typename std::invoke_result<Func, Args...>::type>;
+
+	/*
+	* Run InFunc(ChunkBegin, ChunkEnd) over [Begin, End) split into chunks of Grain indices, and block until every chunk is done
+	* 1. At most one helper task per worker is queued, the helpers and the calling thread then claim chunks from a shared atomic counter
+	* 2. The helpers only capture a pointer to the job on the caller's stack, which fits std::function's small buffer, so nothing is allocated per call
+	* 3. Called from one of the pool's own workers, the whole range runs inline. Waiting on helpers queued behind ourselves could otherwise deadlock
+	* InFunc must not throw
+	*/
+	template<typename Func>
+	void ParallelFor(size_t Begin, size_t End, size_t Grain, Func&& InFunc);
+
+private:
+	struct ParallelForJob
+	{
+		std::atomic<size_t> Next;
+		size_t End;
+		size_t Grain;
+		void(*Invoke)(void* Context, size_t ChunkBegin, size_t ChunkEnd);
+		void* Context;
+		//Helpers that have not finished yet, guarded by m_ParallelForMutex
+		size_t PendingHelpers;
+	};
+
+	static size_t ResolveThreadCount(size_t NumThreads, bool IsUsingCustomThreadCount, unsigned int CPULimit, std::string& OutReason);
+	void AssignWorkerCPUs(size_t NumThreads, const ThreadPoolPlacement& Placement);
+	void WorkerLoop();
+	void Enqueue(std::function<void()>&& Task);
+	void ParallelForImpl(ParallelForJob& Job, size_t Begin);
+	static void RunChunks(ParallelForJob& Job);
+
 private:
 	std::vector<std::thread> m_Workers;
+	std::string m_ThreadCountReason;
+	std::vector<unsigned int> m_WorkerNodes;
+	std::vector<int> m_WorkerCPUs;
+	unsigned int m_NodeCount = 1;
+	ThreadPoolQueueType m_QueueType;
 	std::queue<std::function<void()>> m_Tasks;
+	std::unique_ptr<VMPMCQueue<std::function<void()>>> m_LockFreeTasks;
+	//Tasks pushed to the lock-free queue and not popped yet. It can dip below zero for a moment because the pop may beat the increment
+	std::atomic<long long int> m_LockFreeTaskCount = 0;
+	std::atomic<unsigned int> m_SleepingWorkers = 0;
 	std::mutex m_QueueMutex;
 	std::condition_variable m_Condition;
-	bool m_HasStopped = false;
+	std::atomic<bool> m_HasStopped = false;
+
+	std::mutex m_ParallelForMutex;
+	std::condition_variable m_ParallelForCondition;
 };
 
 template<typename Func, class ...Args>
@@ -57,17 +170,28 @@ inline auto VThreadPool::SubmitTask(Func&& InFunc, Args && ...InArgs) -> std::fu
 	);
 
 	std::future<ReturnType> Result = Task->get_future();
+	Enqueue([Task]()
 	{
-		std::unique_lock<std::mutex> Lock(m_QueueMutex);
-		if (m_HasStopped)
-		{
-			throw std::runtime_error("Exception: Submitting to a stopped Thread Pool!");
-		}
-		m_Tasks.emplace([Task]()
-		{
-			(*Task)();
-		});
-	}
-	m_Condition.notify_one();
+		(*Task)();
+	});
 	return Result;
 }
+
+template<typename Func>
+inline void VThreadPool::ParallelFor(size_t Begin, size_t End, size_t Grain, Func&& InFunc)
+{
+	if (Begin >= End)
+	{
+		return;
+	}
+	using FuncType = std::remove_reference_t<Func>;
+	ParallelForJob Job;
+	Job.End = End;
+	Job.Grain = Grain > 0 ? Grain : 1;
+	Job.Invoke = [](void* Context, size_t ChunkBegin, size_t ChunkEnd)
+	{
+		(*static_cast<FuncType*>(Context))(ChunkBegin, ChunkEnd);
+	};
+	Job.Context = const_cast<void*>(static_cast<const void*>(&InFunc));
+	ParallelForImpl(Job, Begin);
+}
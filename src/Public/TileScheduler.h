@@ -0,0 +1,105 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include <atomic>
+
+/*
+* Work-stealing tile scheduler for the frame buffer
+* 1. The frame is cut into TileSize x TileSize tiles(the right and bottom tiles may be smaller) and the tiles are dealt round-robin into one queue per worker
+* 2. Each worker drains its own queue from the front, so it walks its tiles in scanline order. Once it runs dry it steals from the back of the other queues
+*    which is what evens out the glass-heavy tiles against the sky tiles
+* 3. The workers are VThreadPool threads: Run submits exactly one long-running task per pool thread, no matter how many tiles there are
+* 4. Busy time is the time spent inside the tile function, idle time is the rest of the frame(start-up latency, stealing, waiting for the last tile)
+* 5. With a pool split over NUMA nodes, every node gets its own horizontal band of tiles and thieves look for work on their own node first
+*    so the frame buffer pages a node first touched are the ones it keeps writing
+* The queue index is the pool worker index of the thread running the loop, which is what ties a queue(and its band) to a node
+*/
+
+struct RenderTile
+{
+	unsigned int Index = 0;
+	//Pixel range [X0, X1) x [Y0, Y1)
+	unsigned int X0 = 0;
+	unsigned int Y0 = 0;
+	unsigned int X1 = 0;
+	unsigned int Y1 = 0;
+};
+
+struct TileWorkerStats
+{
+	double BusyMs = 0.0;
+	double IdleMs = 0.0;
+	unsigned int TilesRendered = 0;
+	//How many of TilesRendered were taken from another worker's queue
+	unsigned int TilesStolen = 0;
+};
+
+class VTileScheduler
+{
+public:
+	using TileFunc = std::function<void(const RenderTile& Tile, unsigned int WorkerIndex)>;
+	using TileDoneFunc = std::function<bool(const RenderTile& Tile)>;
+
+	VTileScheduler(VThreadPool& ThreadPool);
+
+	/*
+	* Render every tile of a Width x Height frame and block until they are all done
+	* OnTile runs on the workers. OnTileDone is optional and runs on the calling thread once per finished tile, returning false from it cancels the tiles
+	* that have not started yet. Either way Run only returns once no worker is touching the frame anymore
+	* Returns false if the frame was cancelled
+	*/
+	bool Run(unsigned int Width, unsigned int Height, unsigned int TileSize, const TileFunc& OnTile, const TileDoneFunc& OnTileDone = nullptr);
+	/*
+	* Same tiling as Run, but workers never take tiles from another NUMA node, whatever is left over runs on the calling thread
+	* Meant for first-touch passes, where running a tile on the wrong node would place its pages there for good
+	*/
+	void RunNodeLocal(unsigned int Width, unsigned int Height, unsigned int TileSize, const TileFunc& OnTile);
+
+	unsigned int GetWorkerCount() const { return (unsigned int)m_Queues.size(); }
+	//Per-worker statistics of the last Run
+	const std::vector<TileWorkerStats>& GetWorkerStats() const { return m_WorkerStats; }
+	//Wall time of the last Run in milliseconds
+	double GetLastFrameMs() const { return m_LastFrameMs; }
+
+private:
+	//Owner pops at Head, thieves pop at Tail. The tile storage is reused between frames, so a frame does not allocate once the sizes settle
+	struct alignas(64) TileQueue
+	{
+		std::mutex Mutex;
+		std::vector<unsigned int> Tiles;
+		size_t Head = 0;
+		size_t Tail = 0;
+	};
+
+	bool RunInternal(unsigned int Width, unsigned int Height, unsigned int TileSize, const TileFunc& OnTile, const TileDoneFunc& OnTileDone, bool ShouldStealAcrossNodes);
+	void DealTiles(unsigned int TileCount, unsigned int TilesY);
+	void WorkerLoop();
+	bool PopOwn(unsigned int WorkerIndex, unsigned int& OutTile);
+	bool Steal(unsigned int WorkerIndex, unsigned int& OutTile);
+	bool StealFrom(unsigned int VictimIndex, unsigned int& OutTile);
+	RenderTile MakeTile(unsigned int TileIndex) const;
+
+private:
+	VThreadPool& m_ThreadPool;
+	std::vector<std::unique_ptr<TileQueue>> m_Queues;
+	std::vector<TileWorkerStats> m_WorkerStats;
+	//Pool worker indices per node slot
+	std::vector<std::vector<unsigned int>> m_NodeWorkers;
+
+	//Per-frame state, set by Run before the worker tasks are submitted
+	unsigned int m_Width = 0;
+	unsigned int m_Height = 0;
+	unsigned int m_TileSize = 0;
+	unsigned int m_TilesX = 0;
+	const TileFunc* m_OnTile = nullptr;
+	std::atomic<bool> m_ShouldCancel = false;
+	bool m_ShouldStealAcrossNodes = true;
+
+	//Finished tiles waiting for the calling thread to report them
+	std::mutex m_DoneMutex;
+	std::condition_variable m_DoneCondition;
+	std::vector<unsigned int> m_DoneTiles;
+	unsigned int m_WorkersFinished = 0;
+
+	double m_LastFrameMs = 0.0;
+};
@@ -1,17 +1,22 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
 
 
 /*
 * A simple wrapper class for a timer that can be used to test performace, right now it ONLY support recording one duration
 * Starting the timer without storing the last duration first will result the older record being overwritten
-* This could be done using the WIN32 API, which might be better for windows apps, which is what we are writing right now
+* It runs on the steady clock, high_resolution_clock may be the system clock and jump when the wall time is adjusted
+* For timing several phases at once use VProfileZone below instead of a handful of these
 */
 
 
 
-using STDTimePoint = std::chrono::high_resolution_clock::time_point;
+using STDTimePoint = std::chrono::steady_clock::time_point;
 
 
 class VTimer
@@ -22,14 +27,98 @@ public:
 	long long int GetTimeElapsed() const;
 	long long int GetLastDuration() const
 	{
-		return m_LastDuration;
+		return m_LastDurationNs / 1000000;
+	}
+	//Same duration in microseconds, for things that finish well under a millisecond(e.g. acceleration structure builds)
+	long long int GetLastDurationUs() const
+	{
+		return m_LastDurationNs / 1000;
+	}
+	long long int GetLastDurationNs() const
+	{
+		return m_LastDurationNs;
 	}
 
 	void Stop();
 private:
-	//Store the time point 
+	//Store the time point
 	STDTimePoint m_StartTime;
 	STDTimePoint m_EndTime;
-	long long int m_LastDuration = 0;
+	long long int m_LastDurationNs = 0;
 	bool m_HasStarted = false;
-};
\ No newline at end of file
+};
+
+//Aggregated timings of one zone, merged over every thread that entered it under the same parent path
+struct ProfileZoneStats
+{
+	std::string Name;
+	//0 for a top level zone, children follow their parent directly
+	unsigned int Depth = 0;
+	uint64_t Count = 0;
+	uint64_t TotalNs = 0;
+	uint64_t MinNs = 0;
+	uint64_t MeanNs = 0;
+	uint64_t P50Ns = 0;
+	uint64_t P99Ns = 0;
+};
+
+/*
+* Hierarchical profiler behind VProfileZone
+* 1. Every thread keeps its own tree of zones, keyed by the zone names on the way down, and a fixed size histogram of the durations each zone took
+*    Entering a zone takes no lock, and memory does not grow with the number of frames rendered
+* 2. GetSummary merges the threads' trees by path, so the same zone on eight workers becomes one row with eight times the samples
+*    A worker thread has no parent zone of its own, its zones show up at the top level next to the calling thread's
+* 3. The summary covers every zone since the last Reset. Reset and GetSummary read every thread's tree, so only call them while no zone is open on another thread(e.g. between renders)
+* 4. Build with RAYTRACER_PROFILER=OFF and zones only time themselves(and still go on the trace timeline), nothing is recorded for the summary
+*/
+#ifndef RAYTRACER_PROFILER
+#define RAYTRACER_PROFILER 1
+#endif
+
+class VProfiler
+{
+public:
+	static constexpr bool IsCompiledIn()
+	{
+		return RAYTRACER_PROFILER != 0;
+	}
+	static void Reset();
+	//Depth-first, siblings in the order they were first entered
+	static std::vector<ProfileZoneStats> GetSummary();
+	//GetSummary as an indented table in milliseconds
+	static void PrintSummary(std::ostream& Out);
+};
+
+/*
+* Times its scope as a zone of VProfiler, nested under whichever zone the same thread has open
+* With VTraceRecorder enabled the zone also goes on the trace timeline, so a zone does not need a VTraceScope next to it
+* Name must be a string literal or otherwise outlive the profiler, only the pointer is stored
+*/
+class VProfileZone
+{
+public:
+	VProfileZone(const char* Name, const char* ArgName = nullptr, int64_t Arg = 0);
+	~VProfileZone()
+	{
+		Stop();
+	}
+	VProfileZone(const VProfileZone&) = delete;
+	VProfileZone& operator=(const VProfileZone&) = delete;
+
+	//Time since the zone was entered, in nanoseconds
+	uint64_t GetElapsedNs() const;
+	//End the zone before the scope does, returns its duration in nanoseconds. Later calls return the same duration
+	uint64_t Stop();
+
+private:
+	const char* m_Name;
+	const char* m_ArgName;
+	int64_t m_Arg;
+	int m_Node;
+	STDTimePoint m_StartTime;
+	uint64_t m_DurationNs = 0;
+	//Start on the trace recorder's clock, only set when tracing was on as the zone was entered
+	uint64_t m_TraceStartNs = 0;
+	bool m_IsTraced = false;
+	bool m_IsOpen = true;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+* Opt-in timeline tracing, dumped as Chrome trace event JSON(open it in Perfetto or chrome://tracing)
+* 1. Every thread records into its own ring buffer, allocated on its first event. Only the owning thread writes, so recording takes no lock and no atomic RMW
+* 2. A full ring buffer overwrites its oldest events, WriteChromeTrace reports how many were dropped
+* 3. Disabled(the default) a VTraceScope is one relaxed load and a branch, nothing is allocated and the clock is never read
+* 4. Enable throws away the old buffers and WriteChromeTrace reads them, so call both while no other thread is recording(e.g. between renders)
+*/
+
+struct TraceEvent
+{
+	//Both must be string literals or otherwise outlive the recorder, only the pointer is stored
+	const char* Name = nullptr;
+	const char* Category = nullptr;
+	uint64_t StartNs = 0;
+	uint64_t DurationNs = 0;
+	//Optional single integer argument, shown under "args" in the viewer
+	const char* ArgName = nullptr;
+	int64_t Arg = 0;
+};
+
+class VTraceRecorder
+{
+public:
+	//Start recording, EventsPerThread is rounded up to a power of two
+	static void Enable(size_t EventsPerThread = 1 << 16);
+	static void Disable();
+	static bool IsEnabled()
+	{
+		return s_IsEnabled.load(std::memory_order_relaxed);
+	}
+	//Label for the calling thread in the viewer, it can be set before tracing is enabled
+	static void SetThreadName(const std::string& Name);
+	//Nanoseconds on the steady clock since Enable
+	static uint64_t Now();
+	static void Record(const TraceEvent& Event);
+	//Write every thread's events as {"traceEvents": [...]}. Returns false if the file could not be written
+	static bool WriteChromeTrace(const std::string& Path, size_t* OutEventCount = nullptr, size_t* OutDroppedCount = nullptr);
+
+private:
+	static inline std::atomic<bool> s_IsEnabled = false;
+};
+
+//Records one complete("X") event from construction to destruction
+class VTraceScope
+{
+public:
+	VTraceScope(const char* Name, const char* Category, const char* ArgName = nullptr, int64_t Arg = 0)
+	{
+		if (VTraceRecorder::IsEnabled())
+		{
+			m_Event.Name = Name;
+			m_Event.Category = Category;
+			m_Event.ArgName = ArgName;
+			m_Event.Arg = Arg;
+			m_Event.StartNs = VTraceRecorder::Now();
+		}
+	}
+	~VTraceScope()
+	{
+		if (m_Event.Name)
+		{
+			m_Event.DurationNs = VTraceRecorder::Now() - m_Event.StartNs;
+			VTraceRecorder::Record(m_Event);
+		}
+	}
+	VTraceScope(const VTraceScope&) = delete;
+	VTraceScope& operator=(const VTraceScope&) = delete;
+
+private:
+	TraceEvent m_Event;
+};
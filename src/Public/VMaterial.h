@@ -2,6 +2,7 @@
 
 #include "Hittable.h"
 #include "Color.h"
+#include "CPUDispatch.h"
 
 
 struct MaterialScatterData;
@@ -12,9 +13,16 @@ class VMaterial
 public:
 	VMaterial() = default;
 	
+	//Forwards to the scatter code compiled for the active ISA(see CPUDispatch)
 	static bool DispatchScatter(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData& Data, MaterialType Type);
+	//Called by CPUDispatch::SetActiveISA
+	static void SelectISA(ISALevel Level);
+	//Holds the per-ISA DispatchScatter variants, defined in VMaterial.cpp
+	friend struct VMaterialVariants;
 
 private:
+	//The actual switch over the material types. Forced inline into each per-ISA DispatchScatter variant so each variant gets its own codegen
+	static bool DispatchScatterImpl(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData& Data, MaterialType Type);
 	static bool Lambertian(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData&);
 	static bool Metalic(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData&);
 	static bool Dielectric(const Ray& R, const HitRecord& InHitRecord, Color& OutAttenuation, Ray& OutScattered, const MaterialScatterData&);
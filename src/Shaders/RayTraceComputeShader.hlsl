@@ -14,6 +14,8 @@ cbuffer GlobalBuffer
     uint2 ScreenSize; //Screen width, height
     uint Depth;
     uint SampleCount;
+    uint RouletteMinDepth; //Russian roulette from this bounce on, 0 = off. Same rule as Camera::PerformPathTrace
+    uint3 Padding5;
 };
 
 struct SphereTransformType
@@ -306,6 +308,16 @@ float4 PerformPathTrace(const Ray R, inout RandomState RandState)
             {
                 TotalAttenuation *= Attenuation;
                 CurrentRay = ScatteredRay;
+                if (RouletteMinDepth > 0 && i + 1 >= RouletteMinDepth)
+                {
+                    float SurvivalProbability = clamp(max(TotalAttenuation.r, max(TotalAttenuation.g, TotalAttenuation.b)), 0.05f, 1.f);
+                    //RandomFloat01 can return exactly 1, so a path at full throughput skips the draw instead of dying once in 2^32
+                    if (SurvivalProbability < 1.f && RandomFloat01(RandState) >= SurvivalProbability)
+                    {
+                        return float4(0.f, 0.f, 0.f, 1.f);
+                    }
+                    TotalAttenuation.rgb /= SurvivalProbability;
+                }
             }
             else
             {